@@ -0,0 +1,70 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Adafruit_GFX.h: adafruit's drawing on a frame buffer, for the host build
+ */
+
+#ifndef ADAFRUIT_GFX_H
+#define ADAFRUIT_GFX_H
+
+#include "Print.h"
+#include <stdint.h>
+
+#define BLACK 0
+#define WHITE 1
+
+/** developer note:
+ *
+ * text is drawn in the classic 6x8 cell (times the text size) without the
+ * real font, each glyph gets a made up pattern of its own. that's enough for
+ * the frame buffer to change when the text does, which is all the backends
+ * in display.cpp care about.
+ *
+ */
+
+class Adafruit_GFX : public Print {
+public:
+  Adafruit_GFX(int16_t width, int16_t height);
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void fillScreen(uint16_t color);
+  void setCursor(int16_t x, int16_t y);
+  void setTextSize(uint8_t size);
+  void setTextColor(uint16_t color);
+  void setTextColor(uint16_t color, uint16_t background);
+  void setTextWrap(bool wrap);
+  void setRotation(uint8_t rotation);
+  int16_t width() const { return this->w; }
+  int16_t height() const { return this->h; }
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+protected:
+  int16_t w;
+  int16_t h;
+  int16_t cursorX = 0;
+  int16_t cursorY = 0;
+  uint8_t textSize = 1;
+  uint16_t textColor = WHITE;
+  bool wrap = true;
+};
+
+#endif // ADAFRUIT_GFX_H
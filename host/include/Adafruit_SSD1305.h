@@ -0,0 +1,46 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Adafruit_SSD1305.h: 1 bit oled over spi, for the host build
+ */
+
+#ifndef ADAFRUIT_SSD1305_H
+#define ADAFRUIT_SSD1305_H
+
+#include "Adafruit_GFX.h"
+#include "SPI.h"
+
+#define SSD1305_I2C_ADDRESS 0x3C
+
+class Adafruit_SSD1305 : public Adafruit_GFX {
+public:
+  Adafruit_SSD1305(uint16_t width, uint16_t height, SPIClass *spi, int8_t dc,
+                   int8_t reset, int8_t cs, uint32_t bitrate);
+  ~Adafruit_SSD1305();
+  bool begin(uint8_t address, bool reset);
+  void display();
+  void clearDisplay();
+  uint8_t *getBuffer() { return this->buffer; }
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+
+private:
+  uint8_t *buffer;
+};
+
+#endif // ADAFRUIT_SSD1305_H
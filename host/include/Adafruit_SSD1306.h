@@ -0,0 +1,47 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Adafruit_SSD1306.h: 1 bit oled over i2c, for the host build
+ */
+
+#ifndef ADAFRUIT_SSD1306_H
+#define ADAFRUIT_SSD1306_H
+
+#include "Adafruit_GFX.h"
+#include "Wire.h"
+
+#define SSD1306_SWITCHCAPVCC 0x02
+
+class Adafruit_SSD1306 : public Adafruit_GFX {
+public:
+  Adafruit_SSD1306(uint8_t width, uint8_t height, TwoWire *wire,
+                   int8_t reset);
+  Adafruit_SSD1306(int8_t reset);
+  ~Adafruit_SSD1306();
+  bool begin(uint8_t vcc, uint8_t address);
+  void display();
+  void clearDisplay();
+  uint8_t *getBuffer() { return this->buffer; }
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+
+private:
+  uint8_t *buffer;
+};
+
+#endif // ADAFRUIT_SSD1306_H
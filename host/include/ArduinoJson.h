@@ -0,0 +1,91 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * ArduinoJson.h: a json object at most one level deep, all the sketch (and
+ * the beacon it used to pack) ever builds
+ */
+
+#ifndef ARDUINOJSON_H
+#define ARDUINOJSON_H
+
+#include "WString.h"
+#include <stddef.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+class JsonDocument;
+
+// a member of a JsonDocument, or of an object in one, only ever assigned to
+class JsonVariant {
+public:
+  JsonVariant(JsonDocument *doc, const char *key, const char *parent = nullptr)
+      : doc(doc), key(key), parent(parent) {}
+  JsonVariant operator[](const char *key) {
+    return JsonVariant(this->doc, key, this->key);
+  }
+  JsonVariant &operator=(const char *value);
+  JsonVariant &operator=(const String &value);
+  JsonVariant &operator=(const std::string &value);
+  JsonVariant &operator=(long value);
+  JsonVariant &operator=(int value) { return *this = (long)value; }
+  JsonVariant &operator=(bool value);
+
+private:
+  JsonDocument *doc;
+  const char *key;
+  const char *parent;
+};
+
+// keys and their values, already serialized
+typedef std::vector<std::pair<std::string, std::string>> json_members_t;
+
+// a member of the document, with its value or the members of its object
+typedef struct {
+  std::string key;
+  std::string json;
+  json_members_t members;
+} json_member_t;
+
+class JsonDocument {
+public:
+  JsonVariant operator[](const char *key) { return JsonVariant(this, key); }
+  void set(const char *parent, const char *key, const std::string &json);
+  std::string serialize() const;
+
+private:
+  std::vector<json_member_t> members;
+};
+
+// the size only mattered to the real one
+class DynamicJsonDocument : public JsonDocument {
+public:
+  explicit DynamicJsonDocument(size_t) {}
+};
+
+size_t serializeJson(const JsonDocument &doc, char *output, size_t size);
+size_t serializeJson(const JsonDocument &doc, String &output);
+size_t measureJson(const JsonDocument &doc);
+
+template <size_t N>
+size_t serializeJson(const JsonDocument &doc, char (&output)[N]) {
+  return serializeJson(doc, output, N);
+}
+
+#endif // ARDUINOJSON_H
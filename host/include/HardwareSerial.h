@@ -0,0 +1,57 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * HardwareSerial.h: the uart, backed by memory or a pty on the host
+ */
+
+#ifndef HARDWARESERIAL_H
+#define HARDWARESERIAL_H
+
+#include "Print.h"
+#include <functional>
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+typedef std::function<void(void)> OnReceiveCb;
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud);
+  void end();
+  void onReceive(OnReceiveCb function, bool onlyOnTimeout = false);
+  size_t setRxBufferSize(size_t size);
+  size_t setTxBufferSize(size_t size);
+  int available() override;
+  int read() override;
+  int peek() override;
+  int availableForWrite() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // HARDWARESERIAL_H
@@ -0,0 +1,41 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * TFT_eSPI.h: colour lcds over spi, every pixel goes straight out
+ */
+
+#ifndef TFT_ESPI_H
+#define TFT_ESPI_H
+
+#include "Adafruit_GFX.h"
+#include "SPI.h"
+
+#define TFT_BLACK 0x0000
+#define TFT_WHITE 0xFFFF
+#define TFT_GREEN 0x07E0
+#define TFT_VIOLET 0x915C
+
+class TFT_eSPI : public Adafruit_GFX {
+public:
+  TFT_eSPI();
+  void begin();
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+};
+
+#endif // TFT_ESPI_H
@@ -0,0 +1,106 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * U8g2lib.h: u8g2's full buffer mode, tiles and all, for the host build
+ */
+
+#ifndef U8G2LIB_H
+#define U8G2LIB_H
+
+#include "Print.h"
+#include <stdint.h>
+
+#define U8X8_PIN_NONE 255
+
+typedef uint8_t u8g2_uint_t;
+
+// fonts are just their cell size here: width, height, ascent
+extern const uint8_t u8g2_font_6x10_tr[];
+extern const uint8_t u8g2_font_10x20_tr[];
+
+typedef struct {
+  const uint8_t *font;
+} u8g2_t;
+
+typedef struct {
+} u8g2_cb_t;
+
+extern const u8g2_cb_t *const U8G2_R0;
+
+int8_t u8g2_GetGlyphWidth(u8g2_t *u8g2, uint16_t encoding);
+
+/** developer note:
+ *
+ * the buffer is laid out like u8g2's: rows of 8 pixel high tiles, each tile
+ * 8 bytes of one column each. glyphs are drawn as a made up pattern in their
+ * cell, and sendBuffer() or updateDisplayArea() only count what would have
+ * gone over the bus.
+ *
+ */
+
+class U8G2 : public Print {
+public:
+  U8G2(uint8_t tileWidth, uint8_t tileHeight);
+  virtual ~U8G2();
+
+  bool begin();
+  void clearBuffer();
+  void sendBuffer();
+  void updateDisplayArea(uint8_t tx, uint8_t ty, uint8_t tw, uint8_t th);
+  void setFont(const uint8_t *font);
+  void setDrawColor(uint8_t color);
+  void drawBox(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h);
+  void drawPixel(u8g2_uint_t x, u8g2_uint_t y);
+  u8g2_uint_t drawStr(u8g2_uint_t x, u8g2_uint_t y, const char *s);
+  u8g2_uint_t getStrWidth(const char *s);
+  int8_t getMaxCharWidth();
+  int8_t getMaxCharHeight();
+  u8g2_uint_t getWidth() { return this->tileWidth * 8; }
+  u8g2_uint_t getHeight() { return this->tileHeight * 8; }
+  uint8_t getBufferTileWidth() { return this->tileWidth; }
+  uint8_t getBufferTileHeight() { return this->tileHeight; }
+  uint8_t *getBufferPtr() { return this->buffer; }
+  u8g2_t *getU8g2() { return &this->u8g2; }
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+private:
+  uint8_t tileWidth;
+  uint8_t tileHeight;
+  uint8_t *buffer;
+  uint8_t color = 1;
+  u8g2_t u8g2;
+};
+
+class U8G2_SSD1306_128X64_NONAME_F_SW_I2C : public U8G2 {
+public:
+  U8G2_SSD1306_128X64_NONAME_F_SW_I2C(const u8g2_cb_t *rotation, uint8_t clock,
+                                      uint8_t data, uint8_t reset)
+      : U8G2(16, 8) {}
+};
+
+class U8G2_SH1106_128X64_NONAME_F_SW_I2C : public U8G2 {
+public:
+  U8G2_SH1106_128X64_NONAME_F_SW_I2C(const u8g2_cb_t *rotation, uint8_t clock,
+                                     uint8_t data, uint8_t reset)
+      : U8G2(16, 8) {}
+};
+
+#endif // U8G2LIB_H
@@ -0,0 +1,99 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * WString.h: arduino's String on top of std::string
+ */
+
+#ifndef WSTRING_H
+#define WSTRING_H
+
+#include <stddef.h>
+#include <string>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class String {
+public:
+  String() {}
+  String(const char *value) : value(value != nullptr ? value : "") {}
+  String(const char *value, size_t length) : value(value, length) {}
+  String(char c) : value(1, c) {}
+  String(unsigned char value, unsigned char base = DEC);
+  String(int value, unsigned char base = DEC);
+  String(unsigned int value, unsigned char base = DEC);
+  String(long value, unsigned char base = DEC);
+  String(unsigned long value, unsigned char base = DEC);
+  String(long long value, unsigned char base = DEC);
+  String(unsigned long long value, unsigned char base = DEC);
+  String(float value, unsigned int decimals = 2);
+  String(double value, unsigned int decimals = 2);
+
+  const char *c_str() const { return this->value.c_str(); }
+  unsigned int length() const { return this->value.length(); }
+  bool isEmpty() const { return this->value.empty(); }
+  bool reserve(unsigned int size);
+
+  bool concat(const String &other);
+  bool concat(const char *other);
+  bool concat(char c);
+  String &operator+=(const String &other);
+  String &operator+=(const char *other);
+  String &operator+=(char c);
+
+  bool equals(const String &other) const { return this->value == other.value; }
+  bool equals(const char *other) const;
+  bool operator==(const String &other) const { return this->equals(other); }
+  bool operator==(const char *other) const { return this->equals(other); }
+  bool operator!=(const String &other) const { return !this->equals(other); }
+  bool operator!=(const char *other) const { return !this->equals(other); }
+  bool operator<(const String &other) const {
+    return this->value < other.value;
+  }
+  bool startsWith(const String &prefix) const;
+  bool endsWith(const String &suffix) const;
+
+  char charAt(unsigned int index) const;
+  char operator[](unsigned int index) const { return this->charAt(index); }
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String &other, unsigned int from = 0) const;
+  String substring(unsigned int from) const;
+  String substring(unsigned int from, unsigned int to) const;
+  void trim();
+  long toInt() const;
+  float toFloat() const;
+
+private:
+  std::string value;
+};
+
+String operator+(const String &a, const String &b);
+String operator+(const String &a, const char *b);
+String operator+(const char *a, const String &b);
+String operator+(const String &a, char b);
+String operator+(const String &a, int b);
+String operator+(const String &a, unsigned int b);
+String operator+(const String &a, long b);
+String operator+(const String &a, unsigned long b);
+String operator+(const String &a, float b);
+String operator+(const String &a, double b);
+
+#endif // WSTRING_H
@@ -0,0 +1,45 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Wire.h: i2c, nothing on the other end on the host
+ */
+
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class TwoWire {
+public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  bool setClock(uint32_t frequency);
+  void beginTransmission(uint16_t address);
+  uint8_t endTransmission(bool stop = true);
+  uint8_t requestFrom(uint16_t address, uint8_t size, bool stop = true);
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+  int available();
+  int read();
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif // WIRE_H
@@ -0,0 +1,54 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * esp_wifi.h: the wifi driver, only its types on the host
+ */
+
+#ifndef ESP_WIFI_H
+#define ESP_WIFI_H
+
+#include "esp_err.h"
+#include "esp_wifi_types.h"
+
+/** developer note:
+ *
+ * none of the esp_wifi_*() calls are declared here on purpose. on the host
+ * the radio is simulated behind Radio (see host/sim/radio.cpp), so if
+ * anything but radio.cpp calls the driver, the host build breaks.
+ *
+ */
+
+typedef struct {
+  int static_rx_buf_num;
+  int dynamic_rx_buf_num;
+  int tx_buf_type;
+  int static_tx_buf_num;
+  int dynamic_tx_buf_num;
+  int ampdu_rx_enable;
+  int ampdu_tx_enable;
+  int nvs_enable;
+  int magic;
+} wifi_init_config_t;
+
+#define WIFI_INIT_CONFIG_MAGIC 0x1F2F3F4F
+
+#define WIFI_INIT_CONFIG_DEFAULT()                                             \
+  { 10, 32, 1, 0, 32, 1, 1, 1, WIFI_INIT_CONFIG_MAGIC }
+
+#endif // ESP_WIFI_H
@@ -0,0 +1,114 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * esp_wifi_types.h: the wifi driver's types, laid out like esp-idf 4.4
+ */
+
+#ifndef ESP_WIFI_TYPES_H
+#define ESP_WIFI_TYPES_H
+
+#include <stdint.h>
+
+typedef enum {
+  WIFI_MODE_NULL = 0,
+  WIFI_MODE_STA,
+  WIFI_MODE_AP,
+  WIFI_MODE_APSTA,
+  WIFI_MODE_MAX
+} wifi_mode_t;
+
+typedef enum { WIFI_IF_STA = 0, WIFI_IF_AP } wifi_interface_t;
+
+typedef enum {
+  WIFI_SECOND_CHAN_NONE = 0,
+  WIFI_SECOND_CHAN_ABOVE,
+  WIFI_SECOND_CHAN_BELOW
+} wifi_second_chan_t;
+
+typedef enum {
+  WIFI_AUTH_OPEN = 0,
+  WIFI_AUTH_WEP,
+  WIFI_AUTH_WPA_PSK,
+  WIFI_AUTH_WPA2_PSK,
+  WIFI_AUTH_WPA_WPA2_PSK,
+  WIFI_AUTH_WPA2_ENTERPRISE,
+  WIFI_AUTH_WPA3_PSK,
+  WIFI_AUTH_WPA2_WPA3_PSK,
+  WIFI_AUTH_WAPI_PSK,
+  WIFI_AUTH_MAX
+} wifi_auth_mode_t;
+
+typedef enum { WIFI_STORAGE_FLASH, WIFI_STORAGE_RAM } wifi_storage_t;
+
+typedef enum {
+  WIFI_PKT_MGMT,
+  WIFI_PKT_CTRL,
+  WIFI_PKT_DATA,
+  WIFI_PKT_MISC
+} wifi_promiscuous_pkt_type_t;
+
+typedef struct {
+  signed rssi : 8;
+  unsigned rate : 5;
+  unsigned : 1;
+  unsigned sig_mode : 2;
+  unsigned : 16;
+  unsigned mcs : 7;
+  unsigned cwb : 1;
+  unsigned : 16;
+  unsigned smoothing : 1;
+  unsigned not_sounding : 1;
+  unsigned : 1;
+  unsigned aggregation : 1;
+  unsigned stbc : 2;
+  unsigned fec_coding : 1;
+  unsigned sgi : 1;
+  signed noise_floor : 8;
+  unsigned ampdu_cnt : 8;
+  unsigned channel : 4;
+  unsigned secondary_channel : 4;
+  unsigned : 8;
+  unsigned timestamp : 32;
+  unsigned : 32;
+  unsigned : 31;
+  unsigned ant : 1;
+  unsigned sig_len : 12;
+  unsigned : 12;
+  unsigned rx_state : 8;
+} wifi_pkt_rx_ctrl_t;
+
+typedef struct {
+  wifi_pkt_rx_ctrl_t rx_ctrl;
+  uint8_t payload[0];
+} wifi_promiscuous_pkt_t;
+
+typedef struct {
+  uint32_t filter_mask;
+} wifi_promiscuous_filter_t;
+
+#define WIFI_PROMIS_FILTER_MASK_ALL (0xFFFFFFFF)
+#define WIFI_PROMIS_FILTER_MASK_MGMT (1)
+#define WIFI_PROMIS_FILTER_MASK_CTRL (1 << 1)
+#define WIFI_PROMIS_FILTER_MASK_DATA (1 << 2)
+#define WIFI_PROMIS_FILTER_MASK_MISC (1 << 3)
+
+typedef void (*wifi_promiscuous_cb_t)(void *buf,
+                                      wifi_promiscuous_pkt_type_t type);
+
+#endif // ESP_WIFI_TYPES_H
@@ -0,0 +1,69 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * main.cpp: runs the sketch on the host, against the simulated esp32
+ */
+
+#include "minigotchi-ESP32.ino"
+#include "sim.h"
+
+/** developer note:
+ *
+ * usage: minigotchi-host [-p] [seconds]
+ *
+ * boots the minigotchi and runs loop() until that many seconds have gone by
+ * on the simulated clock (a minute if you don't say), which only takes a
+ * moment since the scheduler's sleeps skip ahead instead of waiting. serial
+ * output goes to stdout, or with -p to a pseudo terminal whose path gets
+ * printed first, so you can hook the parasite plugin up to it.
+ *
+ */
+
+int main(int argc, char **argv) {
+  unsigned long seconds = 60;
+  bool pty = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-p") == 0) {
+      pty = true;
+    } else {
+      seconds = strtoul(argv[i], nullptr, 10);
+    }
+  }
+
+  if (pty) {
+    std::string path = Sim::serialPty();
+    if (path.empty()) {
+      fprintf(stderr, "couldn't open a pseudo terminal\n");
+      return 1;
+    }
+    printf("serial is on %s\n", path.c_str());
+    fflush(stdout);
+  } else {
+    Sim::serialEcho(true);
+  }
+
+  setup();
+  unsigned long end = millis() + seconds * 1000;
+  while ((long)(millis() - end) < 0) {
+    loop();
+  }
+
+  fflush(stdout);
+  return 0;
+}
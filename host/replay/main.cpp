@@ -0,0 +1,76 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * main.cpp: replays pcap captures through the sniffer on the host
+ */
+
+#include "replay.h"
+#include "sim.h"
+
+/** developer note:
+ *
+ * usage: minigotchi-replay [-v] [-c channel] capture.pcap...
+ *
+ * plays every capture through the sniffer in turn and prints how fast it
+ * went and who we heard from. captures can be plain 802.11 or have radiotap
+ * headers. frames without a radiotap channel count as heard on -c (1 if you
+ * don't say), and -v prints what the minigotchi said about them.
+ *
+ */
+
+int main(int argc, char **argv) {
+  int channel = 1;
+  std::vector<const char *> paths;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) {
+      Replay::output = stdout;
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      channel = atoi(argv[++i]);
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+
+  if (paths.empty()) {
+    fprintf(stderr, "usage: %s [-v] [-c channel] capture.pcap...\n", argv[0]);
+    return 2;
+  }
+
+  Radio::begin();
+  if (!Radio::setChannel(channel)) {
+    fprintf(stderr, "%d isn't a channel\n", channel);
+    return 2;
+  }
+
+  int failed = 0;
+  for (const char *path : paths) {
+    std::vector<uint8_t> pcap;
+    replay_result_t result;
+    printf("%s\n", path);
+    if (!Replay::load(path, &pcap) ||
+        !Replay::run(pcap.data(), pcap.size(), &result)) {
+      fprintf(stderr, "%s: %s\n", path, Replay::error().c_str());
+      failed++;
+      continue;
+    }
+    Replay::print(&result);
+  }
+
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,331 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * replay.cpp: feeds recorded traffic through the sniffer
+ */
+
+#include "replay.h"
+#include "sim.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+/** developer note:
+ *
+ * this plays a pcap capture through Pwnagotchi::pwnagotchiCallback() as fast
+ * as it can, like the driver would hand it frames in a really crowded place.
+ * every frame is dressed up as a wifi_promiscuous_pkt_t with the rssi and
+ * channel out of its radiotap header (or our own channel if it doesn't have
+ * one), and process() runs right after it, so the time we measure per frame
+ * is everything from the callback up to the beacon being handled.
+ *
+ * it runs on the host against the simulated esp32, see main.cpp in here.
+ * every latency is kept, so the percentiles are exact however slow the odd
+ * frame is. that's 4 bytes a frame, a million frame capture costs 4 MB.
+ *
+ * keep in mind a pwnagotchi we haven't heard from before still gets reported
+ * and printed, so those frames show up in the max latency. delay() only
+ * moves the simulated clock, so it doesn't.
+ *
+ */
+
+FILE *Replay::output = nullptr;
+std::vector<uint32_t> Replay::latencies;
+std::string Replay::lastError;
+
+/**
+ * Reads a whole capture into memory, returns false if it can't be read
+ * @param path Capture to read
+ * @param pcap Where to put it
+ */
+bool Replay::load(const char *path, std::vector<uint8_t> *pcap) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return Replay::fail(std::string("Can't open ") + path);
+  }
+
+  pcap->assign(std::istreambuf_iterator<char>(file),
+               std::istreambuf_iterator<char>());
+  return true;
+}
+
+/**
+ * Replays a pcap capture through the sniffer, returns false if it can't be
+ * read
+ * @param pcap Capture to replay
+ * @param length Length of capture
+ * @param result Where to put the results
+ */
+bool Replay::run(const uint8_t *pcap, size_t length,
+                 replay_result_t *result) {
+  memset(result, 0, sizeof(replay_result_t));
+  Replay::latencies.clear();
+
+  if (length < 24) {
+    return Replay::fail("Capture is too short to be a pcap");
+  }
+
+  // microsecond or nanosecond timestamps, written on either kind of machine
+  uint32_t magic = Replay::read32(pcap, false);
+  bool bigEndian;
+  if (magic == 0xa1b2c3d4 || magic == 0xa1b23c4d) {
+    bigEndian = false;
+  } else if (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1) {
+    bigEndian = true;
+  } else {
+    return Replay::fail("Capture is not a pcap");
+  }
+
+  uint32_t linktype = Replay::read32(pcap + 20, bigEndian);
+  if (linktype != REPLAY_LINKTYPE_80211 &&
+      linktype != REPLAY_LINKTYPE_RADIOTAP) {
+    return Replay::fail("Can't replay link type " + std::to_string(linktype));
+  }
+
+  // room for the rx_ctrl header, the largest frame we copy and its fcs
+  std::vector<uint32_t> buffer(
+      (sizeof(wifi_promiscuous_pkt_t) + PWNAGOTCHI_SLOT_SIZE + 4 + 3) / 4);
+  const size_t room = buffer.size() * 4 - sizeof(wifi_promiscuous_pkt_t);
+  wifi_promiscuous_pkt_t *packet = (wifi_promiscuous_pkt_t *)buffer.data();
+
+  Pwnagotchi::reset();
+  auto start = std::chrono::steady_clock::now();
+
+  size_t offset = 24;
+  while (offset + 16 <= length) {
+    uint32_t captured = Replay::read32(pcap + offset + 8, bigEndian);
+    const uint8_t *data = pcap + offset + 16;
+    if (captured > length - offset - 16) {
+      // cut off at the end
+      result->skipped++;
+      break;
+    }
+    offset += 16 + captured;
+
+    int8_t rssi = -50;
+    uint8_t channel = Radio::getChannel();
+    bool fcs = false;
+    uint16_t header = 0;
+    if (linktype == REPLAY_LINKTYPE_RADIOTAP &&
+        !Replay::radiotap(data, captured, &rssi, &channel, &fcs, &header)) {
+      result->skipped++;
+      continue;
+    }
+
+    // the driver always counts the fcs, even though we never look at it
+    uint32_t frameLength = captured - header;
+    uint32_t signalLength = fcs ? frameLength : frameLength + 4;
+    if (frameLength < 2 || signalLength > room) {
+      result->skipped++;
+      continue;
+    }
+
+    memset(&packet->rx_ctrl, 0, sizeof(packet->rx_ctrl));
+    packet->rx_ctrl.rssi = rssi;
+    packet->rx_ctrl.channel = channel;
+    packet->rx_ctrl.sig_len = signalLength;
+    memcpy(packet->payload, data + header, frameLength);
+
+    // frame control type bits, the same way the driver sorts frames
+    wifi_promiscuous_pkt_type_t type = WIFI_PKT_MISC;
+    switch ((data[header] >> 2) & 0x3) {
+    case 0:
+      type = WIFI_PKT_MGMT;
+      break;
+    case 1:
+      type = WIFI_PKT_CTRL;
+      break;
+    case 2:
+      type = WIFI_PKT_DATA;
+      break;
+    }
+
+    auto frameStart = std::chrono::steady_clock::now();
+    Pwnagotchi::pwnagotchiCallback(packet, type);
+    Pwnagotchi::process();
+    std::chrono::nanoseconds latency =
+        std::chrono::steady_clock::now() - frameStart;
+    Replay::latencies.push_back(
+        std::min<int64_t>(latency.count(), UINT32_MAX));
+    result->frames++;
+
+    // whatever got printed about it, outside of the time we measured
+    std::string output = Sim::serialOutput();
+    if (Replay::output != nullptr) {
+      fwrite(output.data(), 1, output.size(), Replay::output);
+    }
+  }
+
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+  result->elapsed = elapsed.count();
+
+  std::sort(Replay::latencies.begin(), Replay::latencies.end());
+  result->p50 = Replay::percentile(50);
+  result->p90 = Replay::percentile(90);
+  result->p99 = Replay::percentile(99);
+  result->max = Replay::percentile(100);
+  result->heard = Pwnagotchi::heard();
+  return true;
+}
+
+/**
+ * Prints how a replay went
+ * @param result Results to print
+ */
+void Replay::print(const replay_result_t *result) {
+  printf("Replayed %u frames in %.1f ms, %.0f frames/s\n", result->frames,
+         result->elapsed / 1000,
+         result->elapsed > 0 ? result->frames * 1e6 / result->elapsed : 0);
+  printf("Latency p50 %.2f us, p90 %.2f us, p99 %.2f us, max %.2f us\n",
+         result->p50, result->p90, result->p99, result->max);
+  printf("Heard from %d Pwnagotchi, skipped %u records\n", result->heard,
+         result->skipped);
+}
+
+/**
+ * Returns why the last load() or run() failed
+ */
+const std::string &Replay::error() { return Replay::lastError; }
+
+/**
+ * Remembers why we failed, and fails
+ * @param error What went wrong
+ */
+bool Replay::fail(const std::string &error) {
+  Replay::lastError = error;
+  return false;
+}
+
+/** developer note:
+ *
+ * radiotap fields are little endian and aligned to their own size from the
+ * start of the header, so we walk the present bits in order and round the
+ * offset up before each one. we only need flags (for the fcs), channel and
+ * signal, which are all in the first bitmap before anything odd shows up.
+ *
+ */
+
+/**
+ * Reads what we need out of a radiotap header, returns false if it's broken
+ * @param data Record to read
+ * @param length Length of record
+ * @param rssi Where to put the signal strength
+ * @param channel Where to put the channel
+ * @param fcs Where to put whether the frame still has its fcs
+ * @param headerLength Where to put the length of the header
+ */
+bool Replay::radiotap(const uint8_t *data, uint32_t length, int8_t *rssi,
+                      uint8_t *channel, bool *fcs, uint16_t *headerLength) {
+  // tsft, flags, rate, channel, fhss, antenna signal
+  static const uint8_t sizes[] = {8, 1, 1, 4, 2, 1};
+  static const uint8_t aligns[] = {8, 1, 1, 2, 1, 1};
+
+  if (length < 8 || data[0] != 0) {
+    return false;
+  }
+
+  uint16_t headerEnd = Replay::read16(data + 2, false);
+  if (headerEnd < 8 || headerEnd > length) {
+    return false;
+  }
+
+  // skip any extra present bitmaps
+  uint32_t present = Replay::read32(data + 4, false);
+  uint32_t offset = 8;
+  uint32_t word = present;
+  while (word & 0x80000000) {
+    if (offset + 4 > headerEnd) {
+      return false;
+    }
+    word = Replay::read32(data + offset, false);
+    offset += 4;
+  }
+
+  for (uint8_t bit = 0; bit < sizeof(sizes); bit++) {
+    if (!(present & (1UL << bit))) {
+      continue;
+    }
+
+    offset = (offset + aligns[bit] - 1) & ~(uint32_t)(aligns[bit] - 1);
+    if (offset + sizes[bit] > headerEnd) {
+      return false;
+    }
+
+    if (bit == 1) {
+      *fcs = (data[offset] & 0x10) != 0;
+    } else if (bit == 3) {
+      *channel = Replay::frequencyChannel(Replay::read16(data + offset, false));
+    } else if (bit == 5) {
+      *rssi = (int8_t)data[offset];
+    }
+    offset += sizes[bit];
+  }
+
+  *headerLength = headerEnd;
+  return true;
+}
+
+/**
+ * Turns a 2.4 GHz frequency into a channel, 0 if it isn't one
+ * @param frequency Frequency in MHz
+ */
+uint8_t Replay::frequencyChannel(uint16_t frequency) {
+  if (frequency == 2484) {
+    return 14;
+  } else if (frequency >= 2412 && frequency <= 2472) {
+    return (frequency - 2407) / 5;
+  }
+  return 0;
+}
+
+/**
+ * Finds the latency a percentage of frames came in under, in microseconds
+ * @param percent Percentage to find
+ */
+double Replay::percentile(uint8_t percent) {
+  size_t frames = Replay::latencies.size();
+  if (frames == 0) {
+    return 0;
+  }
+
+  size_t wanted = ((uint64_t)frames * percent + 99) / 100;
+  return Replay::latencies[std::max<size_t>(wanted, 1) - 1] / 1000.0;
+}
+
+/**
+ * Reads a 16 bit value
+ * @param data Where to read from
+ * @param bigEndian Whether it's stored big endian
+ */
+uint16_t Replay::read16(const uint8_t *data, bool bigEndian) {
+  return bigEndian ? (data[0] << 8) | data[1] : data[0] | (data[1] << 8);
+}
+
+/**
+ * Reads a 32 bit value
+ * @param data Where to read from
+ * @param bigEndian Whether it's stored big endian
+ */
+uint32_t Replay::read32(const uint8_t *data, bool bigEndian) {
+  return bigEndian ? ((uint32_t)Replay::read16(data, true) << 16) |
+                         Replay::read16(data + 2, true)
+                   : Replay::read16(data, false) |
+                         ((uint32_t)Replay::read16(data + 2, false) << 16);
+}
@@ -0,0 +1,73 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * replay.h: header files for replay.cpp
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "pwnagotchi.h"
+#include <esp_wifi_types.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// pcap link types we can read
+#define REPLAY_LINKTYPE_80211 105
+#define REPLAY_LINKTYPE_RADIOTAP 127
+
+// how a replay went, latencies are in microseconds
+typedef struct {
+  uint32_t frames;
+  uint32_t skipped;
+  double elapsed;
+  double p50;
+  double p90;
+  double p99;
+  double max;
+  int heard;
+} replay_result_t;
+
+class Replay {
+public:
+  static bool load(const char *path, std::vector<uint8_t> *pcap);
+  static bool run(const uint8_t *pcap, size_t length, replay_result_t *result);
+  static void print(const replay_result_t *result);
+  static const std::string &error();
+
+  // where what the minigotchi printed goes, nowhere if null
+  static FILE *output;
+
+private:
+  static bool fail(const std::string &error);
+  static bool radiotap(const uint8_t *data, uint32_t length, int8_t *rssi,
+                       uint8_t *channel, bool *fcs, uint16_t *headerLength);
+  static uint8_t frequencyChannel(uint16_t frequency);
+  static double percentile(uint8_t percent);
+  static uint16_t read16(const uint8_t *data, bool swap);
+  static uint32_t read32(const uint8_t *data, bool swap);
+
+  // every frame's latency in nanoseconds, sorted once the replay is done
+  static std::vector<uint32_t> latencies;
+  static std::string lastError;
+};
+
+#endif // REPLAY_H
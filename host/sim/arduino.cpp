@@ -0,0 +1,374 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * arduino.cpp: String, Print and the rest of the arduino core on the host
+ */
+
+#include "sim.h"
+#include <Arduino.h>
+#include <SPI.h>
+#include <Wire.h>
+#include <random>
+#include <stdarg.h>
+
+EspClass ESP;
+TwoWire Wire;
+TwoWire Wire1;
+SPIClass SPI;
+
+/**
+ * Formats an integer in some base
+ * @param value Value to format
+ * @param negative Whether to put a minus in front
+ * @param base Base to use, 2 to 16
+ */
+static std::string formatInteger(unsigned long long value, bool negative,
+                                 int base) {
+  if (base < 2 || base > 16) {
+    base = 10;
+  }
+
+  char buf[68];
+  char *end = buf + sizeof(buf);
+  char *pos = end;
+  do {
+    *--pos = "0123456789ABCDEF"[value % base];
+    value /= base;
+  } while (value > 0);
+  if (negative) {
+    *--pos = '-';
+  }
+  return std::string(pos, end - pos);
+}
+
+/**
+ * Formats a signed integer, only base 10 gets a minus like arduino does
+ * @param value Value to format
+ * @param base Base to use
+ */
+static std::string formatSigned(long long value, int base) {
+  if (base == 10 && value < 0) {
+    return formatInteger(-(unsigned long long)value, true, base);
+  }
+  return formatInteger((unsigned long long)value, false, base);
+}
+
+/**
+ * Formats a float with a fixed number of decimals
+ * @param value Value to format
+ * @param decimals How many decimals
+ */
+static std::string formatFloat(double value, int decimals) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+  return buf;
+}
+
+String::String(unsigned char value, unsigned char base)
+    : value(formatInteger(value, false, base)) {}
+String::String(int value, unsigned char base)
+    : value(formatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base)
+    : value(formatInteger(value, false, base)) {}
+String::String(long value, unsigned char base)
+    : value(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base)
+    : value(formatInteger(value, false, base)) {}
+String::String(long long value, unsigned char base)
+    : value(formatSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base)
+    : value(formatInteger(value, false, base)) {}
+String::String(float value, unsigned int decimals)
+    : value(formatFloat(value, decimals)) {}
+String::String(double value, unsigned int decimals)
+    : value(formatFloat(value, decimals)) {}
+
+bool String::reserve(unsigned int size) {
+  this->value.reserve(size);
+  return true;
+}
+
+bool String::concat(const String &other) {
+  this->value += other.value;
+  return true;
+}
+
+bool String::concat(const char *other) {
+  if (other == nullptr) {
+    return false;
+  }
+  this->value += other;
+  return true;
+}
+
+bool String::concat(char c) {
+  this->value += c;
+  return true;
+}
+
+String &String::operator+=(const String &other) {
+  this->concat(other);
+  return *this;
+}
+
+String &String::operator+=(const char *other) {
+  this->concat(other);
+  return *this;
+}
+
+String &String::operator+=(char c) {
+  this->concat(c);
+  return *this;
+}
+
+bool String::equals(const char *other) const {
+  return this->value == (other != nullptr ? other : "");
+}
+
+bool String::startsWith(const String &prefix) const {
+  return this->value.compare(0, prefix.value.length(), prefix.value) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+  return this->value.length() >= suffix.value.length() &&
+         this->value.compare(this->value.length() - suffix.value.length(),
+                             suffix.value.length(), suffix.value) == 0;
+}
+
+char String::charAt(unsigned int index) const {
+  return index < this->value.length() ? this->value[index] : 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t found = this->value.find(c, from);
+  return found == std::string::npos ? -1 : (int)found;
+}
+
+int String::indexOf(const String &other, unsigned int from) const {
+  size_t found = this->value.find(other.value, from);
+  return found == std::string::npos ? -1 : (int)found;
+}
+
+String String::substring(unsigned int from) const {
+  return this->substring(from, this->value.length());
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    std::swap(from, to);
+  }
+  if (from >= this->value.length()) {
+    return String();
+  }
+  to = std::min<unsigned int>(to, this->value.length());
+  return String(this->value.c_str() + from, to - from);
+}
+
+void String::trim() {
+  size_t first = this->value.find_first_not_of(" \t\r\n\f\v");
+  if (first == std::string::npos) {
+    this->value.clear();
+    return;
+  }
+  size_t last = this->value.find_last_not_of(" \t\r\n\f\v");
+  this->value = this->value.substr(first, last - first + 1);
+}
+
+long String::toInt() const { return atol(this->value.c_str()); }
+
+float String::toFloat() const { return atof(this->value.c_str()); }
+
+String operator+(const String &a, const String &b) {
+  String sum(a);
+  sum.concat(b);
+  return sum;
+}
+
+String operator+(const String &a, const char *b) {
+  String sum(a);
+  sum.concat(b);
+  return sum;
+}
+
+String operator+(const char *a, const String &b) {
+  String sum(a);
+  sum.concat(b);
+  return sum;
+}
+
+String operator+(const String &a, char b) { return a + String(b); }
+String operator+(const String &a, int b) { return a + String(b); }
+String operator+(const String &a, unsigned int b) { return a + String(b); }
+String operator+(const String &a, long b) { return a + String(b); }
+String operator+(const String &a, unsigned long b) { return a + String(b); }
+String operator+(const String &a, float b) { return a + String(b); }
+String operator+(const String &a, double b) { return a + String(b); }
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t written = 0;
+  while (size-- > 0 && this->write(*buffer++) == 1) {
+    written++;
+  }
+  return written;
+}
+
+size_t Print::printf(const char *format, ...) {
+  char buf[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (length < 0) {
+    return 0;
+  }
+
+  if ((size_t)length < sizeof(buf)) {
+    return this->write((const uint8_t *)buf, length);
+  }
+
+  std::string big(length + 1, '\0');
+  va_start(args, format);
+  vsnprintf(&big[0], big.size(), format, args);
+  va_end(args);
+  return this->write((const uint8_t *)big.data(), length);
+}
+
+size_t Print::print(const String &value) {
+  return this->write((const uint8_t *)value.c_str(), value.length());
+}
+size_t Print::print(const char *value) { return this->write(value); }
+size_t Print::print(char value) { return this->write((uint8_t)value); }
+size_t Print::print(unsigned char value, int base) {
+  return this->print(String(value, base));
+}
+size_t Print::print(int value, int base) {
+  return this->print(String(value, base));
+}
+size_t Print::print(unsigned int value, int base) {
+  return this->print(String(value, base));
+}
+size_t Print::print(long value, int base) {
+  return this->print(String(value, base));
+}
+size_t Print::print(unsigned long value, int base) {
+  return this->print(String(value, base));
+}
+size_t Print::print(long long value, int base) {
+  return this->print(String(value, base));
+}
+size_t Print::print(unsigned long long value, int base) {
+  return this->print(String(value, base));
+}
+size_t Print::print(double value, int decimals) {
+  return this->print(String(value, decimals));
+}
+
+size_t Print::println() { return this->write("\r\n"); }
+size_t Print::println(const String &value) {
+  return this->print(value) + this->println();
+}
+size_t Print::println(const char *value) {
+  return this->print(value) + this->println();
+}
+size_t Print::println(char value) {
+  return this->print(value) + this->println();
+}
+size_t Print::println(unsigned char value, int base) {
+  return this->print(value, base) + this->println();
+}
+size_t Print::println(int value, int base) {
+  return this->print(value, base) + this->println();
+}
+size_t Print::println(unsigned int value, int base) {
+  return this->print(value, base) + this->println();
+}
+size_t Print::println(long value, int base) {
+  return this->print(value, base) + this->println();
+}
+size_t Print::println(unsigned long value, int base) {
+  return this->print(value, base) + this->println();
+}
+size_t Print::println(long long value, int base) {
+  return this->print(value, base) + this->println();
+}
+size_t Print::println(unsigned long long value, int base) {
+  return this->print(value, base) + this->println();
+}
+size_t Print::println(double value, int decimals) {
+  return this->print(value, decimals) + this->println();
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  if (inMax == inMin) {
+    return outMin;
+  }
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+/**
+ * The random numbers the sketch gets, the same ones every run
+ */
+static std::mt19937 &generator() {
+  static std::mt19937 generator(1);
+  return generator;
+}
+
+long random(long max) {
+  if (max <= 0) {
+    return 0;
+  }
+  return generator()() % max;
+}
+
+long random(long min, long max) {
+  if (min >= max) {
+    return min;
+  }
+  return min + random(max - min);
+}
+
+void randomSeed(unsigned long seed) { generator().seed(seed); }
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {}
+
+int digitalRead(uint8_t pin) { return LOW; }
+
+uint32_t EspClass::getFreeHeap() { return 320 * 1024; }
+
+uint32_t EspClass::getMinFreeHeap() { return 320 * 1024; }
+
+uint32_t EspClass::getCpuFreqMHz() { return 240; }
+
+void EspClass::restart() { exit(0); }
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) { return true; }
+bool TwoWire::setClock(uint32_t frequency) { return true; }
+void TwoWire::beginTransmission(uint16_t address) {}
+uint8_t TwoWire::endTransmission(bool stop) { return 0; }
+uint8_t TwoWire::requestFrom(uint16_t address, uint8_t size, bool stop) {
+  return size;
+}
+size_t TwoWire::write(uint8_t c) { return 1; }
+size_t TwoWire::write(const uint8_t *buffer, size_t size) { return size; }
+int TwoWire::available() { return 0; }
+int TwoWire::read() { return 0; }
+
+void SPIClass::begin(int8_t sck, int8_t miso, int8_t mosi, int8_t ss) {}
@@ -0,0 +1,100 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * clock.cpp: the simulated clock behind millis() and friends
+ */
+
+#include "sim.h"
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/**
+ * How far the clock has been pushed ahead of real time, in microseconds
+ */
+static std::atomic<uint64_t> &skipped() {
+  static std::atomic<uint64_t> skipped(0);
+  return skipped;
+}
+
+/**
+ * When the clock started, the first time anything asks for the time
+ */
+static std::chrono::steady_clock::time_point start() {
+  static const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  return start;
+}
+
+/**
+ * Returns the time since boot in microseconds
+ */
+uint64_t Sim::now() {
+  std::chrono::steady_clock::duration real =
+      std::chrono::steady_clock::now() - start();
+  return std::chrono::duration_cast<std::chrono::microseconds>(real).count() +
+         skipped().load();
+}
+
+/**
+ * Pushes the clock ahead without waiting
+ * @param ms Milliseconds to skip
+ */
+void Sim::advance(unsigned long ms) { skipped() += (uint64_t)ms * 1000; }
+
+unsigned long millis() { return Sim::now() / 1000; }
+
+unsigned long micros() { return Sim::now(); }
+
+int64_t esp_timer_get_time() { return Sim::now(); }
+
+void delay(unsigned long ms) {
+  Sim::advance(ms);
+  std::this_thread::yield();
+}
+
+void delayMicroseconds(unsigned int us) { skipped() += us; }
+
+void yield() { std::this_thread::yield(); }
+
+// how long light sleep lasts, 0 if only something else can wake us up
+static uint64_t wakeup = 0;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+  wakeup = time_in_us;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source) {
+  if (source == ESP_SLEEP_WAKEUP_TIMER || source == ESP_SLEEP_WAKEUP_ALL) {
+    wakeup = 0;
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_light_sleep_start() {
+  skipped() += wakeup;
+  return ESP_OK;
+}
+
+// nothing wakes the host back up from deep sleep
+void esp_deep_sleep_start() { exit(0); }
+
+void esp_deep_sleep(uint64_t time_in_us) { exit(0); }
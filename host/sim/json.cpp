@@ -0,0 +1,185 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * json.cpp: the little bit of ArduinoJson the sketch needs
+ */
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Quotes and escapes a string for json
+ * @param value String to quote
+ */
+static std::string quote(const char *value) {
+  std::string json = "\"";
+  for (const char *c = value; *c != '\0'; c++) {
+    switch (*c) {
+    case '"':
+      json += "\\\"";
+      break;
+    case '\\':
+      json += "\\\\";
+      break;
+    case '\n':
+      json += "\\n";
+      break;
+    case '\r':
+      json += "\\r";
+      break;
+    case '\t':
+      json += "\\t";
+      break;
+    default:
+      if ((uint8_t)*c < 0x20) {
+        char hex[8];
+        snprintf(hex, sizeof(hex), "\\u%04x", (uint8_t)*c);
+        json += hex;
+      } else {
+        json += *c;
+      }
+    }
+  }
+  return json + "\"";
+}
+
+JsonVariant &JsonVariant::operator=(const char *value) {
+  this->doc->set(this->parent, this->key,
+                 value != nullptr ? quote(value) : "null");
+  return *this;
+}
+
+JsonVariant &JsonVariant::operator=(const String &value) {
+  return *this = value.c_str();
+}
+
+JsonVariant &JsonVariant::operator=(const std::string &value) {
+  return *this = value.c_str();
+}
+
+JsonVariant &JsonVariant::operator=(long value) {
+  this->doc->set(this->parent, this->key, std::to_string(value));
+  return *this;
+}
+
+JsonVariant &JsonVariant::operator=(bool value) {
+  this->doc->set(this->parent, this->key, value ? "true" : "false");
+  return *this;
+}
+
+/**
+ * Sets a member in a list of them, keeping the order they were first set in
+ * @param members Members to set it in
+ * @param key Name of the member
+ * @param json Its value, already serialized
+ */
+static void setMember(json_members_t &members, const char *key,
+                      const std::string &json) {
+  for (std::pair<std::string, std::string> &member : members) {
+    if (member.first == key) {
+      member.second = json;
+      return;
+    }
+  }
+  members.push_back(std::make_pair(std::string(key), json));
+}
+
+/**
+ * Writes a list of members out as an object
+ * @param members Members to write
+ */
+static std::string serializeMembers(const json_members_t &members) {
+  std::string json = "{";
+  for (size_t i = 0; i < members.size(); i++) {
+    if (i > 0) {
+      json += ",";
+    }
+    json += quote(members[i].first.c_str()) + ":" + members[i].second;
+  }
+  return json + "}";
+}
+
+/**
+ * Sets a member, keeping the order they were first set in
+ * @param parent Object the member is in, null for the document itself
+ * @param key Name of the member
+ * @param json Its value, already serialized
+ */
+void JsonDocument::set(const char *parent, const char *key,
+                       const std::string &json) {
+  const char *name = parent != nullptr ? parent : key;
+  json_member_t *member = nullptr;
+  for (json_member_t &existing : this->members) {
+    if (existing.key == name) {
+      member = &existing;
+      break;
+    }
+  }
+  if (member == nullptr) {
+    this->members.push_back(json_member_t());
+    member = &this->members.back();
+    member->key = name;
+  }
+
+  if (parent != nullptr) {
+    setMember(member->members, key, json);
+  } else {
+    member->members.clear();
+    member->json = json;
+  }
+}
+
+/**
+ * Writes the whole object out
+ */
+std::string JsonDocument::serialize() const {
+  std::string json = "{";
+  for (size_t i = 0; i < this->members.size(); i++) {
+    if (i > 0) {
+      json += ",";
+    }
+    const json_member_t &member = this->members[i];
+    json += quote(member.key.c_str()) + ":" +
+            (member.members.empty() ? member.json
+                                    : serializeMembers(member.members));
+  }
+  return json + "}";
+}
+
+size_t serializeJson(const JsonDocument &doc, char *output, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+
+  std::string json = doc.serialize();
+  size_t length = json.size() < size - 1 ? json.size() : size - 1;
+  memcpy(output, json.data(), length);
+  output[length] = '\0';
+  return length;
+}
+
+size_t serializeJson(const JsonDocument &doc, String &output) {
+  std::string json = doc.serialize();
+  output = json.c_str();
+  return json.size();
+}
+
+size_t measureJson(const JsonDocument &doc) { return doc.serialize().size(); }
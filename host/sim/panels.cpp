@@ -0,0 +1,346 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * panels.cpp: the screen drivers, drawing into memory
+ */
+
+#include "sim.h"
+#include <Adafruit_GFX.h>
+#include <Adafruit_SSD1305.h>
+#include <Adafruit_SSD1306.h>
+#include <TFT_eSPI.h>
+#include <U8g2lib.h>
+#include <atomic>
+
+/** developer note:
+ *
+ * none of these talk to a real panel, but they all draw into a frame buffer
+ * laid out like the real one and count every byte that would have gone over
+ * i2c or spi (see Sim::panelBytes()). that's what costs time on the board,
+ * so it's what the host can say about how the display backends compare.
+ *
+ */
+
+static std::atomic<uint32_t> &panelBytes() {
+  static std::atomic<uint32_t> &bytes = *new std::atomic<uint32_t>(0);
+  return bytes;
+}
+
+/**
+ * Returns how many bytes went to the screen so far
+ */
+uint32_t Sim::panelBytes() { return ::panelBytes().load(); }
+
+/**
+ * Counts bytes going to the screen
+ * @param bytes How many
+ */
+void Sim::panelSent(uint32_t bytes) { ::panelBytes() += bytes; }
+
+static std::atomic<uint32_t> &glyphLookups() {
+  static std::atomic<uint32_t> &lookups = *new std::atomic<uint32_t>(0);
+  return lookups;
+}
+
+/**
+ * Returns how many times u8g2 looked up a glyph so far, every one of them
+ * walks the font's glyph table on the board
+ */
+uint32_t Sim::glyphLookups() { return ::glyphLookups().load(); }
+
+/**
+ * Makes up which rows of a glyph's column are lit
+ * @param c Glyph
+ * @param column Column of the glyph
+ */
+static uint8_t glyphColumn(uint8_t c, uint8_t column) {
+  if (c == ' ') {
+    return 0;
+  }
+  return (uint8_t)((c * 37 + column * 11) ^ (c >> 1)) | 0x01;
+}
+
+Adafruit_GFX::Adafruit_GFX(int16_t width, int16_t height)
+    : w(width), h(height) {}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                            uint16_t color) {
+  for (int16_t i = x; i < x + w; i++) {
+    for (int16_t j = y; j < y + h; j++) {
+      this->drawPixel(i, j, color);
+    }
+  }
+}
+
+void Adafruit_GFX::fillScreen(uint16_t color) {
+  this->fillRect(0, 0, this->w, this->h, color);
+}
+
+void Adafruit_GFX::setCursor(int16_t x, int16_t y) {
+  this->cursorX = x;
+  this->cursorY = y;
+}
+
+void Adafruit_GFX::setTextSize(uint8_t size) {
+  this->textSize = size > 0 ? size : 1;
+}
+
+void Adafruit_GFX::setTextColor(uint16_t color) { this->textColor = color; }
+
+void Adafruit_GFX::setTextColor(uint16_t color, uint16_t background) {
+  this->textColor = color;
+}
+
+void Adafruit_GFX::setTextWrap(bool wrap) { this->wrap = wrap; }
+
+void Adafruit_GFX::setRotation(uint8_t rotation) {
+  // the panels start out upright, odd rotations turn them on their side
+  if ((rotation & 1) != (this->w > this->h)) {
+    int16_t w = this->w;
+    this->w = this->h;
+    this->h = w;
+  }
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+  uint8_t size = this->textSize;
+  if (c == '\n') {
+    this->cursorX = 0;
+    this->cursorY += 8 * size;
+    return 1;
+  } else if (c == '\r') {
+    return 1;
+  }
+
+  if (this->wrap && this->cursorX + 6 * size > this->w) {
+    this->cursorX = 0;
+    this->cursorY += 8 * size;
+  }
+
+  for (uint8_t column = 0; column < 5; column++) {
+    uint8_t bits = glyphColumn(c, column);
+    for (uint8_t row = 0; row < 8; row++) {
+      if (bits & (1 << row)) {
+        this->fillRect(this->cursorX + column * size,
+                       this->cursorY + row * size, size, size,
+                       this->textColor);
+      }
+    }
+  }
+  this->cursorX += 6 * size;
+  return 1;
+}
+
+/**
+ * Sets a pixel in a page laid out 1 bit frame buffer
+ * @param buffer Frame buffer
+ * @param width Width of the screen
+ * @param height Height of the screen
+ * @param x X of the pixel
+ * @param y Y of the pixel
+ * @param color BLACK, WHITE or 2 to invert
+ */
+static void pagePixel(uint8_t *buffer, int16_t width, int16_t height,
+                      int16_t x, int16_t y, uint16_t color) {
+  if (x < 0 || y < 0 || x >= width || y >= height) {
+    return;
+  }
+
+  uint8_t *byte = &buffer[x + (y / 8) * width];
+  uint8_t bit = 1 << (y & 7);
+  if (color == BLACK) {
+    *byte &= ~bit;
+  } else if (color == WHITE) {
+    *byte |= bit;
+  } else {
+    *byte ^= bit;
+  }
+}
+
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t width, uint8_t height,
+                                   TwoWire *wire, int8_t reset)
+    : Adafruit_GFX(width, height),
+      buffer(new uint8_t[width * ((height + 7) / 8)]()) {}
+
+Adafruit_SSD1306::Adafruit_SSD1306(int8_t reset)
+    : Adafruit_SSD1306(64, 48, &Wire, reset) {}
+
+Adafruit_SSD1306::~Adafruit_SSD1306() { delete[] this->buffer; }
+
+bool Adafruit_SSD1306::begin(uint8_t vcc, uint8_t address) { return true; }
+
+void Adafruit_SSD1306::display() {
+  Sim::panelSent(this->w * ((this->h + 7) / 8));
+}
+
+void Adafruit_SSD1306::clearDisplay() {
+  memset(this->buffer, 0, this->w * ((this->h + 7) / 8));
+}
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  pagePixel(this->buffer, this->w, this->h, x, y, color);
+}
+
+Adafruit_SSD1305::Adafruit_SSD1305(uint16_t width, uint16_t height,
+                                   SPIClass *spi, int8_t dc, int8_t reset,
+                                   int8_t cs, uint32_t bitrate)
+    : Adafruit_GFX(width, height),
+      buffer(new uint8_t[width * ((height + 7) / 8)]()) {}
+
+Adafruit_SSD1305::~Adafruit_SSD1305() { delete[] this->buffer; }
+
+bool Adafruit_SSD1305::begin(uint8_t address, bool reset) { return true; }
+
+void Adafruit_SSD1305::display() {
+  Sim::panelSent(this->w * ((this->h + 7) / 8));
+}
+
+void Adafruit_SSD1305::clearDisplay() {
+  memset(this->buffer, 0, this->w * ((this->h + 7) / 8));
+}
+
+void Adafruit_SSD1305::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  pagePixel(this->buffer, this->w, this->h, x, y, color);
+}
+
+TFT_eSPI::TFT_eSPI() : Adafruit_GFX(240, 320) {}
+
+void TFT_eSPI::begin() {}
+
+void TFT_eSPI::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  // no frame buffer, every pixel is 16 bits straight to the panel
+  if (x >= 0 && y >= 0 && x < this->w && y < this->h) {
+    Sim::panelSent(2);
+  }
+}
+
+const uint8_t u8g2_font_6x10_tr[] = {6, 10, 8};
+const uint8_t u8g2_font_10x20_tr[] = {10, 20, 15};
+
+static const u8g2_cb_t rotation0 = {};
+const u8g2_cb_t *const U8G2_R0 = &rotation0;
+
+int8_t u8g2_GetGlyphWidth(u8g2_t *u8g2, uint16_t encoding) {
+  ::glyphLookups()++;
+  if (u8g2->font == nullptr || encoding < ' ' || encoding > '~') {
+    return -1;
+  }
+  return u8g2->font[0];
+}
+
+U8G2::U8G2(uint8_t tileWidth, uint8_t tileHeight)
+    : tileWidth(tileWidth), tileHeight(tileHeight),
+      buffer(new uint8_t[tileWidth * 8 * tileHeight]()) {
+  this->u8g2.font = nullptr;
+}
+
+U8G2::~U8G2() { delete[] this->buffer; }
+
+bool U8G2::begin() {
+  this->clearBuffer();
+  this->sendBuffer();
+  return true;
+}
+
+void U8G2::clearBuffer() {
+  memset(this->buffer, 0, this->tileWidth * 8 * this->tileHeight);
+}
+
+void U8G2::sendBuffer() {
+  Sim::panelSent(this->tileWidth * 8 * this->tileHeight);
+}
+
+void U8G2::updateDisplayArea(uint8_t tx, uint8_t ty, uint8_t tw, uint8_t th) {
+  Sim::panelSent(tw * th * 8);
+}
+
+void U8G2::setFont(const uint8_t *font) { this->u8g2.font = font; }
+
+void U8G2::setDrawColor(uint8_t color) { this->color = color; }
+
+void U8G2::drawPixel(u8g2_uint_t x, u8g2_uint_t y) {
+  if (x >= this->getWidth() || y >= this->getHeight()) {
+    return;
+  }
+
+  uint8_t *byte = &this->buffer[(y / 8) * this->tileWidth * 8 + x];
+  uint8_t bit = 1 << (y & 7);
+  if (this->color == 0) {
+    *byte &= ~bit;
+  } else if (this->color == 1) {
+    *byte |= bit;
+  } else {
+    *byte ^= bit;
+  }
+}
+
+void U8G2::drawBox(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w,
+                   u8g2_uint_t h) {
+  for (int i = x; i < x + w; i++) {
+    for (int j = y; j < y + h; j++) {
+      this->drawPixel(i, j);
+    }
+  }
+}
+
+u8g2_uint_t U8G2::drawStr(u8g2_uint_t x, u8g2_uint_t y, const char *s) {
+  if (this->u8g2.font == nullptr) {
+    return 0;
+  }
+
+  // y is the baseline, the cell starts ascent pixels above it
+  int top = (int)y - this->u8g2.font[2];
+  int start = x;
+  for (; *s != '\0'; s++) {
+    int8_t width = u8g2_GetGlyphWidth(&this->u8g2, (uint8_t)*s);
+    if (width <= 0) {
+      continue;
+    }
+
+    for (int column = 0; column < width - 1; column++) {
+      uint8_t bits = glyphColumn(*s, column);
+      for (int row = 0; row < this->u8g2.font[1]; row++) {
+        if (top + row >= 0 && (bits & (1 << (row & 7)))) {
+          this->drawPixel(x + column, top + row);
+        }
+      }
+    }
+    x += width;
+  }
+  return x - start;
+}
+
+u8g2_uint_t U8G2::getStrWidth(const char *s) {
+  int width = 0;
+  for (; *s != '\0'; s++) {
+    int8_t glyph = u8g2_GetGlyphWidth(&this->u8g2, (uint8_t)*s);
+    width += glyph > 0 ? glyph : 0;
+  }
+  return width;
+}
+
+int8_t U8G2::getMaxCharWidth() {
+  return this->u8g2.font != nullptr ? this->u8g2.font[0] : 0;
+}
+
+int8_t U8G2::getMaxCharHeight() {
+  return this->u8g2.font != nullptr ? this->u8g2.font[1] : 0;
+}
+
+size_t U8G2::write(uint8_t c) { return 1; }
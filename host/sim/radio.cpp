@@ -0,0 +1,378 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * radio.cpp: the simulated radio, swapped in for minigotchi-ESP32/radio.cpp
+ */
+
+#include "sim.h"
+#include "capture.h"
+#include "mood.h"
+#include "radio.h"
+#include <mutex>
+
+/** developer note:
+ *
+ * this is the same Radio the sketch uses on the board, only nothing goes
+ * over the air. frames we send are kept for tests to look at, frames tests
+ * hand to Sim::receive() go to whoever is listening like the driver would
+ * hand them over, and scans find whatever networks were added with
+ * Sim::addNetwork(), after the same 300 ms per channel the real one takes.
+ *
+ * sending still posts tx failures to Mood and records to Capture, since
+ * that's part of what Radio does and not part of the driver.
+ *
+ */
+
+typedef struct {
+  std::mutex lock;
+  bool started = false;
+  wifi_mode_t mode = WIFI_MODE_NULL;
+  uint8_t channel = 1;
+  uint32_t hops = 0;
+  bool promiscuous = false;
+  wifi_promiscuous_cb_t callback = nullptr;
+  std::vector<sim_frame_t> sent;
+  uint32_t failures = 0;
+  std::vector<sim_network_t> networks;
+  std::vector<sim_network_t> results;
+  bool scanning = false;
+  bool scanned = false;
+  uint8_t scanChannel = 0;
+  unsigned long scanDone = 0;
+} sim_radio_t;
+
+// never freed, the driver outlives main() on the board too
+static sim_radio_t &radio = *new sim_radio_t();
+
+// how long a scan spends on every channel, in milliseconds
+static const unsigned long scanDwell = 300;
+
+const int Radio::scanRunning;
+const int Radio::scanFailed;
+
+/**
+ * Brings the simulated driver up in station mode
+ */
+void Radio::begin() {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  radio.started = true;
+  radio.mode = WIFI_MODE_STA;
+}
+
+/**
+ * Switches between station and access point mode
+ * @param mode Mode to switch to
+ */
+void Radio::mode(wifi_mode_t mode) {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  radio.mode = mode;
+}
+
+/**
+ * Nothing to disconnect from
+ */
+void Radio::disconnect() {}
+
+/**
+ * Keeps a frame instead of sending it, returns whether the driver took it
+ * @param interface Interface to send on
+ * @param frame Frame to send
+ * @param length Length of frame
+ * @param sysSeq Let the driver fill in the sequence number
+ */
+bool Radio::send(wifi_interface_t interface, const uint8_t *frame,
+                 uint16_t length, bool sysSeq) {
+  bool sent = false;
+  {
+    std::lock_guard<std::mutex> guard(radio.lock);
+    if (radio.failures > 0) {
+      radio.failures--;
+    } else if (radio.started) {
+      radio.sent.push_back(sim_frame_t{interface, radio.channel,
+                                       std::vector<uint8_t>(frame,
+                                                            frame + length)});
+      sent = true;
+    }
+  }
+
+  if (!sent) {
+    Mood::post(MOOD_EVENT_TX_FAILURE);
+    return false;
+  }
+
+  // asking the driver for the channel isn't free, only do it to record
+  if (Config::capture) {
+    Capture::sent(frame, length, Radio::getChannel());
+  }
+  return true;
+}
+
+/**
+ * Tunes to a channel, returns whether it worked
+ * @param channel Channel to tune to
+ */
+bool Radio::setChannel(uint8_t channel) {
+  if (channel < 1 || channel > 14) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> guard(radio.lock);
+  radio.channel = channel;
+  radio.hops++;
+  return true;
+}
+
+/**
+ * Returns the channel we're tuned to
+ */
+uint8_t Radio::getChannel() {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  return radio.channel;
+}
+
+/**
+ * Checks if we're in promiscuous mode
+ */
+bool Radio::promiscuous() {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  return radio.promiscuous;
+}
+
+/**
+ * Turns promiscuous mode on or off
+ * @param enable Whether to sniff
+ */
+void Radio::promiscuous(bool enable) {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  radio.promiscuous = enable;
+}
+
+/**
+ * Sets what gets every sniffed frame, nullptr stops it
+ * @param callback Callback to hand frames to
+ */
+void Radio::listen(wifi_promiscuous_cb_t callback) {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  radio.callback = callback;
+}
+
+/**
+ * Starts looking for access points in the background
+ * @param channel Channel to look on, 0 for all of them
+ */
+void Radio::scan(uint8_t channel) {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  radio.scanning = true;
+  radio.scanChannel = channel;
+  radio.scanDone = millis() + (channel == 0 ? 13 : 1) * scanDwell;
+}
+
+/**
+ * Returns how many access points the last scan found, or scanRunning and
+ * scanFailed
+ */
+int Radio::scanComplete() {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  if (radio.scanning) {
+    if ((long)(millis() - radio.scanDone) < 0) {
+      return Radio::scanRunning;
+    }
+
+    radio.results.clear();
+    for (const sim_network_t &network : radio.networks) {
+      if (radio.scanChannel == 0 || network.channel == radio.scanChannel) {
+        radio.results.push_back(network);
+      }
+    }
+    radio.scanning = false;
+    radio.scanned = true;
+  }
+
+  return radio.scanned ? (int)radio.results.size() : Radio::scanFailed;
+}
+
+/**
+ * Returns the SSID of an access point from the last scan
+ * @param index Index of the access point
+ */
+String Radio::scanSSID(int index) {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  if (index < 0 || index >= (int)radio.results.size()) {
+    return String();
+  }
+  return String(radio.results[index].ssid.c_str());
+}
+
+/**
+ * Returns the BSSID of an access point from the last scan
+ * @param index Index of the access point
+ */
+const uint8_t *Radio::scanBSSID(int index) {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  if (index < 0 || index >= (int)radio.results.size()) {
+    return nullptr;
+  }
+  return radio.results[index].bssid;
+}
+
+/**
+ * Returns the encryption of an access point from the last scan
+ * @param index Index of the access point
+ */
+wifi_auth_mode_t Radio::scanEncryption(int index) {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  if (index < 0 || index >= (int)radio.results.size()) {
+    return WIFI_AUTH_OPEN;
+  }
+  return radio.results[index].encryption;
+}
+
+/**
+ * Returns the RSSI of an access point from the last scan
+ * @param index Index of the access point
+ */
+int Radio::scanRSSI(int index) {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  if (index < 0 || index >= (int)radio.results.size()) {
+    return 0;
+  }
+  return radio.results[index].rssi;
+}
+
+/**
+ * Returns the channel of an access point from the last scan
+ * @param index Index of the access point
+ */
+int Radio::scanChannel(int index) {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  if (index < 0 || index >= (int)radio.results.size()) {
+    return 0;
+  }
+  return radio.results[index].channel;
+}
+
+/**
+ * Nobody ever connects to us
+ */
+int Radio::stations() { return 0; }
+
+/**
+ * Hands a frame to whoever is listening, like the driver does when it hears
+ * one. returns false if nobody would have heard it
+ * @param frame Frame without its fcs
+ * @param length Length of frame
+ * @param rssi Signal strength
+ * @param channel Channel it was sent on, 0 for whatever we're tuned to
+ */
+bool Sim::receive(const uint8_t *frame, uint16_t length, int8_t rssi,
+                  uint8_t channel) {
+  wifi_promiscuous_cb_t callback;
+  {
+    std::lock_guard<std::mutex> guard(radio.lock);
+    if (!radio.promiscuous || radio.callback == nullptr || length < 2 ||
+        (channel != 0 && channel != radio.channel)) {
+      return false;
+    }
+    callback = radio.callback;
+    channel = radio.channel;
+  }
+
+  // the driver hands over the frame with its fcs, and counts it in sig_len
+  std::vector<uint32_t> buffer(
+      (sizeof(wifi_promiscuous_pkt_t) + length + 4 + 3) / 4, 0);
+  wifi_promiscuous_pkt_t *packet = (wifi_promiscuous_pkt_t *)buffer.data();
+  packet->rx_ctrl.rssi = rssi;
+  packet->rx_ctrl.channel = channel;
+  packet->rx_ctrl.sig_len = length + 4;
+  memcpy(packet->payload, frame, length);
+
+  wifi_promiscuous_pkt_type_t type = WIFI_PKT_MISC;
+  switch ((frame[0] >> 2) & 0x3) {
+  case 0:
+    type = WIFI_PKT_MGMT;
+    break;
+  case 1:
+    type = WIFI_PKT_CTRL;
+    break;
+  case 2:
+    type = WIFI_PKT_DATA;
+    break;
+  }
+
+  callback(packet, type);
+  return true;
+}
+
+/**
+ * Returns every frame sent since the last clearSent()
+ */
+std::vector<sim_frame_t> Sim::sent() {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  return radio.sent;
+}
+
+/**
+ * Forgets the frames sent so far
+ */
+void Sim::clearSent() {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  radio.sent.clear();
+}
+
+/**
+ * Makes the next few sends fail
+ * @param count How many
+ */
+void Sim::failSends(uint32_t count) {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  radio.failures = count;
+}
+
+/**
+ * Adds an access point for scans to find
+ * @param network Access point to add
+ */
+void Sim::addNetwork(const sim_network_t &network) {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  radio.networks.push_back(network);
+}
+
+/**
+ * Takes all the access points away again
+ */
+void Sim::clearNetworks() {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  radio.networks.clear();
+}
+
+/**
+ * Returns the mode the radio is in
+ */
+wifi_mode_t Sim::mode() {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  return radio.mode;
+}
+
+/**
+ * Returns how many times we changed channel
+ */
+uint32_t Sim::hops() {
+  std::lock_guard<std::mutex> guard(radio.lock);
+  return radio.hops;
+}
@@ -0,0 +1,214 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * rtos.cpp: freertos tasks, queues and notifications on std::thread
+ */
+
+#include "sim.h"
+#include <Arduino.h>
+#include <chrono>
+#include <condition_variable>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** developer note:
+ *
+ * every task is a detached thread that's never cleaned up, like a task that
+ * never returns. whatever they share is allocated once and never freed, so
+ * they can keep running while main() returns.
+ *
+ * a task waiting on a notification with a timeout (which is how the
+ * scheduler sleeps) doesn't really wait, it pushes the simulated clock ahead
+ * instead. waiting forever, on a queue, or in vTaskDelay() takes real time.
+ *
+ */
+
+struct sim_task {
+  std::mutex lock;
+  std::condition_variable wake;
+  uint32_t notified;
+  BaseType_t core;
+};
+
+struct sim_queue {
+  std::mutex lock;
+  std::condition_variable changed;
+  UBaseType_t length;
+  UBaseType_t size;
+  std::vector<uint8_t> items;
+  UBaseType_t head;
+  UBaseType_t count;
+};
+
+// the task this thread is, the arduino loop task runs on core 1
+static thread_local TaskHandle_t current = nullptr;
+
+static std::recursive_mutex &critical = *new std::recursive_mutex();
+
+/**
+ * Makes a task for a thread
+ * @param core Core it's pinned to
+ */
+static TaskHandle_t newTask(BaseType_t core) {
+  TaskHandle_t task = new sim_task();
+  task->notified = 0;
+  task->core = core;
+  return task;
+}
+
+/**
+ * Waits on a condition for some ticks, or forever
+ * @param changed What to wait on
+ * @param guard Lock held on it
+ * @param ticks How long to wait
+ * @param ready Whether we can stop waiting
+ */
+template <typename Ready>
+static bool waitFor(std::condition_variable &changed,
+                    std::unique_lock<std::mutex> &guard, TickType_t ticks,
+                    Ready ready) {
+  if (ticks == portMAX_DELAY) {
+    changed.wait(guard, ready);
+    return true;
+  }
+  return changed.wait_for(guard, std::chrono::milliseconds(ticks), ready);
+}
+
+void vPortEnterCritical(portMUX_TYPE *mux) { critical.lock(); }
+
+void vPortExitCritical(portMUX_TYPE *mux) { critical.unlock(); }
+
+BaseType_t xPortGetCoreID() { return xTaskGetCurrentTaskHandle()->core; }
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name,
+                                   uint32_t stack, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core) {
+  TaskHandle_t task = newTask(core);
+  if (handle != nullptr) {
+    *handle = task;
+  }
+
+  std::thread([code, parameter, task]() {
+    current = task;
+    code(parameter);
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stack,
+                       void *parameter, UBaseType_t priority,
+                       TaskHandle_t *handle) {
+  return xTaskCreatePinnedToCore(code, name, stack, parameter, priority,
+                                 handle, 0);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (current == nullptr) {
+    current = newTask(1);
+  }
+  return current;
+}
+
+TickType_t xTaskGetTickCount() { return millis() / portTICK_PERIOD_MS; }
+
+void vTaskDelay(TickType_t ticks) {
+  if (ticks == 0) {
+    std::this_thread::yield();
+    return;
+  }
+  std::this_thread::sleep_for(
+      std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+  std::lock_guard<std::mutex> guard(task->lock);
+  task->notified++;
+  task->wake.notify_all();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> guard(task->lock);
+  if (task->notified == 0) {
+    if (ticks == portMAX_DELAY) {
+      task->wake.wait(guard, [task]() { return task->notified > 0; });
+    } else {
+      guard.unlock();
+      Sim::advance(ticks * portTICK_PERIOD_MS);
+      std::this_thread::yield();
+      guard.lock();
+    }
+  }
+
+  uint32_t count = task->notified;
+  if (count > 0) {
+    task->notified = clear ? 0 : count - 1;
+  }
+  return count;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t size) {
+  QueueHandle_t queue = new sim_queue();
+  queue->length = length;
+  queue->size = size;
+  queue->items.resize(length * size);
+  queue->head = 0;
+  queue->count = 0;
+  return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) { delete queue; }
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item,
+                      TickType_t ticks) {
+  std::unique_lock<std::mutex> guard(queue->lock);
+  if (!waitFor(queue->changed, guard, ticks,
+               [queue]() { return queue->count < queue->length; })) {
+    return errQUEUE_FULL;
+  }
+
+  UBaseType_t slot = (queue->head + queue->count) % queue->length;
+  memcpy(&queue->items[slot * queue->size], item, queue->size);
+  queue->count++;
+  queue->changed.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+  std::unique_lock<std::mutex> guard(queue->lock);
+  if (!waitFor(queue->changed, guard, ticks,
+               [queue]() { return queue->count > 0; })) {
+    return pdFALSE;
+  }
+
+  memcpy(item, &queue->items[queue->head * queue->size], queue->size);
+  queue->head = (queue->head + 1) % queue->length;
+  queue->count--;
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> guard(queue->lock);
+  return queue->count;
+}
@@ -0,0 +1,92 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * sim.h: header files for the simulated esp32 the host build runs on
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <esp_wifi_types.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// an access point the simulated radio finds when it scans
+typedef struct {
+  std::string ssid;
+  uint8_t bssid[6];
+  uint8_t channel;
+  int8_t rssi;
+  wifi_auth_mode_t encryption;
+} sim_network_t;
+
+// a frame that went out over the simulated radio
+typedef struct {
+  wifi_interface_t interface;
+  uint8_t channel;
+  std::vector<uint8_t> data;
+} sim_frame_t;
+
+/** developer note:
+ *
+ * everything a host test or tool can do to the pretend hardware lives here.
+ * the sketch itself never includes this, it only sees Radio, Serial, millis()
+ * and friends, which are backed by the same state.
+ *
+ * the clock is real time plus however far it's been pushed ahead. delay()
+ * and a task waiting on a notification with a timeout push it ahead instead
+ * of sleeping, so a whole epoch runs in no time, while micros() still
+ * measures how long code really takes.
+ *
+ */
+
+class Sim {
+public:
+  // clock
+  static void advance(unsigned long ms);
+  static uint64_t now();
+
+  // radio
+  static bool receive(const uint8_t *frame, uint16_t length, int8_t rssi,
+                      uint8_t channel);
+  static std::vector<sim_frame_t> sent();
+  static void clearSent();
+  static void failSends(uint32_t count);
+  static void addNetwork(const sim_network_t &network);
+  static void clearNetworks();
+  static wifi_mode_t mode();
+  static uint32_t hops();
+
+  // uart
+  static void serialInput(const uint8_t *data, size_t length);
+  static void serialInput(const char *text);
+  static std::string serialOutput();
+  static void serialEcho(bool enable);
+  static std::string serialPty();
+  static void serialClose();
+
+  // screens
+  static uint32_t panelBytes();
+  static void panelSent(uint32_t bytes);
+  static uint32_t glyphLookups();
+};
+
+#endif // SIM_H
@@ -0,0 +1,260 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * uart.cpp: the simulated uart behind Serial
+ */
+
+#include "sim.h"
+#include <Arduino.h>
+#include <atomic>
+#include <deque>
+#include <fcntl.h>
+#include <mutex>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+/** developer note:
+ *
+ * by default whatever the sketch writes piles up until a test takes it with
+ * Sim::serialOutput(), and tests feed it input with Sim::serialInput().
+ *
+ * Sim::serialPty() hooks it up to a pseudo terminal instead, so something
+ * outside can open the other end like it was the board's usb serial port.
+ * a reader thread stands in for the uart event task then, so onReceive()
+ * callbacks run off the loop task just like on the board.
+ *
+ */
+
+HardwareSerial Serial;
+
+// never freed, the reader thread and other tasks can outlive main()
+typedef struct {
+  std::mutex lock;
+  std::deque<uint8_t> rx;
+  size_t rxSize = 256;
+  std::string tx;
+  bool echo = false;
+  OnReceiveCb callback;
+  int master = -1;
+  int slave = -1;
+  std::atomic<bool> reading{false};
+  std::thread reader;
+} sim_uart_t;
+
+static sim_uart_t &uart = *new sim_uart_t();
+
+/**
+ * Hands bytes to the uart like they came in over the wire, drops whatever
+ * doesn't fit in the rx buffer
+ * @param data Bytes that came in
+ * @param length How many bytes
+ */
+static void received(const uint8_t *data, size_t length) {
+  OnReceiveCb callback;
+  {
+    std::lock_guard<std::mutex> guard(uart.lock);
+    for (size_t i = 0; i < length && uart.rx.size() < uart.rxSize; i++) {
+      uart.rx.push_back(data[i]);
+    }
+    callback = uart.callback;
+  }
+
+  if (callback) {
+    callback();
+  }
+}
+
+/**
+ * Reads the pty until it's closed, standing in for the uart event task
+ */
+static void readPty() {
+  uint8_t buf[256];
+  while (uart.reading) {
+    struct pollfd fd = {uart.master, POLLIN, 0};
+    if (poll(&fd, 1, 20) <= 0 || !(fd.revents & POLLIN)) {
+      continue;
+    }
+
+    ssize_t length = read(uart.master, buf, sizeof(buf));
+    if (length > 0) {
+      received(buf, length);
+    }
+  }
+}
+
+void HardwareSerial::begin(unsigned long baud) {}
+
+void HardwareSerial::end() {}
+
+void HardwareSerial::onReceive(OnReceiveCb function, bool onlyOnTimeout) {
+  std::lock_guard<std::mutex> guard(uart.lock);
+  uart.callback = function;
+}
+
+size_t HardwareSerial::setRxBufferSize(size_t size) {
+  std::lock_guard<std::mutex> guard(uart.lock);
+  uart.rxSize = size;
+  return size;
+}
+
+size_t HardwareSerial::setTxBufferSize(size_t size) { return size; }
+
+int HardwareSerial::available() {
+  std::lock_guard<std::mutex> guard(uart.lock);
+  return uart.rx.size();
+}
+
+int HardwareSerial::read() {
+  std::lock_guard<std::mutex> guard(uart.lock);
+  if (uart.rx.empty()) {
+    return -1;
+  }
+  uint8_t c = uart.rx.front();
+  uart.rx.pop_front();
+  return c;
+}
+
+int HardwareSerial::peek() {
+  std::lock_guard<std::mutex> guard(uart.lock);
+  return uart.rx.empty() ? -1 : uart.rx.front();
+}
+
+int HardwareSerial::availableForWrite() { return 128; }
+
+size_t HardwareSerial::write(uint8_t c) { return this->write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  std::lock_guard<std::mutex> guard(uart.lock);
+  if (uart.master >= 0) {
+    size_t written = 0;
+    while (written < size) {
+      ssize_t length = ::write(uart.master, buffer + written, size - written);
+      if (length <= 0) {
+        break;
+      }
+      written += length;
+    }
+  } else {
+    uart.tx.append((const char *)buffer, size);
+  }
+
+  if (uart.echo) {
+    fwrite(buffer, 1, size, stdout);
+    fflush(stdout);
+  }
+  return size;
+}
+
+/**
+ * Feeds bytes to the uart like the other end sent them
+ * @param data Bytes to send
+ * @param length How many bytes
+ */
+void Sim::serialInput(const uint8_t *data, size_t length) {
+  received(data, length);
+}
+
+/**
+ * Feeds a string to the uart like the other end sent it
+ * @param text String to send
+ */
+void Sim::serialInput(const char *text) {
+  received((const uint8_t *)text, strlen(text));
+}
+
+/**
+ * Takes everything written to the uart since last time
+ */
+std::string Sim::serialOutput() {
+  std::lock_guard<std::mutex> guard(uart.lock);
+  std::string output;
+  output.swap(uart.tx);
+  return output;
+}
+
+/**
+ * Copies everything written to the uart to stdout too
+ * @param enable Whether to copy it
+ */
+void Sim::serialEcho(bool enable) {
+  std::lock_guard<std::mutex> guard(uart.lock);
+  uart.echo = enable;
+}
+
+/**
+ * Moves the uart over to a raw pseudo terminal, returns the path of the end
+ * to open, or an empty string if it couldn't make one
+ */
+std::string Sim::serialPty() {
+  if (uart.master >= 0) {
+    return ptsname(uart.master);
+  }
+
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    if (master >= 0) {
+      close(master);
+    }
+    return "";
+  }
+
+  // keep our own handle on the other end so it stays up between openers,
+  // and make it raw so zero bytes and newlines go through untouched
+  std::string path = ptsname(master);
+  int slave = open(path.c_str(), O_RDWR | O_NOCTTY);
+  if (slave < 0) {
+    close(master);
+    return "";
+  }
+
+  struct termios settings;
+  tcgetattr(slave, &settings);
+  cfmakeraw(&settings);
+  tcsetattr(slave, TCSANOW, &settings);
+
+  {
+    std::lock_guard<std::mutex> guard(uart.lock);
+    uart.master = master;
+    uart.slave = slave;
+  }
+  uart.reading = true;
+  uart.reader = std::thread(readPty);
+  return path;
+}
+
+/**
+ * Goes back to keeping the uart in memory
+ */
+void Sim::serialClose() {
+  if (uart.master < 0) {
+    return;
+  }
+
+  uart.reading = false;
+  uart.reader.join();
+
+  std::lock_guard<std::mutex> guard(uart.lock);
+  close(uart.slave);
+  close(uart.master);
+  uart.master = -1;
+  uart.slave = -1;
+}
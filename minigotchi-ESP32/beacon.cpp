@@ -0,0 +1,482 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * beacon.cpp: packs pwngrid beacons into a fixed size buffer
+ */
+
+#include "beacon.h"
+#include "compression.h"
+
+/** developer note:
+ *
+ * the beacon is built straight into whatever buffer the caller hands us,
+ * which is sized at compile time from Frame::header and the largest chunked
+ * payload we allow. nothing here touches the heap, the json is written by
+ * hand instead of going through ArduinoJson.
+ *
+ * since we write the json ourselves we also know where epoch, face,
+ * pwnd_run, pwnd_tot and uptime ended up. when one of those changes we only
+ * overwrite its bytes, and the chunk headers only have to be redone when a
+ * value gets wider or narrower (say pwnd_tot going from 9 to 10).
+ *
+ * with Config::compression the json is gzipped once per refresh instead,
+ * and an IDWhisperCompression element goes in front of the chunks so
+ * pwngrid knows to decompress it. patching still happens on the plain json.
+ *
+ */
+
+constexpr size_t BeaconBuilder::maxPayloadSize;
+constexpr size_t BeaconBuilder::maxFrameSize;
+
+// keys of the dynamic fields, in beacon_field_t order
+const char *BeaconBuilder::fieldKeys[BEACON_FIELDS] = {
+    "epoch", "face", "pwnd_run", "pwnd_tot", "uptime"};
+
+/**
+ * Checks if the cached beacon no longer matches the advertised fields
+ */
+bool BeaconBuilder::stale() const {
+  return !this->cached || this->cachedEpoch != Config::epoch ||
+         this->faceChanged() ||
+         this->cachedPwndRun != Config::pwnd_run ||
+         this->cachedPwndTot != Config::pwnd_tot ||
+         this->cachedUptime != Config::uptime;
+}
+
+/**
+ * Returns the beacon, only repacking it if it is stale.
+ * The span is empty if the beacon could not be packed.
+ */
+beacon_span_t BeaconBuilder::build() {
+  if (!this->stale()) {
+    return this->span();
+  }
+
+  // patch what changed, fall back to a full write if that doesn't work out
+  bool patched = this->cached;
+  if (patched) {
+    if (this->cachedEpoch != Config::epoch) {
+      patched = patched && this->patch(BEACON_EPOCH, Config::epoch);
+    }
+    if (this->faceChanged()) {
+      patched = patched && this->patch(BEACON_FACE, Config::face);
+    }
+    if (this->cachedPwndRun != Config::pwnd_run) {
+      patched = patched && this->patch(BEACON_PWND_RUN, Config::pwnd_run);
+    }
+    if (this->cachedPwndTot != Config::pwnd_tot) {
+      patched = patched && this->patch(BEACON_PWND_TOT, Config::pwnd_tot);
+    }
+    if (this->cachedUptime != Config::uptime) {
+      patched = patched && this->patch(BEACON_UPTIME, Config::uptime);
+    }
+  }
+
+  if (!patched && !this->write()) {
+    Console.println("(X-X) Beacon payload is too large to send!");
+    this->cached = false;
+    beacon_span_t empty = {nullptr, 0};
+    return empty;
+  }
+
+  this->flush();
+  this->remember();
+  return this->span();
+}
+
+/**
+ * Writes the whole json payload
+ */
+bool BeaconBuilder::write() {
+  this->payloadLength = 0;
+
+  bool ok = this->append("{", 1) &&
+            this->appendField(BEACON_EPOCH, Config::epoch) &&
+            this->appendField(BEACON_FACE, Config::face) &&
+            this->appendKey("identity") &&
+            this->appendString(Config::identity) &&
+            this->appendKey("name") && this->appendString(Config::name) &&
+            this->appendKey("policy") && this->append("{", 1) &&
+            this->appendKey("advertise") &&
+            this->appendBool(Config::advertise) &&
+            this->appendKey("ap_ttl") && this->appendInt(Config::ap_ttl) &&
+            this->appendKey("associate") &&
+            this->appendBool(Config::associate) &&
+            this->appendKey("bored_num_epochs") &&
+            this->appendInt(Config::bored_num_epochs) &&
+            this->appendKey("deauth") && this->appendBool(Config::deauth) &&
+            this->appendKey("excited_num_epochs") &&
+            this->appendInt(Config::excited_num_epochs) &&
+            this->appendKey("hop_recon_time") &&
+            this->appendInt(Config::hop_recon_time) &&
+            this->appendKey("max_inactive_scale") &&
+            this->appendInt(Config::max_inactive_scale) &&
+            this->appendKey("max_interactions") &&
+            this->appendInt(Config::max_interactions) &&
+            this->appendKey("max_misses_for_recon") &&
+            this->appendInt(Config::max_misses_for_recon) &&
+            this->appendKey("min_recon_time") &&
+            this->appendInt(Config::min_recon_time) &&
+            this->appendKey("min_rssi") && this->appendInt(Config::min_rssi) &&
+            this->appendKey("recon_inactive_multiplier") &&
+            this->appendInt(Config::recon_inactive_multiplier) &&
+            this->appendKey("recon_time") &&
+            this->appendInt(Config::recon_time) &&
+            this->appendKey("sad_num_epochs") &&
+            this->appendInt(Config::sad_num_epochs) &&
+            this->appendKey("sta_ttl") && this->appendInt(Config::sta_ttl) &&
+            this->append("}", 1) &&
+            this->appendField(BEACON_PWND_RUN, Config::pwnd_run) &&
+            this->appendField(BEACON_PWND_TOT, Config::pwnd_tot) &&
+            this->appendKey("session_id") &&
+            this->appendString(Config::session_id) &&
+            this->appendField(BEACON_UPTIME, Config::uptime) &&
+            this->appendKey("version") &&
+            this->appendString(Config::version) && this->append("}", 1);
+
+  if (!ok) {
+    return false;
+  }
+
+  /** developer note:
+   *
+   * if you literally want to check the json everytime it gets packed
+   *
+   * Console.println(this->payload);
+   */
+
+  memcpy(this->frame, Frame::header, sizeof(Frame::header));
+  this->dirty = 0;
+  return true;
+}
+
+/**
+ * Rewrites a number field of the cached beacon
+ * @param field Field to rewrite
+ * @param value New value
+ */
+bool BeaconBuilder::patch(beacon_field_t field, int value) {
+  char buf[12];
+  size_t length = snprintf(buf, sizeof(buf), "%d", value);
+  return this->patch(field, buf, length);
+}
+
+/**
+ * Rewrites a string field of the cached beacon
+ * @param field Field to rewrite
+ * @param value New value, without quotes
+ */
+bool BeaconBuilder::patch(beacon_field_t field, const std::string &value) {
+  char buf[64];
+  size_t length = 0;
+  buf[length++] = '"';
+
+  for (size_t i = 0; i < value.length(); i++) {
+    // worst case escape plus the closing quote
+    if (length + 7 > sizeof(buf)) {
+      return false;
+    }
+    length += BeaconBuilder::escape(value[i], buf + length);
+  }
+
+  buf[length++] = '"';
+  return this->patch(field, buf, length);
+}
+
+/**
+ * Rewrites a field's json value in the payload, and in the beacon if it
+ * can be done in place
+ * @param field Field to rewrite
+ * @param value Serialized json value
+ * @param length Length of the value
+ */
+bool BeaconBuilder::patch(beacon_field_t field, const char *value,
+                          size_t length) {
+  size_t offset = this->fieldOffset[field];
+  size_t oldLength = this->fieldLength[field];
+
+  // same width, the chunks stay where they are
+  if (length == oldLength) {
+    memcpy(this->payload + offset, value, length);
+    if (this->compressed) {
+      this->dirty = std::min(this->dirty, offset);
+      return true;
+    }
+
+    for (size_t i = offset; i < offset + length; i++) {
+      this->frame[this->bodyOffset + 2 * (i / Frame::chunkSize + 1) + i] =
+          (uint8_t)this->payload[i];
+    }
+    return true;
+  }
+
+  size_t newPayloadLength = this->payloadLength - oldLength + length;
+  if (newPayloadLength > BeaconBuilder::maxPayloadSize) {
+    return false;
+  }
+
+  // shift everything after the field, the chunks get redone from there
+  memmove(this->payload + offset + length, this->payload + offset + oldLength,
+          this->payloadLength - offset - oldLength);
+  memcpy(this->payload + offset, value, length);
+  this->payloadLength = newPayloadLength;
+  this->payload[this->payloadLength] = '\0';
+
+  for (int i = 0; i < BEACON_FIELDS; i++) {
+    if (this->fieldOffset[i] > offset) {
+      this->fieldOffset[i] = this->fieldOffset[i] + length - oldLength;
+    }
+  }
+  this->fieldLength[field] = length;
+
+  this->dirty = std::min(this->dirty, offset);
+  return true;
+}
+
+/**
+ * Brings the beacon up to date with the payload, compressing it if enabled
+ */
+void BeaconBuilder::flush() {
+  if (this->dirty == SIZE_MAX) {
+    return;
+  }
+
+  bool wasCompressed = this->compressed;
+  size_t previousOffset = this->bodyOffset;
+
+  this->compressed = false;
+  this->body = (const uint8_t *)this->payload;
+  this->bodyLength = this->payloadLength;
+  this->bodyOffset = sizeof(Frame::header);
+
+  if (Config::compression) {
+    // only worth it if it comes out smaller, same as pwngrid
+    size_t length = Compression::compress(
+        (const uint8_t *)this->payload, this->payloadLength,
+        this->compressedPayload, this->payloadLength - 1);
+    if (length > 0) {
+      this->compressed = true;
+      this->body = this->compressedPayload;
+      this->bodyLength = length;
+    }
+  }
+
+  if (this->compressed) {
+    this->frame[this->bodyOffset++] = Frame::IDWhisperCompression;
+    this->frame[this->bodyOffset++] = 1;
+    this->frame[this->bodyOffset++] = 1;
+  }
+
+  // compressed data changes all over, and so does everything if it moved
+  size_t first = this->dirty / Frame::chunkSize;
+  if (this->compressed || wasCompressed ||
+      this->bodyOffset != previousOffset) {
+    first = 0;
+  }
+
+  this->chunk(first);
+  this->dirty = SIZE_MAX;
+}
+
+/**
+ * Splits the payload into pwngrid payload chunks within the beacon
+ * @param first First chunk to (re)write, earlier chunks are left alone
+ */
+void BeaconBuilder::chunk(size_t first) {
+  for (size_t i = first * Frame::chunkSize; i < this->bodyLength;
+       i += Frame::chunkSize) {
+    size_t frameByte = this->bodyOffset + 2 * (i / Frame::chunkSize) + i;
+    size_t chunkLength = Frame::chunkSize;
+    if (this->bodyLength - i < Frame::chunkSize) {
+      chunkLength = this->bodyLength - i;
+    }
+
+    this->frame[frameByte++] = Frame::IDWhisperPayload;
+    this->frame[frameByte++] = (uint8_t)chunkLength;
+    memcpy(this->frame + frameByte, this->body + i, chunkLength);
+  }
+}
+
+/**
+ * Remembers which values the cached beacon was packed with
+ */
+void BeaconBuilder::remember() {
+  this->cached = true;
+  this->cachedEpoch = Config::epoch;
+  this->cachedFaceLength =
+      std::min(Config::face.length(), sizeof(this->cachedFace));
+  memcpy(this->cachedFace, Config::face.data(), this->cachedFaceLength);
+  this->cachedPwndRun = Config::pwnd_run;
+  this->cachedPwndTot = Config::pwnd_tot;
+  this->cachedUptime = Config::uptime;
+}
+
+/**
+ * Checks if the face is different from the one the beacon was packed with
+ */
+bool BeaconBuilder::faceChanged() const {
+  return Config::face.length() != this->cachedFaceLength ||
+         memcmp(Config::face.data(), this->cachedFace,
+                this->cachedFaceLength) != 0;
+}
+
+/**
+ * Returns the packed beacon along with its length
+ */
+beacon_span_t BeaconBuilder::span() const {
+  // one id and one length byte per chunk
+  size_t chunks = (this->bodyLength + Frame::chunkSize - 1) / Frame::chunkSize;
+  beacon_span_t span = {this->frame,
+                        this->bodyOffset + 2 * chunks + this->bodyLength};
+  return span;
+}
+
+/**
+ * Appends raw bytes to the json payload
+ * @param data Bytes to append
+ * @param length Number of bytes
+ */
+bool BeaconBuilder::append(const char *data, size_t length) {
+  if (this->payloadLength + length > BeaconBuilder::maxPayloadSize) {
+    return false;
+  }
+
+  memcpy(this->payload + this->payloadLength, data, length);
+  this->payloadLength += length;
+  this->payload[this->payloadLength] = '\0';
+  return true;
+}
+
+/**
+ * Appends a json key, along with the comma before it if needed
+ * @param key Key to append
+ */
+bool BeaconBuilder::appendKey(const char *key) {
+  char last = this->payload[this->payloadLength - 1];
+  if (last != '{' && !this->append(",", 1)) {
+    return false;
+  }
+
+  return this->append("\"", 1) && this->append(key, strlen(key)) &&
+         this->append("\":", 2);
+}
+
+/**
+ * Appends a json number
+ * @param value Number to append
+ */
+bool BeaconBuilder::appendInt(int value) {
+  char buf[12];
+  size_t length = snprintf(buf, sizeof(buf), "%d", value);
+  return this->append(buf, length);
+}
+
+/**
+ * Appends a json boolean
+ * @param value Boolean to append
+ */
+bool BeaconBuilder::appendBool(bool value) {
+  return value ? this->append("true", 4) : this->append("false", 5);
+}
+
+/**
+ * Appends a quoted and escaped json string
+ * @param value String to append
+ */
+bool BeaconBuilder::appendString(const std::string &value) {
+  if (!this->append("\"", 1)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < value.length(); i++) {
+    char buf[6];
+    size_t length = BeaconBuilder::escape(value[i], buf);
+    if (!this->append(buf, length)) {
+      return false;
+    }
+  }
+
+  return this->append("\"", 1);
+}
+
+/**
+ * Appends one of the dynamic fields and records where its value went
+ * @param field Field to append
+ * @param value Value of the field
+ */
+bool BeaconBuilder::appendField(beacon_field_t field, int value) {
+  if (!this->appendKey(BeaconBuilder::fieldKeys[field])) {
+    return false;
+  }
+
+  this->fieldOffset[field] = this->payloadLength;
+  bool ok = this->appendInt(value);
+  this->fieldLength[field] = this->payloadLength - this->fieldOffset[field];
+  return ok;
+}
+
+/**
+ * Appends one of the dynamic fields and records where its value went
+ * @param field Field to append
+ * @param value Value of the field
+ */
+bool BeaconBuilder::appendField(beacon_field_t field,
+                                const std::string &value) {
+  if (!this->appendKey(BeaconBuilder::fieldKeys[field])) {
+    return false;
+  }
+
+  this->fieldOffset[field] = this->payloadLength;
+  bool ok = this->appendString(value);
+  this->fieldLength[field] = this->payloadLength - this->fieldOffset[field];
+  return ok;
+}
+
+/**
+ * Escapes a single character for use in a json string
+ * @param c Character to escape
+ * @param buf Buffer to use, at least 6 bytes
+ */
+size_t BeaconBuilder::escape(char c, char *buf) {
+  switch (c) {
+  case '"':
+  case '\\':
+    buf[0] = '\\';
+    buf[1] = c;
+    return 2;
+  case '\n':
+    memcpy(buf, "\\n", 2);
+    return 2;
+  case '\r':
+    memcpy(buf, "\\r", 2);
+    return 2;
+  case '\t':
+    memcpy(buf, "\\t", 2);
+    return 2;
+  default:
+    if ((uint8_t)c < 0x20) {
+      char hex[7];
+      snprintf(hex, sizeof(hex), "\\u%04x", (uint8_t)c);
+      memcpy(buf, hex, 6);
+      return 6;
+    }
+    buf[0] = c;
+    return 1;
+  }
+}
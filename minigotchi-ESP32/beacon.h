@@ -0,0 +1,113 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * beacon.h: header files for beacon.cpp
+ */
+
+#ifndef BEACON_H
+#define BEACON_H
+
+#include "config.h"
+#include "console.h"
+#include "frame.h"
+#include <Arduino.h>
+#include <algorithm>
+#include <stdint.h>
+#include <string>
+
+typedef enum {
+  BEACON_EPOCH = 0,
+  BEACON_FACE = 1,
+  BEACON_PWND_RUN = 2,
+  BEACON_PWND_TOT = 3,
+  BEACON_UPTIME = 4,
+  BEACON_FIELDS = 5
+} beacon_field_t;
+
+class BeaconBuilder {
+public:
+  // largest json we'll fit into the chunks of a single beacon
+  static constexpr size_t maxPayloadSize = Frame::maxChunks * Frame::chunkSize;
+
+  // header, the compression element, then one id and one length byte in
+  // front of every chunk
+  static constexpr size_t maxFrameSize =
+      sizeof(Frame::header) + 3 + Frame::maxChunks * (Frame::chunkSize + 2);
+
+  static_assert(maxFrameSize <= 1500,
+                "esp_wifi_80211_tx() won't send frames over 1500 bytes");
+
+  template <size_t N> explicit BeaconBuilder(uint8_t (&frame)[N]) {
+    static_assert(N >= maxFrameSize, "beacon buffer is too small");
+    this->frame = frame;
+  }
+
+  beacon_span_t build();
+  bool stale() const;
+
+private:
+  bool write();
+  bool patch(beacon_field_t field, int value);
+  bool patch(beacon_field_t field, const std::string &value);
+  bool patch(beacon_field_t field, const char *value, size_t length);
+  void flush();
+  void chunk(size_t first);
+  void remember();
+  bool faceChanged() const;
+  beacon_span_t span() const;
+
+  bool append(const char *data, size_t length);
+  bool appendKey(const char *key);
+  bool appendInt(int value);
+  bool appendBool(bool value);
+  bool appendString(const std::string &value);
+  bool appendField(beacon_field_t field, int value);
+  bool appendField(beacon_field_t field, const std::string &value);
+  static size_t escape(char c, char *buf);
+  static const char *fieldKeys[BEACON_FIELDS];
+
+  uint8_t *frame = nullptr;
+  char payload[maxPayloadSize + 1];
+  size_t payloadLength = 0;
+  size_t fieldOffset[BEACON_FIELDS] = {0};
+  size_t fieldLength[BEACON_FIELDS] = {0};
+
+  // first payload byte the beacon is out of date from
+  size_t dirty = SIZE_MAX;
+
+  // what actually goes into the chunks, the payload or its compressed form
+  uint8_t compressedPayload[maxPayloadSize];
+  bool compressed = false;
+  const uint8_t *body = nullptr;
+  size_t bodyLength = 0;
+  size_t bodyOffset = sizeof(Frame::header);
+
+  // what the cached beacon was packed with. the face is copied in here so
+  // remembering it never allocates, and it made it into the payload, so it
+  // always fits
+  bool cached = false;
+  int cachedEpoch = 0;
+  char cachedFace[maxPayloadSize];
+  size_t cachedFaceLength = 0;
+  int cachedPwndRun = 0;
+  int cachedPwndTot = 0;
+  int cachedUptime = 0;
+};
+
+#endif // BEACON_H
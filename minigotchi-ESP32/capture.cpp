@@ -0,0 +1,219 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * capture.cpp: records sent and received frames for wireshark
+ */
+
+#include "capture.h"
+
+/** developer note:
+ *
+ * with Config::capture on, every beacon we send and every pwnagotchi beacon
+ * we pick up gets recorded, so you can see what actually went on air.
+ *
+ * frames go into the ring exactly the way they go out on serial: CAPTURE_MAGIC
+ * and a 16 bit length, then a pcap record (record header, a small radiotap
+ * header and the frame itself). recording one is a couple of memcpys under a
+ * spinlock. the spinlock is there since received frames come in on the wifi
+ * task while sent ones come from ours. when the ring is full new frames are
+ * dropped instead of overwriting ones that haven't gone out.
+ *
+ * flush() doesn't copy anything, it hands whatever is waiting in the ring to
+ * the console's presentation task as a pointer (at most two of them when it
+ * wraps around), which writes it straight to serial in between the usual
+ * text. that part of the ring is only given back once it's been written.
+ *
+ * the host looks for the magic, checks the length against the record and
+ * glues the records behind a pcap file header, see INSTALL.md. a record
+ * that got mangled is just skipped, it can't throw off the ones after it.
+ *
+ * in parasite mode the serial port belongs to the pwnagotchi, so nothing is
+ * streamed there.
+ *
+ */
+
+uint8_t Capture::ring[Capture::size];
+uint32_t Capture::head = 0;
+uint32_t Capture::tail = 0;
+uint32_t Capture::sending = 0;
+uint32_t Capture::recorded = 0;
+uint32_t Capture::dropped = 0;
+portMUX_TYPE Capture::lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * Records a frame we sent
+ * @param frame Frame that was sent
+ * @param length Length of frame
+ * @param channel Channel it went out on
+ */
+void Capture::sent(const uint8_t *frame, uint16_t length, uint8_t channel) {
+  Capture::record(frame, length, 0, channel, false);
+}
+
+/**
+ * Records a frame we received
+ * @param frame Frame that came in, without its fcs
+ * @param length Length of frame
+ * @param rssi Signal strength it came in at
+ * @param channel Channel it came in on
+ */
+void Capture::received(const uint8_t *frame, uint16_t length, int8_t rssi,
+                       uint8_t channel) {
+  Capture::record(frame, length, rssi, channel, true);
+}
+
+/**
+ * Puts a frame in the ring as a pcap record, or drops it if there's no room
+ * @param frame Frame to record
+ * @param length Length of frame
+ * @param rssi Signal strength, only used if signal is set
+ * @param channel Channel of the frame
+ * @param signal Whether to record the signal strength
+ */
+void Capture::record(const uint8_t *frame, uint16_t length, int8_t rssi,
+                     uint8_t channel, bool signal) {
+  if (!Config::capture) {
+    return;
+  }
+
+  // channel, plus antenna signal for received frames
+  capture_radiotap_t radiotap;
+  radiotap.version = 0;
+  radiotap.pad = 0;
+  radiotap.length = signal ? sizeof(radiotap) : sizeof(radiotap) - 1;
+  radiotap.present = signal ? (1 << 3) | (1 << 5) : (1 << 3);
+  radiotap.frequency = (channel == 14) ? 2484 : 2407 + 5 * channel;
+  radiotap.flags = 0x0080; // 2 GHz
+  radiotap.signal = rssi;
+
+  uint16_t captured = (length > Capture::snapLength) ? Capture::snapLength
+                                                     : length;
+  uint64_t now = esp_timer_get_time();
+  capture_record_t record;
+  record.seconds = now / 1000000;
+  record.micros = now % 1000000;
+  record.captured = radiotap.length + captured;
+  record.length = radiotap.length + length;
+
+  capture_chunk_t chunk;
+  memcpy(chunk.magic, CAPTURE_MAGIC, sizeof(chunk.magic));
+  chunk.length = sizeof(record) + record.captured;
+
+  size_t total = sizeof(chunk) + chunk.length;
+
+  portENTER_CRITICAL(&Capture::lock);
+  if (Capture::size - (Capture::head - Capture::tail) < total) {
+    Capture::dropped++;
+  } else {
+    Capture::copyIn(&chunk, sizeof(chunk));
+    Capture::copyIn(&record, sizeof(record));
+    Capture::copyIn(&radiotap, radiotap.length);
+    Capture::copyIn(frame, captured);
+    Capture::recorded++;
+  }
+  portEXIT_CRITICAL(&Capture::lock);
+}
+
+/**
+ * Copies bytes in at the head of the ring, call with the lock held
+ * @param data Bytes to copy
+ * @param length How many bytes
+ */
+void Capture::copyIn(const void *data, size_t length) {
+  uint32_t offset = Capture::head & (Capture::size - 1);
+  size_t first = Capture::size - offset;
+  if (first > length) {
+    first = length;
+  }
+
+  memcpy(Capture::ring + offset, data, first);
+  memcpy(Capture::ring, (const uint8_t *)data + first, length - first);
+  Capture::head += length;
+}
+
+/**
+ * Hands whatever is waiting in the ring to the console to stream over serial
+ */
+void Capture::flush() {
+  if (!Config::capture || Config::parasite) {
+    return;
+  }
+
+  // at most twice, once up to the end of the ring and once from its start
+  for (uint8_t i = 0; i < 2; i++) {
+    portENTER_CRITICAL(&Capture::lock);
+    uint32_t from = Capture::tail + Capture::sending;
+    uint32_t length = Capture::head - from;
+    portEXIT_CRITICAL(&Capture::lock);
+
+    if (length == 0) {
+      return;
+    }
+
+    uint32_t offset = from & (Capture::size - 1);
+    if (length > Capture::size - offset) {
+      length = Capture::size - offset;
+    }
+
+    // only counted as sending once it's queued, the console calls written()
+    portENTER_CRITICAL(&Capture::lock);
+    Capture::sending += length;
+    portEXIT_CRITICAL(&Capture::lock);
+    if (!Console.writeRaw(Capture::ring + offset, length, Capture::written)) {
+      portENTER_CRITICAL(&Capture::lock);
+      Capture::sending -= length;
+      portEXIT_CRITICAL(&Capture::lock);
+      return;
+    }
+  }
+}
+
+/**
+ * Gives bytes back to the ring once the console has written them, called
+ * from the presentation task
+ * @param length How many bytes were written
+ */
+void Capture::written(size_t length) {
+  portENTER_CRITICAL(&Capture::lock);
+  Capture::tail += length;
+  Capture::sending -= length;
+  portEXIT_CRITICAL(&Capture::lock);
+}
+
+/**
+ * Prints how many frames were recorded and dropped since the last report
+ */
+void Capture::report() {
+  if (!Config::capture) {
+    return;
+  }
+
+  portENTER_CRITICAL(&Capture::lock);
+  uint32_t recorded = Capture::recorded;
+  uint32_t dropped = Capture::dropped;
+  Capture::recorded = 0;
+  Capture::dropped = 0;
+  portEXIT_CRITICAL(&Capture::lock);
+
+  Console.print("('-') Captured ");
+  Console.print(recorded);
+  Console.print(" frames, ");
+  Console.print(dropped);
+  Console.println(" dropped");
+}
@@ -0,0 +1,97 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * capture.h: header files for capture.cpp
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "config.h"
+#include "console.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <stdint.h>
+
+// pcap link type of what we record, radiotap so wireshark shows channel and
+// signal
+#define CAPTURE_LINKTYPE 127
+
+// goes in front of every record streamed over serial
+#define CAPTURE_MAGIC "\0cap"
+
+// what goes in front of every record on serial, CAPTURE_MAGIC and a length
+typedef struct __attribute__((packed)) {
+  char magic[4];
+  uint16_t length;
+} capture_chunk_t;
+
+// a pcap record header
+typedef struct __attribute__((packed)) {
+  uint32_t seconds;
+  uint32_t micros;
+  uint32_t captured;
+  uint32_t length;
+} capture_record_t;
+
+// radiotap header in front of every frame, received frames also get a signal
+typedef struct __attribute__((packed)) {
+  uint8_t version;
+  uint8_t pad;
+  uint16_t length;
+  uint32_t present;
+  uint16_t frequency;
+  uint16_t flags;
+  int8_t signal;
+} capture_radiotap_t;
+
+class Capture {
+public:
+  static void sent(const uint8_t *frame, uint16_t length, uint8_t channel);
+  static void received(const uint8_t *frame, uint16_t length, int8_t rssi,
+                       uint8_t channel);
+  static void flush();
+  static void report();
+
+  // must be a power of two
+  static const uint32_t size = 8192;
+
+  // most of a frame we keep, beacons fit
+  static const uint16_t snapLength = 512;
+
+private:
+  static void record(const uint8_t *frame, uint16_t length, int8_t rssi,
+                     uint8_t channel, bool signal);
+  static void copyIn(const void *data, size_t length);
+  static void written(size_t length);
+
+  // records waiting to go out, exactly as they go on serial. filled by the
+  // radio, bytes from tail on are handed to the console but only given back
+  // once it has written them
+  static uint8_t ring[];
+  static uint32_t head;
+  static uint32_t tail;
+  static uint32_t sending;
+  static uint32_t recorded;
+  static uint32_t dropped;
+  static portMUX_TYPE lock;
+};
+
+#endif // CAPTURE_H
@@ -41,53 +41,389 @@ int Channel::channelList[13] = {
     Config::channels[9], Config::channels[10], Config::channels[11],
     Config::channels[12]};
 
+/** developer note:
+ *
+ * picking a channel at random means most of the time we're listening where
+ * nobody is. so for every channel we count the management frames we saw on
+ * it and the pwngrid beacons we got from it, and give it a score between 0
+ * and 1 after each visit. the score is a moving average of how good the
+ * visits were, pwngrid beacons count the most.
+ *
+ * the next channel is then picked at random weighted by score, a bit like a
+ * multi-armed bandit. every channel starts out at 0.5 so each gets tried, and
+ * never drops below the floor so a quiet channel still gets a look now and
+ * then. a channel where we heard a pwnagotchi recently gets a bonus, and the
+ * better the channel the longer we stay on it, see dwell().
+ *
+ */
+
+// index is the channel number, 0 isn't used
+channel_stats_t Channel::stats[Channel::maxChannel + 1];
+
+const int Channel::maxChannel;
+
+// the visit we're on now
+int Channel::visitChannel = 0;
+uint32_t Channel::visitFrames = 0;
+uint32_t Channel::visitBeacons = 0;
+unsigned long Channel::visitDwell = 0;
+unsigned long Channel::visitStart = 0;
+
+// the sweep we're on now
+int Channel::sweepIndex = 0;
+unsigned long Channel::sweepStart = 0;
+unsigned long Channel::sweepTime = 0;
+bool Channel::swept[Channel::maxChannel + 1];
+float Channel::sweepRate[Channel::maxChannel + 1];
+uint32_t Channel::sweepBeacons[Channel::maxChannel + 1];
+
+// hop timing
+channel_hop_stats_t Channel::fastHops = {0, 0, UINT32_MAX, 0, 0};
+channel_hop_stats_t Channel::slowHops = {0, 0, UINT32_MAX, 0, 0};
+
+// scoring knobs
+static const float channelFloor = 0.05;
+static const float channelAlpha = 0.25;
+static const float channelBonus = 0.25;
+static const unsigned long channelBonusTime = 300000;
+
 /**
  * Here, we choose the channel to initialize on
  * @param initChannel Channel to initialize on
  */
 void Channel::init(int initChannel) {
+  // every channel gets a fair chance to start with
+  for (int i = 0; i <= Channel::maxChannel; i++) {
+    Channel::stats[i].score = 0.5;
+  }
+
   // start on user specified channel
   delay(250);
-  Serial.println(" ");
-  Serial.print("(-.-) Initializing on channel ");
-  Serial.println(initChannel);
-  Serial.println(" ");
-  Display::updateDisplay("(-.-)",
-                         "Initializing on channel " + (String)initChannel);
+  Console.println(" ");
+  Console.print("(-.-) Initializing on channel ");
+  Console.println(initChannel);
+  Console.println(" ");
+  Mood::enter(mood_t::SLEEPING,
+              "Initializing on channel " + (String)initChannel);
   delay(250);
 
-  // switch channel
-  Minigotchi::monStop();
-  esp_err_t err = esp_wifi_set_channel(initChannel, WIFI_SECOND_CHAN_NONE);
+  // switch channel, we stay in promiscuous mode from here on
   Minigotchi::monStart();
+  bool switched = Channel::hop(initChannel);
 
-  if (err == ESP_OK && initChannel == getChannel()) {
-    Serial.print("('-') Successfully initialized on channel ");
-    Serial.println(getChannel());
-    Display::updateDisplay("('-')", "Successfully initialized on channel " +
+  if (switched && initChannel == getChannel()) {
+    Console.print("('-') Successfully initialized on channel ");
+    Console.println(getChannel());
+    Mood::enter(mood_t::NEUTRAL, "Successfully initialized on channel " +
                                         (String)getChannel());
     delay(250);
   } else {
-    Serial.println("(X-X) Channel initialization failed, try again?");
-    Display::updateDisplay("(X-X)",
-                           "Channel initialization failed, try again?");
+    Console.println("(X-X) Channel initialization failed, try again?");
+    Mood::enter(mood_t::BROKEN,
+                "Channel initialization failed, try again?");
     delay(250);
   }
 }
 
 /**
- * Cycle channels
+ * Cycle channels, this is a single step
  */
-void Channel::cycle() {
-  // get channels
-  int numChannels = sizeof(channelList) / sizeof(channelList[0]);
+unsigned long Channel::cycle() {
+  // the sweep takes care of hopping
+  if (Config::sweep) {
+    return Scheduler::done;
+  }
+
+  // score the channel we're leaving
+  Channel::score();
 
-  // select a random one
-  int randomIndex = random(numChannels);
-  int newChannel = channelList[randomIndex];
+  // select one based on how they've been doing
+  int newChannel = Channel::pick();
 
   // switch here
   switchChannel(newChannel);
+
+  int channel = Channel::getChannel();
+  Channel::visit(channel, Channel::dwell());
+  if (Channel::visitChannel != 0) {
+    Console.print("('-') Channel score: ");
+    Console.print(Channel::stats[channel].score);
+    Console.print(", listening for ");
+    Console.print(Channel::visitDwell);
+    Console.println(" ms");
+    Console.println(" ");
+  }
+
+  return Scheduler::done;
+}
+
+/**
+ * Starts keeping track of a visit to a channel, for score()
+ * @param channel Channel we're on
+ * @param dwell How long we're going to listen
+ */
+void Channel::visit(int channel, unsigned long dwell) {
+  if (channel < 1 || channel > Channel::maxChannel) {
+    Channel::visitChannel = 0;
+    return;
+  }
+
+  Channel::visitChannel = channel;
+  Channel::visitFrames = Channel::stats[channel].frames;
+  Channel::visitBeacons = Channel::stats[channel].beacons;
+  Channel::visitDwell = dwell;
+  Channel::visitStart = millis();
+}
+
+/** developer note:
+ *
+ * in sweep mode we don't sit on one channel for the whole scan, we go
+ * through every channel in the list and listen on each for
+ * Config::sweepDwell. a pwnagotchi on any of them gets found in the same
+ * epoch instead of whenever we happen to land on its channel.
+ *
+ * every stop is a visit like any other, so it gets scored too. the sweep is
+ * driven by Pwnagotchi::detect(), which calls sweep() every step until it
+ * returns false.
+ *
+ * cycle() doesn't hop in sweep mode, so once every channel has been visited
+ * the sweep hops to the best one itself. otherwise advertising and deauthing
+ * would always happen on whatever channel came last in the list.
+ *
+ */
+
+/**
+ * Starts a sweep on the first channel in the list
+ */
+void Channel::startSweep() {
+  Channel::score();
+
+  for (int i = 0; i <= Channel::maxChannel; i++) {
+    Channel::swept[i] = false;
+    Channel::sweepRate[i] = 0;
+    Channel::sweepBeacons[i] = 0;
+  }
+
+  Channel::sweepIndex = -1;
+  Channel::sweepStart = millis();
+  Channel::sweepTime = 0;
+  Channel::visitChannel = 0;
+  Channel::sweep();
+}
+
+/**
+ * Moves the sweep along, returns false once every channel has been visited
+ */
+bool Channel::sweep() {
+  int numChannels = sizeof(channelList) / sizeof(channelList[0]);
+
+  // still listening
+  if (Channel::visitChannel != 0 &&
+      millis() - Channel::visitStart < Channel::visitDwell) {
+    return true;
+  }
+
+  // wrap up the channel we're leaving
+  int channel = Channel::visitChannel;
+  if (channel != 0) {
+    channel_stats_t *stats = &Channel::stats[channel];
+    unsigned long listened = max(millis() - Channel::visitStart, 1UL);
+    Channel::sweepRate[channel] =
+        (stats->frames - Channel::visitFrames) * 1000.0f / listened;
+    Channel::sweepBeacons[channel] = stats->beacons - Channel::visitBeacons;
+    Channel::score();
+  }
+
+  // next one we haven't been to yet
+  while (++Channel::sweepIndex < numChannels) {
+    int next = channelList[Channel::sweepIndex];
+    if (next < 1 || next > Channel::maxChannel || Channel::swept[next]) {
+      continue;
+    }
+
+    Channel::swept[next] = true;
+    if (Channel::hop(next)) {
+      Channel::visit(next, Config::sweepDwell);
+      return true;
+    }
+  }
+
+  Channel::sweepTime = millis() - Channel::sweepStart;
+
+  // don't stay on the last channel of the sweep
+  Channel::visitChannel = 0;
+  Channel::hop(Channel::best());
+  return false;
+}
+
+/**
+ * Prints how the last sweep went
+ */
+void Channel::printSweep() {
+  int visited = 0;
+  for (int i = 1; i <= Channel::maxChannel; i++) {
+    if (!Channel::swept[i]) {
+      continue;
+    }
+
+    visited++;
+    Console.print("('-') Channel ");
+    Console.print(i);
+    Console.print(": ");
+    Console.print(Channel::sweepRate[i]);
+    Console.print(" frames/s, ");
+    Console.print(Channel::sweepBeacons[i]);
+    Console.println(" pwngrid beacons");
+  }
+
+  Console.print("('-') Swept ");
+  Console.print(visited);
+  Console.print(" channels in ");
+  Console.print(Channel::sweepTime);
+  Console.print(" ms, staying on channel ");
+  Console.println(Channel::getChannel());
+  Console.println(" ");
+  Channel::printHops();
+  Console.println(" ");
+}
+
+/**
+ * Counts a management frame seen on a channel, called from the promiscuous
+ * callback so this has to stay quick
+ * @param channel Channel the frame was on
+ */
+void Channel::count(uint8_t channel) {
+  if (channel >= 1 && channel <= Channel::maxChannel) {
+    Channel::stats[channel].frames++;
+  }
+}
+
+/**
+ * Counts a pwngrid beacon heard on a channel
+ * @param channel Channel the beacon was on
+ */
+void Channel::heard(uint8_t channel) {
+  if (channel >= 1 && channel <= Channel::maxChannel) {
+    Channel::stats[channel].beacons++;
+    Channel::stats[channel].lastPeer = millis();
+  }
+}
+
+/**
+ * Returns how long to listen on the current channel, longer on good ones
+ */
+unsigned long Channel::dwell() {
+  int numChannels = sizeof(channelList) / sizeof(channelList[0]);
+  float total = 0;
+  int counted = 0;
+
+  for (int i = 0; i < numChannels; i++) {
+    if (channelList[i] >= 1 && channelList[i] <= Channel::maxChannel) {
+      total += Channel::weight(channelList[i]);
+      counted++;
+    }
+  }
+
+  int channel = Channel::getChannel();
+  if (counted == 0 || total <= 0 || channel < 1 ||
+      channel > Channel::maxChannel) {
+    return Config::longDelay;
+  }
+
+  // somewhere between half and double the usual wait
+  float factor = Channel::weight(channel) / (total / counted);
+  factor = constrain(factor, 0.5f, 2.0f);
+  return Config::longDelay * factor;
+}
+
+/**
+ * Picks the next channel, weighted by score
+ */
+int Channel::pick() {
+  int numChannels = sizeof(channelList) / sizeof(channelList[0]);
+  float total = 0;
+
+  for (int i = 0; i < numChannels; i++) {
+    if (channelList[i] >= 1 && channelList[i] <= Channel::maxChannel) {
+      total += Channel::weight(channelList[i]);
+    }
+  }
+
+  float target = random(65536) / 65536.0f * total;
+  for (int i = 0; i < numChannels; i++) {
+    if (channelList[i] < 1 || channelList[i] > Channel::maxChannel) {
+      continue;
+    }
+
+    target -= Channel::weight(channelList[i]);
+    if (target < 0) {
+      return channelList[i];
+    }
+  }
+
+  // only rounding gets us here
+  return channelList[random(numChannels)];
+}
+
+/**
+ * Returns the channel that's been doing best, the first one on a tie
+ */
+int Channel::best() {
+  int numChannels = sizeof(channelList) / sizeof(channelList[0]);
+  int best = 0;
+
+  for (int i = 0; i < numChannels; i++) {
+    int channel = channelList[i];
+    if (channel < 1 || channel > Channel::maxChannel) {
+      continue;
+    }
+    if (best == 0 || Channel::weight(channel) > Channel::weight(best)) {
+      best = channel;
+    }
+  }
+
+  return (best != 0) ? best : Config::channel;
+}
+
+/**
+ * How likely a channel is to be picked
+ * @param channel Channel to check
+ */
+float Channel::weight(int channel) {
+  channel_stats_t *stats = &Channel::stats[channel];
+  float weight = stats->score;
+
+  if (stats->beacons > 0 &&
+      millis() - stats->lastPeer < channelBonusTime) {
+    weight += channelBonus;
+  }
+
+  return max(weight, channelFloor);
+}
+
+/**
+ * Scores the visit to the channel we're about to leave
+ */
+void Channel::score() {
+  if (Channel::visitChannel == 0 || Channel::visitDwell == 0) {
+    return;
+  }
+
+  channel_stats_t *stats = &Channel::stats[Channel::visitChannel];
+  uint32_t frames = stats->frames - Channel::visitFrames;
+  uint32_t beacons = stats->beacons - Channel::visitBeacons;
+
+  // we listen for longer than the dwell (detect() waits a bit before it),
+  // so go by how long we were actually here, like sweep() does
+  unsigned long listened = max(millis() - Channel::visitStart, 1UL);
+
+  // a few pwngrid beacons make a perfect visit, busy air helps a little
+  float perSecond = frames * 1000.0f / listened;
+  float reward = min(beacons / 5.0f, 1.0f) * 0.8f +
+                 min(perSecond / 100.0f, 1.0f) * 0.2f;
+
+  stats->score += (reward - stats->score) * channelAlpha;
+  Channel::visitChannel = 0;
 }
 
 /**
@@ -96,28 +432,102 @@ void Channel::cycle() {
  */
 void Channel::switchChannel(int newChannel) {
   // switch to channel
-  delay(250);
-  Serial.print("(-.-) Switching to channel ");
-  Serial.println(newChannel);
-  Serial.println(" ");
-  Display::updateDisplay("(-.-)", "Switching to channel " + (String)newChannel);
-  delay(250);
+  Console.print("(-.-) Switching to channel ");
+  Console.println(newChannel);
+  Console.println(" ");
+  Mood::enter(mood_t::SLEEPING, "Switching to channel " + (String)newChannel);
 
   // monitor this one channel
-  Minigotchi::monStop();
-  esp_err_t err = esp_wifi_set_channel(newChannel, WIFI_SECOND_CHAN_NONE);
-  Minigotchi::monStart();
+  bool switched = Channel::hop(newChannel);
+  Channel::printHops();
 
   // check if the channel switch was successful
-  if (err == ESP_OK) {
+  if (switched) {
     checkChannel(newChannel);
   } else {
 
-    Serial.println("(X-X) Failed to switch channel.");
-    Serial.println(" ");
-    Display::updateDisplay("(X-X)", "Failed to switch channel.");
+    Console.println("(X-X) Failed to switch channel.");
+    Console.println(" ");
+    Mood::enter(mood_t::BROKEN, "Failed to switch channel.");
     checkChannel(newChannel);
-    delay(250);
+  }
+}
+
+/** developer note:
+ *
+ * switching channels used to mean leaving promiscuous mode, setting the
+ * channel, then disconnecting, going back to station mode and turning
+ * promiscuous mode back on. the radio doesn't need any of that to change
+ * channels, so hop() only sets the channel and leaves everything else alone.
+ *
+ * if that doesn't work (the driver refuses when it's busy with something
+ * else) it falls back to the old way. both are timed separately so the two
+ * can be compared, see printHops().
+ *
+ */
+
+/**
+ * Changes channel as quickly as possible, returns whether it worked
+ * @param newChannel Channel to hop to
+ */
+bool Channel::hop(int newChannel) {
+  unsigned long start = micros();
+  if (Radio::setChannel(newChannel)) {
+    Channel::record(&Channel::fastHops, micros() - start);
+    return true;
+  }
+
+  // do it the slow way
+  start = micros();
+  bool promiscuous = Radio::promiscuous();
+  Minigotchi::monStop();
+  bool hopped = Radio::setChannel(newChannel);
+  if (promiscuous) {
+    Minigotchi::monStart();
+  }
+  Channel::record(&Channel::slowHops, micros() - start);
+
+  return hopped;
+}
+
+/**
+ * Adds a hop to the timing stats
+ * @param hops Stats to add to
+ * @param time How long the hop took in microseconds
+ */
+void Channel::record(channel_hop_stats_t *hops, uint32_t time) {
+  hops->count++;
+  hops->last = time;
+  hops->total += time;
+  hops->min = min(hops->min, time);
+  hops->max = max(hops->max, time);
+}
+
+/**
+ * Prints how long hops have been taking
+ */
+void Channel::printHops() {
+  const channel_hop_stats_t *all[] = {&Channel::fastHops, &Channel::slowHops};
+  const char *names[] = {"fast", "slow"};
+
+  for (int i = 0; i < 2; i++) {
+    if (all[i]->count == 0) {
+      continue;
+    }
+
+    Console.print("('-') ");
+    Console.print(names[i]);
+    Console.print(" hops: last ");
+    Console.print(all[i]->last);
+    Console.print(" us, avg ");
+    Console.print((uint32_t)(all[i]->total / all[i]->count));
+    Console.print(" us, min ");
+    Console.print(all[i]->min);
+    Console.print(" us, max ");
+    Console.print(all[i]->max);
+    Console.print(" us over ");
+    Console.print(all[i]->count);
+    Console.println(" hops");
   }
 }
 
@@ -128,23 +538,21 @@ void Channel::switchChannel(int newChannel) {
 void Channel::checkChannel(int channel) {
   int currentChannel = Channel::getChannel();
   if (channel == currentChannel) {
-    Serial.print("('-') Currently on channel ");
-    Serial.println(currentChannel);
-    Display::updateDisplay("('-')",
-                           "Currently on channel " + (String)getChannel());
-    Serial.println(" ");
-    delay(250);
+    Console.print("('-') Currently on channel ");
+    Console.println(currentChannel);
+    Mood::enter(mood_t::NEUTRAL,
+                "Currently on channel " + (String)getChannel());
+    Console.println(" ");
   } else {
-    Serial.print("(X-X) Channel switch to channel ");
-    Serial.print(channel);
-    Serial.println(" has failed");
-    Serial.print("(X-X) Currently on channel ");
-    Serial.print(currentChannel);
-    Serial.println(" instead");
-    Serial.println(" ");
-    Display::updateDisplay("(X-X)", "Channel switch to " + (String)channel +
+    Console.print("(X-X) Channel switch to channel ");
+    Console.print(channel);
+    Console.println(" has failed");
+    Console.print("(X-X) Currently on channel ");
+    Console.print(currentChannel);
+    Console.println(" instead");
+    Console.println(" ");
+    Mood::enter(mood_t::BROKEN, "Channel switch to " + (String)channel +
                                         " has failed");
-    delay(250);
   }
 }
 
@@ -166,9 +574,4 @@ bool Channel::isValidChannel(int channel) {
 /**
  * Returns current channel as an integer
  */
-int Channel::getChannel() {
-  uint8_t primary;
-  wifi_second_chan_t second;
-  esp_wifi_get_channel(&primary, &second);
-  return primary;
-}
+int Channel::getChannel() { return Radio::getChannel(); }
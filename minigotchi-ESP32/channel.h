@@ -24,23 +24,79 @@
 #define CHANNEL_H
 
 #include "config.h"
+#include "console.h"
 #include "display.h"
 #include "minigotchi.h"
 #include "parasite.h"
-#include <WiFi.h>
+#include "radio.h"
+#include "scheduler.h"
 #include <esp_wifi.h>
 
+// what we've seen on a channel so far
+typedef struct {
+  volatile uint32_t frames;
+  uint32_t beacons;
+  unsigned long lastPeer;
+  float score;
+} channel_stats_t;
+
+// how long channel hops have been taking, in microseconds
+typedef struct {
+  uint32_t count;
+  uint32_t last;
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;
+} channel_hop_stats_t;
+
 class Channel {
 public:
   static void init(int initChannel);
-  static void cycle();
+  static unsigned long cycle();
   static void switchChannel(int newChannel);
+  static bool hop(int newChannel);
+  static void printHops();
+  static void startSweep();
+  static bool sweep();
+  static void printSweep();
   static int getChannel();
   static void checkChannel(int channel);
   static bool isValidChannel(int channel);
   static int channelList[13]; // 13 channels
+  static void count(uint8_t channel);
+  static void heard(uint8_t channel);
+  static unsigned long dwell();
+
+  // highest channel we keep stats for
+  static const int maxChannel = 14;
+
+  // hops that only changed the channel, and ones that had to restart
+  // promiscuous mode to do it
+  static channel_hop_stats_t fastHops;
+  static channel_hop_stats_t slowHops;
 
 private:
+  static void record(channel_hop_stats_t *hops, uint32_t time);
+  static void visit(int channel, unsigned long dwell);
+  static int pick();
+  static int best();
+  static float weight(int channel);
+  static void score();
+  static channel_stats_t stats[];
+  static int visitChannel;
+  static uint32_t visitFrames;
+  static uint32_t visitBeacons;
+  static unsigned long visitDwell;
+  static unsigned long visitStart;
+
+  // the sweep we're on now
+  static int sweepIndex;
+  static unsigned long sweepStart;
+  static unsigned long sweepTime;
+  static bool swept[];
+  static float sweepRate[];
+  static uint32_t sweepBeacons[];
+
   static int randomIndex;
   static int numChannels;
   static int currentChannel;
@@ -0,0 +1,657 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * compression.cpp: compresses pwngrid payloads
+ */
+
+#include "compression.h"
+
+/** developer note:
+ *
+ * pwngrid can gzip the json it puts into a beacon, which is marked with an
+ * IDWhisperCompression element in front of the payload chunks. see:
+ *
+ * https://github.com/evilsocket/pwngrid/blob/master/wifi/compression.go
+ *
+ * zlib is way too big for what we need, so this is a tiny deflate encoder.
+ * it only does LZ77 matching with the fixed huffman codes from RFC 1951, so
+ * memory use is just the hash chains below no matter how much goes in.
+ *
+ * going the other way, decompress() handles anything pwngrid sends us. it's
+ * a plain canonical huffman decoder in the style of zlib's puff.c, writing
+ * into a fixed buffer and giving up if the data doesn't fit.
+ *
+ */
+
+const size_t Compression::windowSize;
+
+uint16_t Compression::head[256];
+uint16_t Compression::prev[Compression::windowSize];
+uint8_t *Compression::out = nullptr;
+size_t Compression::outSize = 0;
+size_t Compression::outLength = 0;
+uint32_t Compression::bitBuffer = 0;
+uint8_t Compression::bitCount = 0;
+
+const uint8_t *Compression::in = nullptr;
+size_t Compression::inLength = 0;
+size_t Compression::inPos = 0;
+compression_huffman_t Compression::literals;
+compression_huffman_t Compression::distances;
+
+// RFC 1951 length and distance tables
+static const uint16_t lengthBase[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                        1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                        4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distanceBase[30] = {
+    1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+    33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2,  2,  3,  3,
+                                          4, 4, 5, 5, 6, 6, 7,  7,  8,  8,
+                                          9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// no position in the hash chains
+static const uint16_t NIL = 0xFFFF;
+
+// don't walk the hash chains forever
+static const int maxChain = 32;
+
+/**
+ * Gzips data the way pwngrid's Compress() does, returns the compressed
+ * length or 0 if it doesn't fit in the output buffer
+ * @param in Data to compress
+ * @param inLength Length of the data
+ * @param out Buffer to write to
+ * @param outSize The size of the buffer
+ */
+size_t Compression::compress(const uint8_t *in, size_t inLength, uint8_t *out,
+                             size_t outSize) {
+  // 10 byte header, 8 byte trailer
+  if (outSize < 18) {
+    return 0;
+  }
+
+  static const uint8_t header[10] = {0x1f, 0x8b, 0x08, 0x00, 0x00,
+                                     0x00, 0x00, 0x00, 0x02, 0xff};
+  memcpy(out, header, sizeof(header));
+
+  size_t length = Compression::deflate(in, inLength, out + sizeof(header),
+                                       outSize - sizeof(header) - 8);
+  if (length == 0) {
+    return 0;
+  }
+  length += sizeof(header);
+
+  uint32_t crc = Compression::crc32(in, inLength);
+  for (int i = 0; i < 4; i++) {
+    out[length++] = (uint8_t)(crc >> (8 * i));
+  }
+  for (int i = 0; i < 4; i++) {
+    out[length++] = (uint8_t)(inLength >> (8 * i));
+  }
+
+  return length;
+}
+
+/**
+ * Compresses data into a single raw deflate block, returns the compressed
+ * length or 0 if it doesn't fit in the output buffer
+ * @param in Data to compress
+ * @param inLength Length of the data
+ * @param out Buffer to write to
+ * @param outSize The size of the buffer
+ */
+size_t Compression::deflate(const uint8_t *in, size_t inLength, uint8_t *out,
+                            size_t outSize) {
+  Compression::out = out;
+  Compression::outSize = outSize;
+  Compression::outLength = 0;
+  Compression::bitBuffer = 0;
+  Compression::bitCount = 0;
+  for (size_t i = 0; i < 256; i++) {
+    Compression::head[i] = NIL;
+  }
+
+  // final block, fixed huffman codes
+  if (!Compression::putBits(1, 1) || !Compression::putBits(1, 2)) {
+    return 0;
+  }
+
+  size_t pos = 0;
+  while (pos < inLength) {
+    size_t bestLength = 0;
+    size_t bestDistance = 0;
+
+    if (pos + 3 <= inLength) {
+      size_t maxLength = inLength - pos;
+      if (maxLength > 258) {
+        maxLength = 258;
+      }
+
+      uint16_t candidate = Compression::head[Compression::hash(in + pos)];
+      for (int chain = 0; candidate != NIL && chain < maxChain; chain++) {
+        size_t distance = pos - candidate;
+        if (distance >= Compression::windowSize) {
+          break;
+        }
+
+        size_t length = 0;
+        while (length < maxLength &&
+               in[candidate + length] == in[pos + length]) {
+          length++;
+        }
+        if (length > bestLength) {
+          bestLength = length;
+          bestDistance = distance;
+          if (length == maxLength) {
+            break;
+          }
+        }
+
+        // chains only ever go backwards, anything else was overwritten
+        uint16_t next = Compression::prev[candidate & (windowSize - 1)];
+        if (next == NIL || next >= candidate) {
+          break;
+        }
+        candidate = next;
+      }
+    }
+
+    size_t advance = 1;
+    if (bestLength >= 3) {
+      if (!Compression::putMatch(bestLength, bestDistance)) {
+        return 0;
+      }
+      advance = bestLength;
+    } else if (!Compression::putLiteral(in[pos])) {
+      return 0;
+    }
+
+    // remember every position we skip over
+    for (size_t i = 0; i < advance; i++, pos++) {
+      if (pos + 3 <= inLength) {
+        uint16_t h = Compression::hash(in + pos);
+        Compression::prev[pos & (windowSize - 1)] = Compression::head[h];
+        Compression::head[h] = (uint16_t)pos;
+      }
+    }
+  }
+
+  // end of block, then flush whatever bits are left
+  if (!Compression::putCode(0, 7) || !Compression::putBits(0, 7)) {
+    return 0;
+  }
+
+  return Compression::outLength;
+}
+
+/**
+ * Gunzips data, returns the decompressed length or 0 if the data is
+ * corrupted or doesn't fit in the output buffer
+ * @param in Data to decompress
+ * @param inLength Length of the data
+ * @param out Buffer to write to
+ * @param outSize The size of the buffer
+ */
+size_t Compression::decompress(const uint8_t *in, size_t inLength,
+                               uint8_t *out, size_t outSize) {
+  if (inLength < 18 || in[0] != 0x1f || in[1] != 0x8b || in[2] != 0x08) {
+    return 0;
+  }
+
+  // skip over the optional header fields
+  uint8_t flags = in[3];
+  size_t pos = 10;
+  if (flags & 0x04) {
+    pos += 2 + (in[pos] | (in[pos + 1] << 8));
+  }
+  if (flags & 0x08) {
+    while (pos < inLength && in[pos] != 0) {
+      pos++;
+    }
+    pos++;
+  }
+  if (flags & 0x10) {
+    while (pos < inLength && in[pos] != 0) {
+      pos++;
+    }
+    pos++;
+  }
+  if (flags & 0x02) {
+    pos += 2;
+  }
+  if (pos + 8 > inLength) {
+    return 0;
+  }
+
+  size_t length =
+      Compression::inflate(in + pos, inLength - pos - 8, out, outSize);
+  if (length == 0) {
+    return 0;
+  }
+
+  // check the trailer
+  const uint8_t *trailer = in + inLength - 8;
+  uint32_t crc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) |
+                 ((uint32_t)trailer[3] << 24);
+  uint32_t size = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) |
+                  ((uint32_t)trailer[7] << 24);
+  if (crc != Compression::crc32(out, length) || size != length) {
+    return 0;
+  }
+
+  return length;
+}
+
+/**
+ * Decompresses raw deflate data, returns the decompressed length or 0 if
+ * the data is corrupted or doesn't fit in the output buffer
+ * @param in Data to decompress
+ * @param inLength Length of the data
+ * @param out Buffer to write to
+ * @param outSize The size of the buffer
+ */
+size_t Compression::inflate(const uint8_t *in, size_t inLength, uint8_t *out,
+                            size_t outSize) {
+  Compression::in = in;
+  Compression::inLength = inLength;
+  Compression::inPos = 0;
+  Compression::out = out;
+  Compression::outSize = outSize;
+  Compression::outLength = 0;
+  Compression::bitBuffer = 0;
+  Compression::bitCount = 0;
+
+  uint32_t last = 0;
+  while (last == 0) {
+    uint32_t type;
+    if (!Compression::getBits(1, &last) || !Compression::getBits(2, &type)) {
+      return 0;
+    }
+
+    bool ok = false;
+    if (type == 0) {
+      ok = Compression::inflateStored();
+    } else if (type == 1) {
+      ok = Compression::buildFixed() && Compression::inflateBlock();
+    } else if (type == 2) {
+      ok = Compression::buildDynamic() && Compression::inflateBlock();
+    }
+
+    if (!ok) {
+      return 0;
+    }
+  }
+
+  return Compression::outLength;
+}
+
+/**
+ * Calculates the CRC-32 gzip expects in its trailer
+ * @param data Data to use
+ * @param length Length of the data
+ */
+uint32_t Compression::crc32(const uint8_t *data, size_t length) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+/**
+ * Writes bits to the output, least significant bit first
+ * @param value Bits to write
+ * @param count Number of bits
+ */
+bool Compression::putBits(uint32_t value, uint8_t count) {
+  Compression::bitBuffer |= value << Compression::bitCount;
+  Compression::bitCount += count;
+
+  while (Compression::bitCount >= 8) {
+    if (Compression::outLength >= Compression::outSize) {
+      return false;
+    }
+    Compression::out[Compression::outLength++] =
+        (uint8_t)Compression::bitBuffer;
+    Compression::bitBuffer >>= 8;
+    Compression::bitCount -= 8;
+  }
+
+  return true;
+}
+
+/**
+ * Writes a huffman code, which deflate stores most significant bit first
+ * @param code Code to write
+ * @param length Length of the code in bits
+ */
+bool Compression::putCode(uint16_t code, uint8_t length) {
+  uint16_t reversed = 0;
+  for (uint8_t i = 0; i < length; i++) {
+    reversed = (reversed << 1) | ((code >> i) & 1);
+  }
+  return Compression::putBits(reversed, length);
+}
+
+/**
+ * Writes a literal byte with the fixed literal/length codes
+ * @param literal Byte to write
+ */
+bool Compression::putLiteral(uint8_t literal) {
+  if (literal < 144) {
+    return Compression::putCode(0x30 + literal, 8);
+  }
+  return Compression::putCode(0x190 + (literal - 144), 9);
+}
+
+/**
+ * Writes a back reference with the fixed length and distance codes
+ * @param length Length of the match, 3 to 258
+ * @param distance How far back the match starts
+ */
+bool Compression::putMatch(size_t length, size_t distance) {
+  int lengthCode = 28;
+  while (lengthBase[lengthCode] > length) {
+    lengthCode--;
+  }
+
+  uint16_t symbol = 257 + lengthCode;
+  bool ok = (symbol < 280) ? Compression::putCode(symbol - 256, 7)
+                           : Compression::putCode(0xC0 + (symbol - 280), 8);
+  ok = ok && Compression::putBits(length - lengthBase[lengthCode],
+                                  lengthExtra[lengthCode]);
+
+  int distanceCode = 29;
+  while (distanceBase[distanceCode] > distance) {
+    distanceCode--;
+  }
+
+  return ok && Compression::putCode(distanceCode, 5) &&
+         Compression::putBits(distance - distanceBase[distanceCode],
+                              distanceExtra[distanceCode]);
+}
+
+/**
+ * Hashes the next three bytes for the match finder
+ * @param data Bytes to hash
+ */
+uint16_t Compression::hash(const uint8_t *data) {
+  return (uint16_t)((data[0] * 31u + data[1]) * 31u + data[2]) & 0xFF;
+}
+
+/**
+ * Reads bits from the input, least significant bit first
+ * @param count Number of bits, 16 at most
+ * @param value Where to put the bits
+ */
+bool Compression::getBits(uint8_t count, uint32_t *value) {
+  while (Compression::bitCount < count) {
+    if (Compression::inPos >= Compression::inLength) {
+      return false;
+    }
+    Compression::bitBuffer |= (uint32_t)Compression::in[Compression::inPos++]
+                              << Compression::bitCount;
+    Compression::bitCount += 8;
+  }
+
+  *value = Compression::bitBuffer & ((1u << count) - 1);
+  Compression::bitBuffer >>= count;
+  Compression::bitCount -= count;
+  return true;
+}
+
+/**
+ * Decodes the next symbol, returns -1 if there is none
+ * @param table Huffman code to use
+ */
+int Compression::decode(const compression_huffman_t *table) {
+  int code = 0;
+  int first = 0;
+  int index = 0;
+
+  for (int length = 1; length < 16; length++) {
+    uint32_t bit;
+    if (!Compression::getBits(1, &bit)) {
+      return -1;
+    }
+
+    code |= bit;
+    int count = table->counts[length];
+    if (code - count < first) {
+      return table->symbols[index + (code - first)];
+    }
+    index += count;
+    first += count;
+    first <<= 1;
+    code <<= 1;
+  }
+
+  return -1;
+}
+
+/**
+ * Builds a huffman code from the code length of every symbol
+ * @param table Huffman code to build
+ * @param lengths Code length of each symbol, 0 if unused
+ * @param count Number of symbols
+ */
+void Compression::build(compression_huffman_t *table, const uint8_t *lengths,
+                        size_t count) {
+  uint16_t offsets[16];
+
+  memset(table->counts, 0, sizeof(table->counts));
+  for (size_t i = 0; i < count; i++) {
+    table->counts[lengths[i]]++;
+  }
+  table->counts[0] = 0;
+
+  offsets[1] = 0;
+  for (int length = 1; length < 15; length++) {
+    offsets[length + 1] = offsets[length] + table->counts[length];
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (lengths[i] != 0) {
+      table->symbols[offsets[lengths[i]]++] = i;
+    }
+  }
+}
+
+/**
+ * Sets up the fixed huffman codes from RFC 1951
+ */
+bool Compression::buildFixed() {
+  uint8_t lengths[288];
+  for (int i = 0; i < 288; i++) {
+    lengths[i] = (i < 144) ? 8 : (i < 256) ? 9 : (i < 280) ? 7 : 8;
+  }
+  Compression::build(&Compression::literals, lengths, 288);
+
+  for (int i = 0; i < 30; i++) {
+    lengths[i] = 5;
+  }
+  Compression::build(&Compression::distances, lengths, 30);
+  return true;
+}
+
+/**
+ * Reads the huffman codes sent at the start of a dynamic block
+ */
+bool Compression::buildDynamic() {
+  static const uint8_t order[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                    11, 4,  12, 3, 13, 2, 14, 1, 15};
+  uint8_t lengths[288 + 30];
+  uint32_t literalCount, distanceCount, codeCount;
+
+  if (!Compression::getBits(5, &literalCount) ||
+      !Compression::getBits(5, &distanceCount) ||
+      !Compression::getBits(4, &codeCount)) {
+    return false;
+  }
+  literalCount += 257;
+  distanceCount += 1;
+  codeCount += 4;
+  if (literalCount > 286 || distanceCount > 30) {
+    return false;
+  }
+
+  // code lengths for the code lengths
+  memset(lengths, 0, 19);
+  for (uint32_t i = 0; i < codeCount; i++) {
+    uint32_t length;
+    if (!Compression::getBits(3, &length)) {
+      return false;
+    }
+    lengths[order[i]] = length;
+  }
+  Compression::build(&Compression::literals, lengths, 19);
+
+  // then the literal/length and distance code lengths themselves
+  uint32_t i = 0;
+  while (i < literalCount + distanceCount) {
+    int symbol = Compression::decode(&Compression::literals);
+    if (symbol < 0) {
+      return false;
+    }
+
+    if (symbol < 16) {
+      lengths[i++] = symbol;
+      continue;
+    }
+
+    uint8_t length = 0;
+    uint32_t repeat;
+    if (symbol == 16) {
+      if (i == 0 || !Compression::getBits(2, &repeat)) {
+        return false;
+      }
+      length = lengths[i - 1];
+      repeat += 3;
+    } else if (symbol == 17) {
+      if (!Compression::getBits(3, &repeat)) {
+        return false;
+      }
+      repeat += 3;
+    } else {
+      if (!Compression::getBits(7, &repeat)) {
+        return false;
+      }
+      repeat += 11;
+    }
+
+    if (i + repeat > literalCount + distanceCount) {
+      return false;
+    }
+    while (repeat--) {
+      lengths[i++] = length;
+    }
+  }
+
+  Compression::build(&Compression::literals, lengths, literalCount);
+  Compression::build(&Compression::distances, lengths + literalCount,
+                     distanceCount);
+  return true;
+}
+
+/**
+ * Copies an uncompressed block to the output
+ */
+bool Compression::inflateStored() {
+  // stored blocks start on a byte boundary
+  Compression::bitBuffer = 0;
+  Compression::bitCount = 0;
+
+  if (Compression::inPos + 4 > Compression::inLength) {
+    return false;
+  }
+  const uint8_t *header = Compression::in + Compression::inPos;
+  uint16_t length = header[0] | (header[1] << 8);
+  uint16_t inverse = header[2] | (header[3] << 8);
+  Compression::inPos += 4;
+
+  if ((uint16_t)~inverse != length ||
+      Compression::inPos + length > Compression::inLength ||
+      Compression::outLength + length > Compression::outSize) {
+    return false;
+  }
+
+  memcpy(Compression::out + Compression::outLength,
+         Compression::in + Compression::inPos, length);
+  Compression::inPos += length;
+  Compression::outLength += length;
+  return true;
+}
+
+/**
+ * Decodes a huffman compressed block to the output
+ */
+bool Compression::inflateBlock() {
+  while (true) {
+    int symbol = Compression::decode(&Compression::literals);
+    if (symbol < 0 || symbol > 285) {
+      return false;
+    }
+
+    if (symbol < 256) {
+      if (Compression::outLength >= Compression::outSize) {
+        return false;
+      }
+      Compression::out[Compression::outLength++] = symbol;
+      continue;
+    }
+
+    if (symbol == 256) {
+      return true;
+    }
+
+    uint32_t extra;
+    symbol -= 257;
+    if (!Compression::getBits(lengthExtra[symbol], &extra)) {
+      return false;
+    }
+    size_t length = lengthBase[symbol] + extra;
+
+    symbol = Compression::decode(&Compression::distances);
+    if (symbol < 0 || symbol > 29 ||
+        !Compression::getBits(distanceExtra[symbol], &extra)) {
+      return false;
+    }
+    size_t distance = distanceBase[symbol] + extra;
+
+    if (distance > Compression::outLength ||
+        Compression::outLength + length > Compression::outSize) {
+      return false;
+    }
+
+    // byte by byte, the copy may overlap itself
+    for (size_t i = 0; i < length; i++) {
+      Compression::out[Compression::outLength] =
+          Compression::out[Compression::outLength - distance];
+      Compression::outLength++;
+    }
+  }
+}
@@ -0,0 +1,82 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * compression.h: header files for compression.cpp
+ */
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// canonical huffman code, as counts per code length and sorted symbols
+typedef struct {
+  uint16_t counts[16];
+  uint16_t symbols[288];
+} compression_huffman_t;
+
+class Compression {
+public:
+  static size_t compress(const uint8_t *in, size_t inLength, uint8_t *out,
+                         size_t outSize);
+  static size_t deflate(const uint8_t *in, size_t inLength, uint8_t *out,
+                        size_t outSize);
+  static size_t decompress(const uint8_t *in, size_t inLength, uint8_t *out,
+                           size_t outSize);
+  static size_t inflate(const uint8_t *in, size_t inLength, uint8_t *out,
+                        size_t outSize);
+  static uint32_t crc32(const uint8_t *data, size_t length);
+
+  // how far back matches may reach, must be a power of two
+  static const size_t windowSize = 1024;
+
+private:
+  static bool putBits(uint32_t value, uint8_t count);
+  static bool putCode(uint16_t code, uint8_t length);
+  static bool putLiteral(uint8_t literal);
+  static bool putMatch(size_t length, size_t distance);
+  static uint16_t hash(const uint8_t *data);
+
+  static bool getBits(uint8_t count, uint32_t *value);
+  static int decode(const compression_huffman_t *table);
+  static void build(compression_huffman_t *table, const uint8_t *lengths,
+                    size_t count);
+  static bool buildFixed();
+  static bool buildDynamic();
+  static bool inflateStored();
+  static bool inflateBlock();
+
+  static uint16_t head[256];
+  static uint16_t prev[windowSize];
+  static uint8_t *out;
+  static size_t outSize;
+  static size_t outLength;
+  static uint32_t bitBuffer;
+  static uint8_t bitCount;
+
+  static const uint8_t *in;
+  static size_t inLength;
+  static size_t inPos;
+  static compression_huffman_t literals;
+  static compression_huffman_t distances;
+};
+
+#endif // COMPRESSION_H
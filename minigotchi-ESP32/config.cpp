@@ -35,6 +35,17 @@ bool Config::deauth = true;
 bool Config::advertise = true;
 bool Config::scan = true;
 
+// gzip our advertisments like pwngrid can, so they spend less time on air
+bool Config::compression = false;
+
+// listen on every channel for a moment each scan instead of on one channel the
+// whole time, and how long to stay on each one in milliseconds
+bool Config::sweep = false;
+int Config::sweepDwell = 500;
+
+// record sent and received frames and stream them over serial for wireshark
+bool Config::capture = false;
+
 // define universal delays
 int Config::shortDelay = 500;
 int Config::longDelay = 5000;
@@ -43,9 +54,9 @@ int Config::longDelay = 5000;
 // Pwnagotchi
 bool Config::parasite = false;
 
-// screen configuration
+// screen configuration, the screen type itself is set in config.h
 bool Config::display = false;
-std::string Config::screen = "";
+constexpr config_screen_t Config::screen;
 
 // define baud rate
 int Config::baud = 115200;
@@ -56,16 +67,6 @@ int Config::channel = 1;
 // define whitelist
 std::vector<std::string> Config::whitelist = {"SSID", "SSID", "SSID"};
 
-// define faces
-String Config::happy = "(^-^)";
-String Config::sad = "(;-;)";
-String Config::broken = "(X-X)";
-String Config::intense = "(>-<)";
-String Config::looking1 = "(0-o)";
-String Config::looking2 = "(o-0)";
-String Config::neutral = "('-')";
-String Config::sleeping = "(-.-)";
-
 // json config
 int Config::epoch = Minigotchi::currentEpoch;
 std::string Config::face = "(^-^)";
@@ -23,6 +23,25 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+// screens the display code can be built for. these are plain numbers and
+// not an enum so display.h can tell which driver to include, which is also
+// why they come before anything else gets included
+#define SCREEN_NONE 0
+#define SCREEN_SSD1306 1
+#define SCREEN_WEMOS_OLED_SHIELD 2
+#define SCREEN_CYD 3
+#define SCREEN_T_DISPLAY_S3 4
+#define SCREEN_M5STICKCP 5
+#define SCREEN_M5STICKCP2 6
+#define SCREEN_M5CARDPUTER 7
+#define SCREEN_SSD1305 8
+#define SCREEN_IDEASPARK_SSD1306 9
+#define SCREEN_SH1106 10
+
+// the screen we're built for, set here instead of config.cpp so only its
+// driver gets built in
+#define CONFIG_SCREEN SCREEN_NONE
+
 #include "minigotchi.h"
 #include "parasite.h"
 #include <Arduino.h>
@@ -32,27 +51,26 @@
 #include <string>
 #include <vector>
 
+// one of the SCREEN_ numbers above
+typedef uint8_t config_screen_t;
+
 class Config {
 public:
   static bool deauth;
   static bool advertise;
   static bool scan;
+  static bool compression;
+  static bool sweep;
+  static int sweepDwell;
+  static bool capture;
   static int shortDelay;
   static int longDelay;
   static bool parasite;
   static bool display;
-  static std::string screen;
+  static constexpr config_screen_t screen = CONFIG_SCREEN;
   static int baud;
   static int channel;
   static std::vector<std::string> whitelist;
-  static String happy;
-  static String sad;
-  static String broken;
-  static String intense;
-  static String looking1;
-  static String looking2;
-  static String neutral;
-  static String sleeping;
   static int epoch;
   static std::string face;
   static std::string identity;
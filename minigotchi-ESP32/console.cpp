@@ -0,0 +1,163 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * console.cpp: hands serial output to its own task
+ */
+
+#include "console.h"
+
+/** developer note:
+ *
+ * printing to serial is slow, and when it ran on the same task as the radio
+ * it added straight to how long advertising and scanning took.
+ *
+ * so the radio stays on the arduino loop task, and once begin() is called
+ * everything printed through Console is put on a queue instead. a
+ * presentation task pinned to the other core takes it off the queue in order
+ * and does the actual printing. the screen has its own task for the same
+ * reason, see display.cpp.
+ *
+ * serial output is never thrown away, if the queue is full the radio waits
+ * for a free spot. before begin() it goes straight out like it always did,
+ * which is what boot needs.
+ *
+ * binary data (see capture.cpp) doesn't go through the line buffer at all.
+ * writeRaw() only queues a pointer to it, the presentation task writes it
+ * from wherever it is and calls back once it's out. that one doesn't wait
+ * for a spot either, the caller just tries again later.
+ *
+ */
+
+ConsoleClass Console;
+
+const UBaseType_t ConsoleClass::queueLength;
+
+/**
+ * Starts the presentation task on the core the radio isn't using
+ */
+void ConsoleClass::begin() {
+  if (this->queue != nullptr) {
+    return;
+  }
+
+  this->line.length = 0;
+  this->line.data = nullptr;
+  this->line.done = nullptr;
+
+  this->queue =
+      xQueueCreate(ConsoleClass::queueLength, sizeof(console_message_t));
+  if (this->queue == nullptr) {
+    Serial.println("(X-X) Couldn't make the console queue!");
+    return;
+  }
+
+#if CONFIG_FREERTOS_UNICORE
+  BaseType_t core = 0;
+#else
+  BaseType_t core = 1 - xPortGetCoreID();
+#endif
+
+  xTaskCreatePinnedToCore(ConsoleClass::task, "presentation", 8192, this, 1,
+                          &this->handle, core);
+}
+
+/**
+ * Prints a byte, sent off a line at a time
+ * @param c Byte to print
+ */
+size_t ConsoleClass::write(uint8_t c) { return this->write(&c, 1); }
+
+/**
+ * Prints some bytes, sent off a line at a time. a zero byte ends a parasite
+ * frame, so that goes out straight away too
+ * @param buffer Bytes to print
+ * @param size How many bytes
+ */
+size_t ConsoleClass::write(const uint8_t *buffer, size_t size) {
+  if (this->handle == nullptr) {
+    return Serial.write(buffer, size);
+  }
+
+  for (size_t i = 0; i < size; i++) {
+    this->line.text[this->line.length++] = buffer[i];
+    if (buffer[i] == '\n' || buffer[i] == 0 ||
+        this->line.length == sizeof(this->line.text)) {
+      this->send();
+    }
+  }
+
+  return size;
+}
+
+/**
+ * Writes raw bytes without copying them, returns false if they couldn't be
+ * queued yet. the bytes have to stay put until done is called
+ * @param data Bytes to write
+ * @param length How many bytes
+ * @param done Called with the length once they're written
+ */
+bool ConsoleClass::writeRaw(const uint8_t *data, size_t length,
+                            console_done_t done) {
+  if (this->handle == nullptr) {
+    Serial.write(data, length);
+    done(length);
+    return true;
+  }
+
+  // whatever text came before goes out first
+  if (this->line.length > 0) {
+    this->send();
+  }
+
+  console_message_t message;
+  message.length = length;
+  message.data = data;
+  message.done = done;
+  return xQueueSend(this->queue, &message, 0) == pdTRUE;
+}
+
+/**
+ * Queues up the current line for the presentation task
+ */
+void ConsoleClass::send() {
+  xQueueSend(this->queue, &this->line, portMAX_DELAY);
+  this->line.length = 0;
+}
+
+/**
+ * The presentation task, prints whatever comes in
+ * @param parameter The console
+ */
+void ConsoleClass::task(void *parameter) {
+  ConsoleClass *console = (ConsoleClass *)parameter;
+  console_message_t message;
+
+  for (;;) {
+    if (xQueueReceive(console->queue, &message, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+
+    if (message.data != nullptr) {
+      Serial.write(message.data, message.length);
+      message.done(message.length);
+    } else {
+      Serial.write((const uint8_t *)message.text, message.length);
+    }
+  }
+}
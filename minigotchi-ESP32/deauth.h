@@ -24,19 +24,31 @@
 #define DEAUTH_H
 
 #include "config.h"
+#include "console.h"
 #include "minigotchi.h"
 #include "parasite.h"
+#include "radio.h"
+#include "scheduler.h"
 #include <Arduino.h>
-#include <WiFi.h>
 #include <algorithm>
 #include <esp_wifi.h>
 #include <sstream>
 #include <string>
 #include <vector>
 
+// where deauth() is at
+typedef enum {
+  DEAUTH_START = 0,
+  DEAUTH_SCAN,
+  DEAUTH_ATTACK,
+  DEAUTH_SEND_DEAUTH,
+  DEAUTH_SEND_DISASSOCIATE,
+  DEAUTH_FINISH
+} deauth_state_t;
+
 class Deauth {
 public:
-  static void deauth();
+  static unsigned long deauth();
   static void list();
   static void add(const std::string &bssids);
   static uint8_t deauthTemp[26];
@@ -48,12 +60,20 @@ public:
 private:
   static bool send(uint8_t *buf, uint16_t len, bool sys_seq);
   static bool broadcast(uint8_t *mac);
-  static void printMac(uint8_t *mac);
-  static String printMacStr(uint8_t *mac);
-  static bool select();
+  static void printMac(const uint8_t *mac);
+  static String printMacStr(const uint8_t *mac);
+  static void scan();
+  static bool select(int apCount);
   static void start();
+  static void sent(bool deauthSent, bool disassociateSent);
   static uint8_t bssid[6];
+  static deauth_state_t state;
   static bool running;
+  static bool deauthSent;
+  static int packets;
+  static int pairs;
+  static int packetCount;
+  static unsigned long startTime;
   static std::vector<String> whitelist;
   static String randomAP;
 };
@@ -21,148 +21,239 @@
  */
 
 #include "display.h"
+#include "console.h"
 
-TFT_eSPI tft; // Define TFT_eSPI object
-
-Adafruit_SSD1306 *Display::ssd1306_adafruit_display = nullptr;
-Adafruit_SSD1305 *Display::ssd1305_adafruit_display = nullptr;
-U8G2_SSD1306_128X64_NONAME_F_SW_I2C *Display::ssd1306_ideaspark_display =
-    nullptr;
-U8G2_SH1106_128X64_NONAME_F_SW_I2C *Display::sh1106_adafruit_display = nullptr;
-TFT_eSPI *Display::tft_display = nullptr;
+/** developer note:
+ *
+ * the screen is picked at compile time with Config::screen in config.h.
+ * every screen has a DisplayScreen below, which says which driver it uses,
+ * how to start it and where the face and text go, and which backend draws
+ * on it. there's one backend per kind of driver (adafruit, u8g2 and
+ * TFT_eSPI), and only the one for our screen ever gets instantiated. so we
+ * don't compare strings on every update anymore. the drivers we don't use
+ * aren't even included (see display.h), so they can't end up in the image
+ * and a board without a screen doesn't need any of the libraries.
+ *
+ * every backend only redraws the face or the text if it changed. on the
+ * monochrome screens we then compare the frame buffer with a copy of what we
+ * sent last time: u8g2 screens only get the tiles that changed, and the
+ * adafruit ones (which can only send the whole buffer) are skipped if nothing
+ * changed.
+ *
+ * once begin() is called the drawing happens on a display task on the other
+ * core. updateDisplay() only drops the face and text in a slot each and
+ * pokes the task, so it never waits on i2c or spi. the task draws whatever
+ * is in the slots at most every frameInterval, so if something updates the
+ * screen faster than that (like a packet counter) only the latest one is
+ * drawn and the ones in between are counted as skipped.
+ *
+ */
 
-String Display::storedFace = "";
-String Display::previousFace = "";
+/**
+ * Draws nothing, for when there's no screen
+ */
+class NoBackend {
+public:
+  static void start() {}
+  static void draw(const String &, const String &, bool, bool) {}
+};
 
-String Display::storedText = "";
-String Display::previousText = "";
+#if defined(DISPLAY_SSD1306) || defined(DISPLAY_SSD1305)
 
 /**
- * Deletes any pointers if used
+ * Draws on the Adafruit SSD1306 and SSD1305 drivers
  */
-Display::~Display() {
-  if (ssd1306_adafruit_display) {
-    delete ssd1306_adafruit_display;
+template <typename Screen> class AdafruitBackend {
+public:
+  static void start() {
+    AdafruitBackend::screen = Screen::create();
+
+    // initialize w/ delays to prevent crash
+    AdafruitBackend::screen->display();
+    delay(100);
+    AdafruitBackend::screen->clearDisplay();
+    delay(100);
+    AdafruitBackend::screen->setTextColor(WHITE);
   }
-  if (ssd1305_adafruit_display) {
-    delete ssd1305_adafruit_display;
+
+  static void draw(const String &face, const String &text, bool faceChanged,
+                   bool textChanged) {
+    typename Screen::panel_t *screen = AdafruitBackend::screen;
+    if (faceChanged) {
+      screen->fillRect(0, 0, screen->width(), Screen::split, BLACK);
+      screen->setCursor(Screen::faceX, 0);
+      screen->setTextSize(2);
+      screen->println(face);
+    }
+    if (textChanged) {
+      screen->fillRect(0, Screen::split, screen->width(),
+                       screen->height() - Screen::split, BLACK);
+      screen->setCursor(0, Screen::split);
+      screen->setTextSize(1);
+      screen->println(text);
+    }
+
+    // the driver can only send the whole buffer, so only do it if we have to
+    size_t size = screen->width() * ((screen->height() + 7) / 8);
+    uint8_t *buffer = screen->getBuffer();
+    if (size > sizeof(AdafruitBackend::shadow)) {
+      screen->display();
+    } else if (!AdafruitBackend::shadowValid ||
+               memcmp(AdafruitBackend::shadow, buffer, size) != 0) {
+      screen->display();
+      memcpy(AdafruitBackend::shadow, buffer, size);
+      AdafruitBackend::shadowValid = true;
+    }
   }
-  if (ssd1306_ideaspark_display) {
-    delete ssd1306_ideaspark_display;
+
+private:
+  static typename Screen::panel_t *screen;
+
+  // what the screen is showing
+  static uint8_t shadow[DISPLAY_SHADOW_SIZE];
+  static bool shadowValid;
+};
+
+template <typename Screen>
+typename Screen::panel_t *AdafruitBackend<Screen>::screen = nullptr;
+template <typename Screen>
+uint8_t AdafruitBackend<Screen>::shadow[DISPLAY_SHADOW_SIZE];
+template <typename Screen> bool AdafruitBackend<Screen>::shadowValid = false;
+#endif
+
+#ifdef DISPLAY_U8G2
+
+/**
+ * Draws on the U8G2 drivers
+ */
+template <typename Screen> class U8G2Backend {
+public:
+  static void start() {
+    U8G2Backend::screen = Screen::create();
+    U8G2Backend::screen->clearBuffer();
   }
-  if (sh1106_adafruit_display) {
-    delete sh1106_adafruit_display;
+
+  static void draw(const String &face, const String &text, bool faceChanged,
+                   bool textChanged) {
+    U8G2 *screen = U8G2Backend::screen;
+    if (faceChanged) {
+      screen->setDrawColor(0);
+      screen->drawBox(0, 0, screen->getWidth(), Screen::split);
+      screen->setDrawColor(2);
+      screen->setFont(u8g2_font_10x20_tr);
+      screen->drawStr(0, 15, face.c_str());
+    }
+    if (textChanged) {
+      screen->setDrawColor(0);
+      screen->drawBox(0, Screen::split, screen->getWidth(),
+                      screen->getHeight() - Screen::split);
+      screen->setDrawColor(1);
+      Display::printU8G2Data(screen, u8g2_font_6x10_tr, 0, 32, text.c_str());
+    }
+    U8G2Backend::sendTiles();
   }
-  if (tft_display) {
-    delete tft_display;
+
+private:
+  /**
+   * Sends the tiles that changed since last time, one span per row of tiles
+   */
+  static void sendTiles() {
+    U8G2 *screen = U8G2Backend::screen;
+    uint8_t *buffer = screen->getBufferPtr();
+    int tilesWide = screen->getBufferTileWidth();
+    int tilesHigh = screen->getBufferTileHeight();
+    size_t rowSize = tilesWide * 8;
+    size_t size = rowSize * tilesHigh;
+
+    if (size > sizeof(U8G2Backend::shadow)) {
+      screen->sendBuffer();
+      return;
+    }
+
+    if (!U8G2Backend::shadowValid) {
+      screen->sendBuffer();
+      memcpy(U8G2Backend::shadow, buffer, size);
+      U8G2Backend::shadowValid = true;
+      return;
+    }
+
+    for (int ty = 0; ty < tilesHigh; ty++) {
+      uint8_t *row = buffer + ty * rowSize;
+      uint8_t *sent = U8G2Backend::shadow + ty * rowSize;
+      int first = -1;
+      int last = -1;
+      for (int tx = 0; tx < tilesWide; tx++) {
+        if (memcmp(row + tx * 8, sent + tx * 8, 8) != 0) {
+          if (first < 0) {
+            first = tx;
+          }
+          last = tx;
+        }
+      }
+
+      if (first >= 0) {
+        screen->updateDisplayArea(first, ty, last - first + 1, 1);
+        memcpy(sent + first * 8, row + first * 8, (last - first + 1) * 8);
+      }
+    }
   }
-}
+
+  static typename Screen::panel_t *screen;
+
+  // what the screen is showing
+  static uint8_t shadow[DISPLAY_SHADOW_SIZE];
+  static bool shadowValid;
+};
+
+template <typename Screen>
+typename Screen::panel_t *U8G2Backend<Screen>::screen = nullptr;
+template <typename Screen>
+uint8_t U8G2Backend<Screen>::shadow[DISPLAY_SHADOW_SIZE];
+template <typename Screen> bool U8G2Backend<Screen>::shadowValid = false;
+#endif
+
+#ifdef DISPLAY_TFT
 
 /**
- * Function to initialize the screen ONLY.
+ * Draws on the TFT_eSPI driver
  */
-void Display::startScreen() {
-  if (Config::display) {
-    if (Config::screen == "SSD1306") {
-      ssd1306_adafruit_display =
-          new Adafruit_SSD1306(SSD1306_SCREEN_WIDTH, SSD1306_SCREEN_HEIGHT,
-                               &Wire, SSD1306_OLED_RESET);
-      delay(100);
-      ssd1306_adafruit_display->begin(SSD1306_SWITCHCAPVCC,
-                                      0x3C); // for the 128x64 displays
-      delay(100);
-    } else if (Config::screen == "WEMOS_OLED_SHIELD") {
-      ssd1306_adafruit_display =
-          new Adafruit_SSD1306(WEMOS_OLED_SHIELD_OLED_RESET);
-      delay(100);
-      ssd1306_adafruit_display->begin(
-          SSD1306_SWITCHCAPVCC,
-          0x3C); // initialize with the I2C addr 0x3C (for the 64x48)
-      delay(100);
-    } else if (Config::screen == "SSD1305") {
-      ssd1305_adafruit_display = new Adafruit_SSD1305(
-          SSD1305_SCREEN_WIDTH, SSD1305_SCREEN_HEIGHT, &SPI, SSD1305_OLED_DC,
-          SSD1305_OLED_RESET, SSD1305_OLED_CS, 7000000UL);
-      ssd1305_adafruit_display->begin(SSD1305_I2C_ADDRESS,
-                                      0x3c); // initialize with the
-      // I2C addr 0x3C (for the 64x48)
-      delay(100);
-    } else if (Config::screen == "IDEASPARK_SSD1306") {
-      ssd1306_ideaspark_display = new U8G2_SSD1306_128X64_NONAME_F_SW_I2C(
-          U8G2_R0, IDEASPARK_SSD1306_SCL, IDEASPARK_SSD1306_SDA, U8X8_PIN_NONE);
-      delay(100);
-      ssd1306_ideaspark_display->begin();
-      delay(100);
-    } else if (Config::screen == "SH1106") {
-      sh1106_adafruit_display = new U8G2_SH1106_128X64_NONAME_F_SW_I2C(
-          U8G2_R0, SH1106_SCL, SH1106_SDA, U8X8_PIN_NONE);
-      delay(100);
-      sh1106_adafruit_display->begin();
-      delay(100);
-    } else if (Config::screen ==
-               "CYD") { // Check if the screen configuration is set to "CYD" and
-      // execute the corresponding code
-      tft_display = &tft;
-      tft.begin();        // Initialize TFT_eSPI library
-      tft.setRotation(1); // Set display rotation if needed
-      delay(100);
-    } else if (Config::screen == "T_DISPLAY_S3") {
-      tft_display = &tft;
-      tft.begin();
-      tft.setRotation(1); // Set display rotation if needed
-      delay(100);
-    } else {
-      ssd1306_adafruit_display =
-          new Adafruit_SSD1306(WEMOS_OLED_SHIELD_OLED_RESET);
-      delay(100);
-      ssd1306_adafruit_display->begin(
-          SSD1306_SWITCHCAPVCC,
-          0x3C); // initialize with the I2C addr 0x3C (for the 64x48)
-      delay(100);
-    }
+template <typename Screen> class TFTBackend {
+public:
+  static void start() {
+    TFTBackend::tft = new TFT_eSPI();
+    TFTBackend::tft->begin();
+    TFTBackend::tft->setRotation(1);
+    TFTBackend::tft->fillScreen(TFT_BLACK);
+  }
 
-    // initialize w/ delays to prevent crash
-    if (Config::screen == "SSD1306" && ssd1306_adafruit_display != nullptr) {
-      ssd1306_adafruit_display->display();
-      delay(100);
-      ssd1306_adafruit_display->clearDisplay();
-      delay(100);
-      ssd1306_adafruit_display->setTextColor(WHITE);
-      delay(100);
-    } else if (Config::screen == "SSD1305" &&
-               ssd1305_adafruit_display != nullptr) {
-      ssd1305_adafruit_display->display();
-      delay(100);
-      ssd1305_adafruit_display->clearDisplay();
-      delay(100);
-      ssd1305_adafruit_display->setTextColor(WHITE);
-      delay(100);
-    } else if (Config::screen == "IDEASPARK_SSD1306" &&
-               ssd1306_ideaspark_display != nullptr) {
-      ssd1306_ideaspark_display->clearBuffer();
-      delay(100);
-    } else if (Config::screen == "SH1106" &&
-               sh1106_adafruit_display != nullptr) {
-      sh1106_adafruit_display->clearBuffer();
-      delay(100);
-    } else if (Config::screen == "M5STICKCP" ||
-               Config::screen == "M5STICKCP2" ||
-               Config::screen ==
-                   "M5CARDPUTER") { // New condition for M5StickC Plus
-      tft.setRotation(1);           // Set display rotation if needed
-      tft.begin();                  // Initialize TFT_eSPI library
-      delay(100);
-      tft.setRotation(1); // Set display rotation if needed
-      delay(100);
-      tft.fillScreen(TFT_BLACK); // Fill screen with black color
-      delay(100);
-      tft.setTextColor(TFT_WHITE); // Set text color to white
-      delay(100);
-      tft.setTextSize(2); // Set text size)
-      delay(100);
+  static void draw(const String &face, const String &text, bool faceChanged,
+                   bool textChanged) {
+    TFT_eSPI *tft = TFTBackend::tft;
+    if (faceChanged) {
+      tft->fillRect(0, 0, tft->width(), Screen::split,
+                    TFT_BLACK); // Clear face area
+      tft->setCursor(0, Screen::faceY);
+      tft->setTextSize(Screen::faceSize);
+      tft->setTextColor(Screen::faceColor);
+      tft->println(face);
+    }
+    if (textChanged) {
+      tft->fillRect(0, Screen::split, tft->width(),
+                    tft->height() - Screen::split,
+                    TFT_BLACK); // Clear text area
+      tft->setCursor(0, Screen::split);
+      tft->setTextSize(Screen::textSize);
+      tft->setTextColor(Screen::textColor);
+      tft->println(text);
     }
   }
-}
+
+private:
+  static TFT_eSPI *tft;
+};
+
+template <typename Screen> TFT_eSPI *TFTBackend<Screen>::tft = nullptr;
+#endif
 
 /** developer note:
  *
@@ -174,253 +265,452 @@ void Display::startScreen() {
  *
  */
 
+// no screen
+template <config_screen_t screen> struct DisplayScreen {
+  typedef NoBackend backend_t;
+};
+
+#ifdef DISPLAY_SSD1306
+template <> struct DisplayScreen<SCREEN_SSD1306> {
+  typedef Adafruit_SSD1306 panel_t;
+  typedef AdafruitBackend<DisplayScreen> backend_t;
+  static const int faceX = 0;
+  static const int split = 20;
+
+  static panel_t *create() {
+    panel_t *screen = new Adafruit_SSD1306(
+        SSD1306_SCREEN_WIDTH, SSD1306_SCREEN_HEIGHT, &Wire, SSD1306_OLED_RESET);
+    delay(100);
+    screen->begin(SSD1306_SWITCHCAPVCC, 0x3C); // for the 128x64 displays
+    delay(100);
+    return screen;
+  }
+};
+
+template <> struct DisplayScreen<SCREEN_WEMOS_OLED_SHIELD> {
+  typedef Adafruit_SSD1306 panel_t;
+  typedef AdafruitBackend<DisplayScreen> backend_t;
+  static const int faceX = 0;
+  static const int split = 20;
+
+  static panel_t *create() {
+    panel_t *screen = new Adafruit_SSD1306(WEMOS_OLED_SHIELD_OLED_RESET);
+    delay(100);
+    screen->begin(SSD1306_SWITCHCAPVCC,
+                  0x3C); // initialize with the I2C addr 0x3C (for the 64x48)
+    delay(100);
+    return screen;
+  }
+};
+
+#endif
+
+#ifdef DISPLAY_SSD1305
+template <> struct DisplayScreen<SCREEN_SSD1305> {
+  typedef Adafruit_SSD1305 panel_t;
+  typedef AdafruitBackend<DisplayScreen> backend_t;
+  static const int faceX = 32;
+  static const int split = 15;
+
+  static panel_t *create() {
+    panel_t *screen = new Adafruit_SSD1305(
+        SSD1305_SCREEN_WIDTH, SSD1305_SCREEN_HEIGHT, &SPI, SSD1305_OLED_DC,
+        SSD1305_OLED_RESET, SSD1305_OLED_CS, 7000000UL);
+    screen->begin(SSD1305_I2C_ADDRESS, 0x3c);
+    delay(100);
+    return screen;
+  }
+};
+
+#endif
+
+#ifdef DISPLAY_U8G2
+template <> struct DisplayScreen<SCREEN_IDEASPARK_SSD1306> {
+  typedef U8G2_SSD1306_128X64_NONAME_F_SW_I2C panel_t;
+  typedef U8G2Backend<DisplayScreen> backend_t;
+  static const int split = 22;
+
+  static panel_t *create() {
+    panel_t *screen = new U8G2_SSD1306_128X64_NONAME_F_SW_I2C(
+        U8G2_R0, IDEASPARK_SSD1306_SCL, IDEASPARK_SSD1306_SDA, U8X8_PIN_NONE);
+    delay(100);
+    screen->begin();
+    delay(100);
+    return screen;
+  }
+};
+
+template <> struct DisplayScreen<SCREEN_SH1106> {
+  typedef U8G2_SH1106_128X64_NONAME_F_SW_I2C panel_t;
+  typedef U8G2Backend<DisplayScreen> backend_t;
+  static const int split = 22;
+
+  static panel_t *create() {
+    panel_t *screen = new U8G2_SH1106_128X64_NONAME_F_SW_I2C(
+        U8G2_R0, SH1106_SCL, SH1106_SDA, U8X8_PIN_NONE);
+    delay(100);
+    screen->begin();
+    delay(100);
+    return screen;
+  }
+};
+
+#endif
+
+#ifdef DISPLAY_TFT
+// all the M5 boards look the same
+struct M5Screen {
+  typedef TFTBackend<M5Screen> backend_t;
+  static const int split = 50;
+  static const int faceY = 0;
+  static const int faceSize = 6;
+  static const int textSize = 2;
+  static const uint16_t faceColor = TFT_WHITE;
+  static const uint16_t textColor = TFT_WHITE;
+};
+
+template <> struct DisplayScreen<SCREEN_M5STICKCP> : M5Screen {};
+template <> struct DisplayScreen<SCREEN_M5STICKCP2> : M5Screen {};
+template <> struct DisplayScreen<SCREEN_M5CARDPUTER> : M5Screen {};
+
+template <> struct DisplayScreen<SCREEN_CYD> {
+  typedef TFTBackend<DisplayScreen> backend_t;
+  static const int split = 40;
+  static const int faceY = 5;
+  static const int faceSize = 4;
+  static const int textSize = 1;
+  static const uint16_t faceColor = TFT_VIOLET;
+  static const uint16_t textColor = TFT_GREEN;
+};
+
+template <> struct DisplayScreen<SCREEN_T_DISPLAY_S3> {
+  typedef TFTBackend<DisplayScreen> backend_t;
+  static const int split = 50;
+  static const int faceY = 5;
+  static const int faceSize = 6;
+  static const int textSize = 2;
+  static const uint16_t faceColor = TFT_VIOLET;
+  static const uint16_t textColor = TFT_GREEN;
+};
+#endif
+
+// the backend for the screen we're built for
+typedef DisplayScreen<Config::screen>::backend_t Backend;
+
+mood_t Display::storedMood = mood_t::NEUTRAL;
+String Display::storedText = "";
+bool Display::drawn = false;
+
+volatile uint32_t Display::drawCount = 0;
+volatile uint32_t Display::drawTime = 0;
+
+const unsigned long Display::frameInterval;
+mood_t Display::moodSlot = mood_t::NEUTRAL;
+bool Display::moodPending = false;
+display_slot_t Display::textSlot;
+portMUX_TYPE Display::lock = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t Display::handle = nullptr;
+volatile uint32_t Display::skipped = 0;
+
+#ifdef DISPLAY_U8G2
+uint8_t Display::glyphWidths['~' - ' ' + 1];
+const uint8_t *Display::glyphFont = nullptr;
+display_layout_t Display::layouts[DISPLAY_LAYOUT_CACHE];
+uint8_t Display::nextLayout = 0;
+#endif
+
+/**
+ * Function to initialize the screen ONLY.
+ */
+void Display::startScreen() {
+  if (Config::display) {
+    Backend::start();
+  }
+}
+
 /**
  * Updates the face ONLY
- * @param face Face to use
+ * @param mood Mood whose face to show
  */
-void Display::updateDisplay(String face) { Display::updateDisplay(face, ""); }
+void Display::updateDisplay(mood_t mood) { Display::updateDisplay(mood, ""); }
 
 /**
- * Updates the display with both face and text
- * @param face Face to use
+ * Starts the display task on the core the radio isn't using
+ */
+void Display::begin() {
+  if (!Config::display || Config::screen == SCREEN_NONE ||
+      Display::handle != nullptr) {
+    return;
+  }
+
+#if CONFIG_FREERTOS_UNICORE
+  BaseType_t core = 0;
+#else
+  BaseType_t core = 1 - xPortGetCoreID();
+#endif
+
+  xTaskCreatePinnedToCore(Display::task, "display", 8192, nullptr, 1,
+                          &Display::handle, core);
+}
+
+/**
+ * Updates the display with both face and text, drawn by the display task if
+ * it's running
+ * @param mood Mood whose face to show
  * @param text Additional text under the face
  */
-void Display::updateDisplay(String face, String text) {
-  if (Config::display) {
-    if ((Config::screen == "SSD1306" ||
-         Config::screen == "WEMOS_OLED_SHIELD") &&
-        ssd1306_adafruit_display != nullptr) {
-      ssd1306_adafruit_display->setCursor(0, 0);
-      delay(5);
-      ssd1306_adafruit_display->setTextSize(2);
-      delay(5);
-      ssd1306_adafruit_display->clearDisplay();
-      delay(5);
-      ssd1306_adafruit_display->println(face);
-      delay(5);
-      ssd1306_adafruit_display->setCursor(0, 20);
-      delay(5);
-      ssd1306_adafruit_display->setTextSize(1);
-      delay(5);
-      ssd1306_adafruit_display->println(text);
-      delay(5);
-      ssd1306_adafruit_display->display();
-      delay(5);
-    } else if (Config::screen == "SSD1305" &&
-               ssd1305_adafruit_display != nullptr) {
-      ssd1305_adafruit_display->setCursor(32, 0);
-      delay(5);
-      ssd1305_adafruit_display->setTextSize(2);
-      delay(5);
-      ssd1305_adafruit_display->clearDisplay();
-      delay(5);
-      ssd1305_adafruit_display->println(face);
-      delay(5);
-      ssd1305_adafruit_display->setCursor(0, 15);
-      delay(5);
-      ssd1305_adafruit_display->setTextSize(1);
-      delay(5);
-      ssd1305_adafruit_display->println(text);
-      delay(5);
-      ssd1305_adafruit_display->display();
-      delay(5);
-    } else if (Config::screen == "IDEASPARK_SSD1306" &&
-               ssd1306_ideaspark_display != nullptr) {
-      ssd1306_ideaspark_display->clearBuffer();
-      delay(5);
-      ssd1306_ideaspark_display->setDrawColor(2);
-      delay(5);
-      ssd1306_ideaspark_display->setFont(u8g2_font_10x20_tr);
-      delay(5);
-      ssd1306_ideaspark_display->drawStr(0, 15, face.c_str());
-      delay(5);
-      ssd1306_ideaspark_display->setDrawColor(1);
-      delay(5);
-      ssd1306_ideaspark_display->setFont(u8g2_font_6x10_tr);
-      delay(5);
-      Display::printU8G2Data(0, 32, text.c_str());
-      delay(5);
-      ssd1306_ideaspark_display->sendBuffer();
-      delay(5);
-    } else if (Config::screen == "SH1106") {
-      sh1106_adafruit_display->clearBuffer();
-      delay(5);
-      sh1106_adafruit_display->setDrawColor(2);
-      delay(5);
-      sh1106_adafruit_display->setFont(u8g2_font_10x20_tr);
-      delay(5);
-      sh1106_adafruit_display->drawStr(0, 15, face.c_str());
-      delay(5);
-      sh1106_adafruit_display->setDrawColor(1);
-      delay(5);
-      sh1106_adafruit_display->setFont(u8g2_font_6x10_tr);
-      delay(5);
-      Display::printU8G2Data(0, 32, text.c_str());
-      delay(5);
-      sh1106_adafruit_display->sendBuffer();
-      delay(5);
-
-    } else if (Config::screen == "M5STICKCP" ||
-               Config::screen == "M5STICKCP2" ||
-               Config::screen ==
-                   "M5CARDPUTER") { // New condition for M5 devices
-      bool faceChanged = (face != Display::storedFace);
-      bool textChanged = (text != Display::storedText);
-
-      if (faceChanged) {
-        tft.fillRect(0, 0, tft.width(), 50, TFT_BLACK); // Clear face area
-        delay(5);
-        tft.setTextColor(TFT_WHITE); // Set text color to white
-        delay(5);
-        tft.setCursor(0, 0); // Set cursor to start position
-        delay(5);
-        tft.setTextSize(6); // Set text size for face
-        delay(5);
-        tft.println(face); // Print face
-        delay(5);
-        Display::storedFace = face; // Store the new face
-      }
+void Display::updateDisplay(mood_t mood, String text) {
+  if (Display::handle == nullptr ||
+      xTaskGetCurrentTaskHandle() == Display::handle) {
+    Display::draw(mood, text);
+    return;
+  }
 
-      if (textChanged) {
-        tft.fillRect(0, 50, tft.width(), tft.height() - 50,
-                     TFT_BLACK); // Clear text area
-        delay(5);
-        tft.setTextColor(TFT_WHITE); // Set text color to white
-        delay(5);
-        tft.setCursor(0, 50); // Set cursor to start position
-        delay(5);
-        tft.setTextSize(2); // Set text size for text
-        delay(5);
-        tft.println(text); // Print text
-        delay(5);
-        Display::storedText = text; // Store the new text
-      }
-    } else if ((Config::screen == "CYD" || Config::screen == "T_DISPLAY_S3") &&
-               tft_display != nullptr) {
-      bool faceChanged = (face != Display::storedFace);
-      bool textChanged = (text != Display::storedText);
-
-      if (faceChanged) {
-        int faceHeight = (Config::screen == "CYD") ? 40 : 50;
-        tft.fillRect(0, 0, tft.width(), faceHeight,
-                     TFT_BLACK); // Clear face area
-        tft.setCursor(0, 5);
-        tft.setTextSize((Config::screen == "CYD") ? 4 : 6);
-        tft.setTextColor(TFT_VIOLET);
-        tft.println(face);
-        Display::storedFace = face;
-      }
+  portENTER_CRITICAL(&Display::lock);
+  bool faceSkipped = Display::moodPending && Display::moodSlot != mood;
+  Display::moodSlot = mood;
+  Display::moodPending = true;
+  bool textSkipped = Display::post(&Display::textSlot, text);
+  portEXIT_CRITICAL(&Display::lock);
 
-      if (textChanged) {
-        int textY = (Config::screen == "CYD") ? 40 : 50;
-        tft.fillRect(0, textY, tft.width(), tft.height() - textY,
-                     TFT_BLACK); // Clear text area
-        tft.setCursor(0, textY);
-        tft.setTextSize((Config::screen == "CYD") ? 1 : 2);
-        tft.setTextColor(TFT_GREEN);
-        tft.println(text);
-        Display::storedText = text;
-      }
+  if (faceSkipped || textSkipped) {
+    Display::skipped++;
+  }
+  xTaskNotifyGive(Display::handle);
+}
+
+/**
+ * Puts a value in a slot, returns true if that replaced one that was never
+ * drawn. call with the lock held
+ * @param slot Slot to fill
+ * @param value What to put in it
+ */
+bool Display::post(display_slot_t *slot, const String &value) {
+  bool replaced = slot->pending && strcmp(slot->value, value.c_str()) != 0;
+  strncpy(slot->value, value.c_str(), sizeof(slot->value) - 1);
+  slot->value[sizeof(slot->value) - 1] = '\0';
+  slot->pending = true;
+  return replaced;
+}
+
+/**
+ * The display task, draws the latest face and text when they change
+ */
+void Display::task(void *) {
+  mood_t mood;
+  char text[sizeof(Display::textSlot.value)];
+  unsigned long lastFrame = millis() - Display::frameInterval;
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    // anything that comes in while we wait here replaces what we'd draw
+    long wait = (long)(lastFrame + Display::frameInterval - millis());
+    if (wait > 0) {
+      vTaskDelay(pdMS_TO_TICKS(wait));
     }
+
+    portENTER_CRITICAL(&Display::lock);
+    mood = Display::moodSlot;
+    memcpy(text, Display::textSlot.value, sizeof(text));
+    Display::moodPending = false;
+    Display::textSlot.pending = false;
+    portEXIT_CRITICAL(&Display::lock);
+
+    lastFrame = millis();
+    Display::draw(mood, text);
+  }
+}
+
+/**
+ * Draws the face and text on the display right away, only what changed
+ * @param mood Mood whose face to show
+ * @param text Additional text under the face
+ */
+void Display::draw(mood_t mood, String text) {
+  if (Config::display) {
+    // moods are compared by id, only the text needs a string compare
+    bool faceChanged = !Display::drawn || mood != Display::storedMood;
+    bool textChanged = !Display::drawn || text != Display::storedText;
+    if (!faceChanged && !textChanged) {
+      return;
+    }
+
+    unsigned long start = micros();
+    Backend::draw(Mood::face(mood), text, faceChanged, textChanged);
+    Display::drawTime += micros() - start;
+    Display::drawCount++;
+
+    Display::storedMood = mood;
+    Display::storedText = text;
+    Display::drawn = true;
+  }
+}
+
+/**
+ * Prints how long drawing takes on this screen and how many updates were
+ * skipped, then starts counting again
+ */
+void Display::printTiming() {
+  uint32_t count = Display::drawCount;
+  uint32_t skipped = Display::skipped;
+  if (count == 0 && skipped == 0) {
+    return;
   }
+
+  Console.print("('-') Screen: ");
+  Console.print(count);
+  Console.print(" updates, ");
+  Console.print(count > 0 ? Display::drawTime / count : 0);
+  Console.print(" us each, ");
+  Console.print(skipped);
+  Console.println(" skipped");
+  Display::drawCount = 0;
+  Display::drawTime = 0;
+  Display::skipped = 0;
 }
 
+#ifdef DISPLAY_U8G2
 // If using the U8G2 library, it does not handle wrapping if text is too long to
 // fit on the screen So will print text for screens using that library via this
 // method to handle line-breaking
 
+/** developer note:
+ *
+ * this used to measure the whole line with getStrWidth() every time it added
+ * a character, which gets slow with the longer status messages. now we look
+ * up every glyph's width once per font (see measure()) and add them up as we
+ * go, so breaking a string into lines is a single pass. the last few
+ * layouts are remembered too, since the same text gets drawn over and over.
+ * they're found by hash, but the text is kept with them and compared too,
+ * so two strings that happen to hash the same don't get each other's lines.
+ *
+ * a line ends at a newline, when it has as many characters as fit on the
+ * screen, or once it's within a character of the right edge. a string that
+ * fits within a character of the edge is drawn as is on the baseline, and
+ * everything else a pixel lower, same as it always was.
+ *
+ */
+
 /**
  * Handles U8G2 screen formatting.
  * This will only be used if the UG82 related screens are used and applied
  * within the config
+ * @param screen Screen to print on
+ * @param font Font to print with
  * @param x X value to print data
  * @param y Y value to print data
  * @param data Text to print
  */
-void Display::printU8G2Data(int x, int y, const char *data) {
-  if (Config::screen == "IDEASPARK_SSD1306") {
-    auto *screen = static_cast<U8G2_SSD1306_128X64_NONAME_F_SW_I2C *>(
-        ssd1306_ideaspark_display);
-
-    int numCharPerLine = screen->getWidth() / screen->getMaxCharWidth();
-    if (strlen(data) <= numCharPerLine &&
-        screen->getStrWidth(data) <=
-            screen->getWidth() - screen->getMaxCharWidth()) {
-      screen->drawStr(x, y, data);
-    } else {
-      int lineNum = 0;
-      char buf[numCharPerLine + 1];
-      memset(buf, 0, sizeof(buf));
-      for (int i = 0; i < strlen(data); ++i) {
-        if (data[i] != '\n') {
-          buf[strlen(buf)] = data[i];
-        }
-        if (data[i] == '\n' || strlen(buf) == numCharPerLine ||
-            i == strlen(data) - 1 ||
-            screen->getStrWidth(buf) >=
-                screen->getWidth() - screen->getMaxCharWidth()) {
-          buf[strlen(buf)] = '\0';
-          screen->drawStr(x, y + (screen->getMaxCharHeight() * lineNum++) + 1,
-                          buf);
-          memset(buf, 0, sizeof(buf));
-        }
-      }
+void Display::printU8G2Data(U8G2 *screen, const uint8_t *font, int x, int y,
+                            const char *data) {
+  screen->setFont(font);
+  const display_layout_t *layout = Display::layout(screen, font, data);
+  if (layout->fits) {
+    screen->drawStr(x, y, data);
+    return;
+  }
+
+  char buf[256];
+  for (uint8_t line = 0; line < layout->count; line++) {
+    memcpy(buf, data + layout->start[line], layout->size[line]);
+    buf[layout->size[line]] = '\0';
+    screen->drawStr(x, y + (screen->getMaxCharHeight() * line) + 1, buf);
+  }
+}
+
+/**
+ * Breaks a string into lines for a font, or finds how we did it last time
+ * @param screen Screen the string is for
+ * @param font Font the string is in
+ * @param data String to break up
+ */
+const display_layout_t *Display::layout(U8G2 *screen, const uint8_t *font,
+                                        const char *data) {
+  // FNV-1a, so most strings that aren't cached are turned away quickly
+  uint32_t hash = 2166136261u;
+  size_t length = 0;
+  for (const char *c = data; *c != '\0'; c++, length++) {
+    hash = (hash ^ (uint8_t)*c) * 16777619u;
+  }
+
+  // anything too long to keep a copy of is laid out every time
+  bool cacheable = length < sizeof(Display::layouts[0].text);
+  for (uint8_t i = 0; cacheable && i < DISPLAY_LAYOUT_CACHE; i++) {
+    display_layout_t *cached = &Display::layouts[i];
+    if (cached->font == font && cached->hash == hash &&
+        cached->length == length && memcmp(cached->text, data, length) == 0) {
+      return cached;
     }
-  } else if (Config::screen == "SH1106") {
-    auto *screen = static_cast<U8G2_SH1106_128X64_NONAME_F_SW_I2C *>(
-        sh1106_adafruit_display);
-
-    int numCharPerLine = screen->getWidth() / screen->getMaxCharWidth();
-    if (strlen(data) <= numCharPerLine &&
-        screen->getStrWidth(data) <=
-            screen->getWidth() - screen->getMaxCharWidth()) {
-      screen->drawStr(x, y, data);
-    } else {
-      int lineNum = 0;
-      char buf[numCharPerLine + 1];
-      memset(buf, 0, sizeof(buf));
-      for (int i = 0; i < strlen(data); ++i) {
-        if (data[i] != '\n') {
-          buf[strlen(buf)] = data[i];
-        }
-        if (data[i] == '\n' || strlen(buf) == numCharPerLine ||
-            i == strlen(data) - 1 ||
-            screen->getStrWidth(buf) >=
-                screen->getWidth() - screen->getMaxCharWidth()) {
-          buf[strlen(buf)] = '\0';
-          screen->drawStr(x, y + (screen->getMaxCharHeight() * lineNum++) + 1,
-                          buf);
-          memset(buf, 0, sizeof(buf));
-        }
-      }
+  }
+
+  if (Display::glyphFont != font) {
+    Display::measure(screen, font);
+  }
+
+  display_layout_t *layout = &Display::layouts[Display::nextLayout];
+  Display::nextLayout = (Display::nextLayout + 1) % DISPLAY_LAYOUT_CACHE;
+  layout->hash = hash;
+  layout->length = length;
+  layout->font = font;
+  if (cacheable) {
+    memcpy(layout->text, data, length);
+  }
+  layout->count = 0;
+
+  int maxChar = screen->getMaxCharWidth();
+  int edge = screen->getWidth() - maxChar;
+  size_t perLine = screen->getWidth() / maxChar;
+  size_t start = 0;
+  size_t size = 0;
+  int width = 0;
+  int total = 0;
+
+  for (size_t i = 0; i < length; i++) {
+    uint8_t c = data[i];
+    if (c != '\n') {
+      int glyph =
+          (c >= ' ' && c <= '~') ? Display::glyphWidths[c - ' '] : maxChar;
+      size++;
+      width += glyph;
+      total += glyph;
     }
-  } else {
-    auto *screen = static_cast<U8G2_SSD1306_128X64_NONAME_F_SW_I2C *>(
-        ssd1306_ideaspark_display);
-
-    int numCharPerLine = screen->getWidth() / screen->getMaxCharWidth();
-    if (strlen(data) <= numCharPerLine &&
-        screen->getStrWidth(data) <=
-            screen->getWidth() - screen->getMaxCharWidth()) {
-      screen->drawStr(x, y, data);
-    } else {
-      int lineNum = 0;
-      char buf[numCharPerLine + 1];
-      memset(buf, 0, sizeof(buf));
-      for (int i = 0; i < strlen(data); ++i) {
-        if (data[i] != '\n') {
-          buf[strlen(buf)] = data[i];
-        }
-        if (data[i] == '\n' || strlen(buf) == numCharPerLine ||
-            i == strlen(data) - 1 ||
-            screen->getStrWidth(buf) >=
-                screen->getWidth() - screen->getMaxCharWidth()) {
-          buf[strlen(buf)] = '\0';
-          screen->drawStr(x, y + (screen->getMaxCharHeight() * lineNum++) + 1,
-                          buf);
-          memset(buf, 0, sizeof(buf));
-        }
-      }
+
+    if (layout->count < DISPLAY_MAX_LINES &&
+        (c == '\n' || size == perLine || i == length - 1 || width >= edge)) {
+      layout->start[layout->count] = start;
+      layout->size[layout->count] = size;
+      layout->count++;
+      start = i + 1;
+      size = 0;
+      width = 0;
     }
   }
+
+  // short enough to go on the baseline as is, newlines and all
+  layout->fits = length <= perLine && total <= edge;
+
+  // an empty string is still one (empty) line
+  if (layout->count == 0) {
+    layout->start[0] = 0;
+    layout->size[0] = 0;
+    layout->count = 1;
+  }
+
+  return layout;
+}
+
+/**
+ * Looks up how far every printable ascii glyph of a font advances
+ * @param screen Screen with the font set
+ * @param font Font to measure
+ */
+void Display::measure(U8G2 *screen, const uint8_t *font) {
+  for (uint8_t c = ' '; c <= '~'; c++) {
+    int8_t width = u8g2_GetGlyphWidth(screen->getU8g2(), c);
+    Display::glyphWidths[c - ' '] =
+        width > 0 ? width : screen->getMaxCharWidth();
+  }
+  Display::glyphFont = font;
 }
+#endif
@@ -25,14 +25,56 @@
 
 #include "config.h"
 #include "mood.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <string>
+
+#ifndef CONFIG_SCREEN
+#error "CONFIG_SCREEN has to be set in config.h before display.h is included"
+#endif
+
+// the drivers CONFIG_SCREEN needs, the host tests that try every screen
+// define DISPLAY_ALL_SCREENS to get all of them
+#if defined(DISPLAY_ALL_SCREENS) || CONFIG_SCREEN == SCREEN_SSD1306 ||        \
+    CONFIG_SCREEN == SCREEN_WEMOS_OLED_SHIELD
+#define DISPLAY_SSD1306
+#endif
+
+#if defined(DISPLAY_ALL_SCREENS) || CONFIG_SCREEN == SCREEN_SSD1305
+#define DISPLAY_SSD1305
+#endif
+
+#if defined(DISPLAY_ALL_SCREENS) ||                                            \
+    CONFIG_SCREEN == SCREEN_IDEASPARK_SSD1306 || CONFIG_SCREEN == SCREEN_SH1106
+#define DISPLAY_U8G2
+#endif
+
+#if defined(DISPLAY_ALL_SCREENS) || CONFIG_SCREEN == SCREEN_CYD ||            \
+    CONFIG_SCREEN == SCREEN_T_DISPLAY_S3 ||                                    \
+    CONFIG_SCREEN == SCREEN_M5STICKCP || CONFIG_SCREEN == SCREEN_M5STICKCP2 || \
+    CONFIG_SCREEN == SCREEN_M5CARDPUTER
+#define DISPLAY_TFT
+#endif
+
+#if defined(DISPLAY_SSD1306) || defined(DISPLAY_SSD1305)
 #include <Adafruit_GFX.h>
+#endif
+#ifdef DISPLAY_SSD1305
 #include <Adafruit_SSD1305.h>
-#include <Adafruit_SSD1306.h>
 #include <SPI.h>
+#endif
+#ifdef DISPLAY_SSD1306
+#include <Adafruit_SSD1306.h>
+#include <Wire.h>
+#endif
+#ifdef DISPLAY_TFT
 #include <TFT_eSPI.h> // Defines the TFT_eSPI library for CYD
+#endif
+#ifdef DISPLAY_U8G2
 #include <U8g2lib.h>
-#include <Wire.h>
-#include <string>
+#else
+class U8G2;
+#endif
 
 #define SSD1306_SCREEN_WIDTH 128
 #define SSD1306_SCREEN_HEIGHT 64
@@ -73,24 +115,80 @@
 #define T_DISPLAY_S3_WIDTH 320
 #define T_DISPLAY_S3_HEIGHT 170
 
+// the biggest monochrome frame buffer we keep a copy of, 128x64 at 1 bit
+#define DISPLAY_SHADOW_SIZE 1024
+
+// most lines printU8G2Data() lays out, the screens only fit about six
+#define DISPLAY_MAX_LINES 8
+
+// how many layouts printU8G2Data() remembers
+#define DISPLAY_LAYOUT_CACHE 4
+
+// longest string printU8G2Data() remembers the layout of, same as the text
+// the display task draws
+#define DISPLAY_LAYOUT_TEXT 128
+
+// where printU8G2Data() breaks a string into lines
+typedef struct {
+  uint32_t hash;
+  size_t length;
+  char text[DISPLAY_LAYOUT_TEXT];
+  const uint8_t *font;
+  bool fits;
+  uint8_t count;
+  uint16_t start[DISPLAY_MAX_LINES];
+  uint8_t size[DISPLAY_MAX_LINES];
+} display_layout_t;
+
+// one region of the screen, only the latest value is kept until it's drawn
+typedef struct {
+  char value[128];
+  bool pending;
+} display_slot_t;
+
 class Display {
 public:
   static void startScreen();
-  static void updateDisplay(String face);
-  static void updateDisplay(String face, String text);
-  static void printU8G2Data(int x, int y, const char *data);
-  static String storedFace;
-  static String previousFace;
+  static void begin();
+  static void updateDisplay(mood_t mood);
+  static void updateDisplay(mood_t mood, String text);
+  static void draw(mood_t mood, String text);
+  static void printU8G2Data(U8G2 *screen, const uint8_t *font, int x, int y,
+                            const char *data);
+  static void printTiming();
+  static mood_t storedMood;
   static String storedText;
-  static String previousText;
-  ~Display();
+
+  // the most we redraw the screen, in milliseconds between frames
+  static const unsigned long frameInterval = 50;
 
 private:
-  static Adafruit_SSD1306 *ssd1306_adafruit_display;
-  static Adafruit_SSD1305 *ssd1305_adafruit_display;
-  static U8G2_SSD1306_128X64_NONAME_F_SW_I2C *ssd1306_ideaspark_display;
-  static U8G2_SH1106_128X64_NONAME_F_SW_I2C *sh1106_adafruit_display;
-  static TFT_eSPI *tft_display;
+  static const display_layout_t *layout(U8G2 *screen, const uint8_t *font,
+                                        const char *data);
+  static void measure(U8G2 *screen, const uint8_t *font);
+  static void task(void *parameter);
+  static bool post(display_slot_t *slot, const String &value);
+
+  // what the display task should draw next
+  static mood_t moodSlot;
+  static bool moodPending;
+  static display_slot_t textSlot;
+  static portMUX_TYPE lock;
+  static TaskHandle_t handle;
+  static volatile uint32_t skipped;
+
+  // advance of every printable ascii glyph in glyphFont, see measure()
+  static uint8_t glyphWidths[];
+  static const uint8_t *glyphFont;
+  static display_layout_t layouts[];
+  static uint8_t nextLayout;
+
+  // how many times we drew, and how long it took in total in microseconds
+  static volatile uint32_t drawCount;
+  static volatile uint32_t drawTime;
+
+  // if anything has been drawn yet, storedMood means nothing until then
+  static bool drawn;
 };
 
 #endif // DISPLAY_H
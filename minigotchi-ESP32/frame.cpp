@@ -21,6 +21,7 @@
  */
 
 #include "frame.h"
+#include "beacon.h"
 
 /** developer note:
  *
@@ -37,11 +38,8 @@
 
 // initializing
 size_t Frame::payloadSize = 255; // by default
-const size_t Frame::chunkSize = 0xFF;
-
-// beacon stuff
-size_t Frame::essidLength = 0;
-uint8_t Frame::headerLength = 0;
+constexpr size_t Frame::chunkSize;
+constexpr size_t Frame::maxChunks;
 
 // payload ID's according to pwngrid
 const uint8_t Frame::IDWhisperPayload = 0xDE;
@@ -55,49 +53,22 @@ const uint8_t Frame::SignatureAddr[] = {0xde, 0xad, 0xbe, 0xef, 0xde, 0xad};
 const uint8_t Frame::BroadcastAddr[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
 const uint16_t Frame::wpaFlags = 0x0411;
 
-// Don't even dare restyle!
-const uint8_t Frame::header[]{
-    /*  0 - 1  */ 0x80,
-    0x00, // frame control, beacon frame
-    /*  2 - 3  */ 0x00,
-    0x00, // duration
-    /*  4 - 9  */ 0xff,
-    0xff,
-    0xff,
-    0xff,
-    0xff,
-    0xff, // broadcast address
-    /* 10 - 15 */ 0xde,
-    0xad,
-    0xbe,
-    0xef,
-    0xde,
-    0xad, // source address
-    /* 16 - 21 */ 0xde,
-    0xad,
-    0xbe,
-    0xef,
-    0xde,
-    0xad, // bssid
-    /* 22 - 23 */ 0x00,
-    0x00, // fragment and sequence number
-    /* 24 - 32 */ 0x00,
-    0x00,
-    0x00,
-    0x00,
-    0x00,
-    0x00,
-    0x00,
-    0x00, // timestamp
-    /* 33 - 34 */ 0x64,
-    0x00, // interval
-    /* 35 - 36 */ 0x11,
-    0x04, // capability info
-};
+// beacon header, see frame.h
+constexpr uint8_t Frame::header[];
 
 // get header length
 const int Frame::pwngridHeaderLength = sizeof(Frame::header);
 
+// where advertise() is at
+frame_advertise_state_t Frame::state = ADVERTISE_START;
+int Frame::packets = 0;
+int Frame::sent = 0;
+unsigned long Frame::startTime = 0;
+
+// the packed beacon lives here for the whole session, see Frame::pack()
+uint8_t Frame::beaconFrame[BeaconBuilder::maxFrameSize];
+BeaconBuilder Frame::builder(Frame::beaconFrame);
+
 /** developer note:
  *
  * frame structure based on how it was built here
@@ -116,87 +87,40 @@ const int Frame::pwngridHeaderLength = sizeof(Frame::header);
  *
  */
 
+/** developer note:
+ *
+ * the beacon only changes when one of the advertised fields does, so it is
+ * packed once into Frame::beaconFrame and reused for every send in an
+ * advertisment burst. see beacon.cpp for how it's built.
+ *
+ */
+
+/**
+ * Checks if the cached beacon no longer matches the advertised fields
+ */
+bool Frame::stale() { return Frame::builder.stale(); }
+
 /**
  * Replicates pwngrid's pack() function from pack.go
  * https://github.com/evilsocket/pwngrid/blob/master/wifi/pack.go
+ * Returns the cached beacon, only repacking it if it is stale
  */
-uint8_t *Frame::pack() {
-  // make a json doc
-  String jsonString = "";
-  DynamicJsonDocument doc(2048);
-
-  doc["epoch"] = Config::epoch;
-  doc["face"] = Config::face;
-  doc["identity"] = Config::identity;
-  doc["name"] = Config::name;
-
-  doc["policy"]["advertise"] = Config::advertise;
-  doc["policy"]["ap_ttl"] = Config::ap_ttl;
-  doc["policy"]["associate"] = Config::associate;
-  doc["policy"]["bored_num_epochs"] = Config::bored_num_epochs;
-
-  doc["policy"]["deauth"] = Config::deauth;
-  doc["policy"]["excited_num_epochs"] = Config::excited_num_epochs;
-  doc["policy"]["hop_recon_time"] = Config::hop_recon_time;
-  doc["policy"]["max_inactive_scale"] = Config::max_inactive_scale;
-  doc["policy"]["max_interactions"] = Config::max_interactions;
-  doc["policy"]["max_misses_for_recon"] = Config::max_misses_for_recon;
-  doc["policy"]["min_recon_time"] = Config::min_rssi;
-  doc["policy"]["min_rssi"] = Config::min_rssi;
-  doc["policy"]["recon_inactive_multiplier"] =
-      Config::recon_inactive_multiplier;
-  doc["policy"]["recon_time"] = Config::recon_time;
-  doc["policy"]["sad_num_epochs"] = Config::sad_num_epochs;
-  doc["policy"]["sta_ttl"] = Config::sta_ttl;
-
-  doc["pwnd_run"] = Config::pwnd_run;
-  doc["pwnd_tot"] = Config::pwnd_tot;
-  doc["session_id"] = Config::session_id;
-  doc["uptime"] = Config::uptime;
-  doc["version"] = Config::version;
-
-  // serialize then put into beacon frame
-  serializeJson(doc, jsonString);
-  Frame::essidLength = measureJson(doc);
-  Frame::headerLength = 2 + ((uint8_t)(essidLength / 255) * 2);
-  uint8_t *beaconFrame = new uint8_t[Frame::pwngridHeaderLength +
-                                     Frame::essidLength + Frame::headerLength];
-  memcpy(beaconFrame, Frame::header, Frame::pwngridHeaderLength);
-
-  /** developer note:
-   *
-   * if you literally want to check the json everytime you send a packet(non
-   * serialized ofc)
-   *
-   * Serial.println(jsonString);
-   */
-
-  int frameByte = pwngridHeaderLength;
-  for (int i = 0; i < essidLength; i++) {
-    if (i == 0 || i % 255 == 0) {
-      beaconFrame[frameByte++] = Frame::IDWhisperPayload;
-      uint8_t newPayloadLength = 255;
-      if (essidLength - i < Frame::chunkSize) {
-        newPayloadLength = essidLength - i;
-      }
-      beaconFrame[frameByte++] = newPayloadLength;
-    }
-    beaconFrame[frameByte++] = (uint8_t)jsonString[i];
-  }
+beacon_span_t Frame::pack() {
+  beacon_span_t beacon = Frame::builder.build();
 
   /* developer note: we can print the beacon frame like so...
 
-  Serial.println("('-') Full Beacon Frame:");
-  for (size_t i = 0; i < frameSize; ++i) {
-    Serial.print(beaconFrame[i], HEX);
-    Serial.print(" ");
+  Console.println("('-') Full Beacon Frame:");
+  for (size_t i = 0; i < beacon.length; ++i) {
+    Console.print(beacon.data[i], HEX);
+    Console.print(" ");
   }
 
-  Serial.println(" ");
+  Console.println(" ");
 
   */
 
-  return beaconFrame;
+  return beacon;
 }
 
 /**
@@ -204,63 +128,76 @@ uint8_t *Frame::pack() {
  */
 bool Frame::send() {
   // convert to a pointer because esp-idf is a pain in the ass
-  WiFi.mode(WIFI_AP);
-  uint8_t *frame = Frame::pack();
-  size_t frameSize = Frame::pwngridHeaderLength + Frame::essidLength +
-                     Frame::headerLength; // actually disgusting but it works
+  Radio::mode(WIFI_MODE_AP);
+  beacon_span_t beacon = Frame::pack();
+  if (beacon.length == 0) {
+    return false;
+  }
 
   // send full frame
   // we don't use raw80211 since it sends a header (which we don't need),
   // although we do use it for monitoring, etc.
-  delay(102);
   // Channel::switchChannel(1 + rand() % (13 - 1 + 1));
-  esp_err_t err = esp_wifi_80211_tx(WIFI_IF_AP, frame, frameSize, false);
-
-  delete[] frame;
-  return (err == ESP_OK);
+  return Radio::send(WIFI_IF_AP, beacon.data, beacon.length, false);
 }
 
 /**
- * Full usage of Pwnagotchi's advertisments on the Minigotchi.
+ * Full usage of Pwnagotchi's advertisments on the Minigotchi, one beacon per
+ * step
  */
-void Frame::advertise() {
-  int packets = 0;
-  unsigned long startTime = millis();
+unsigned long Frame::advertise() {
+  switch (Frame::state) {
+  case ADVERTISE_START:
+    if (!Config::advertise) {
+      // do nothing but still idle
+      return Scheduler::done;
+    }
 
-  if (Config::advertise) {
-    Serial.println("(>-<) Starting advertisment...");
-    Serial.println(" ");
-    Display::updateDisplay("(>-<)", "Starting advertisment...");
+    Console.println("(>-<) Starting advertisment...");
+    Console.println(" ");
+    Mood::enter(mood_t::INTENSE, "Starting advertisment...");
     Parasite::sendAdvertising();
-    delay(Config::shortDelay);
-    for (int i = 0; i < 150; ++i) {
-      if (Frame::send()) {
-        packets++;
-
-        // calculate packets per second
-        float pps = packets / (float)(millis() - startTime) * 1000;
 
-        // show pps
-        if (!isinf(pps)) {
-          Serial.print("(>-<) Packets per second: ");
-          Serial.print(pps);
-          Serial.print(" pkt/s (Channel: ");
-          Serial.print(Channel::getChannel());
-          Serial.println(")");
-          Display::updateDisplay(
-              "(>-<)", "Packets per second: " + (String)pps + " pkt/s" +
-                           " (Channel: " + (String)Channel::getChannel() + ")");
-        }
-      } else {
-        Serial.println("(X-X) Advertisment failed to send!");
+    Frame::packets = 0;
+    Frame::sent = 0;
+    Frame::startTime = millis();
+    Frame::state = ADVERTISE_SEND;
+    return Config::shortDelay;
+
+  case ADVERTISE_SEND:
+    if (Frame::send()) {
+      Frame::packets++;
+
+      // calculate packets per second
+      float pps = Frame::packets / (float)(millis() - Frame::startTime) * 1000;
+
+      // show pps
+      if (!isinf(pps)) {
+        Console.print("(>-<) Packets per second: ");
+        Console.print(pps);
+        Console.print(" pkt/s (Channel: ");
+        Console.print(Channel::getChannel());
+        Console.println(")");
+        Mood::enter(mood_t::INTENSE,
+                    "Packets per second: " + (String)pps + " pkt/s" +
+                        " (Channel: " + (String)Channel::getChannel() + ")");
       }
+    } else {
+      Console.println("(X-X) Advertisment failed to send!");
     }
 
-    Serial.println(" ");
-    Serial.println("(^-^) Advertisment finished!");
-    Serial.println(" ");
-    Display::updateDisplay("(^-^)", "Advertisment finished!");
-  } else {
-    // do nothing but still idle
+    // about one beacon interval between frames
+    if (++Frame::sent < 150) {
+      return 102;
+    }
+    break;
   }
+
+  Console.println(" ");
+  Console.println("(^-^) Advertisment finished!");
+  Console.println(" ");
+  Mood::enter(mood_t::HAPPY, "Advertisment finished!");
+
+  Frame::state = ADVERTISE_START;
+  return Scheduler::done;
 }
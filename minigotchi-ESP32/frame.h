@@ -24,21 +24,33 @@
 #define FRAME_H
 
 #include "config.h"
+#include "console.h"
 #include "display.h"
 #include "parasite.h"
-#include <ArduinoJson.h>
-#include <Wifi.h>
+#include "radio.h"
+#include "scheduler.h"
 #include <esp_wifi.h>
 #include <sstream>
 #include <string>
 #include <vector>
 
+class BeaconBuilder;
+
+// a packed frame and how many bytes of it to send
+typedef struct {
+  const uint8_t *data;
+  size_t length;
+} beacon_span_t;
+
+// where advertise() is at
+typedef enum { ADVERTISE_START = 0, ADVERTISE_SEND } frame_advertise_state_t;
+
 class Frame {
 public:
-  static uint8_t *pack();
+  static beacon_span_t pack();
+  static bool stale();
   static bool send();
-  static void advertise();
-  static const uint8_t header[];
+  static unsigned long advertise();
   static const uint8_t IDWhisperPayload;
   static const uint8_t IDWhisperCompression;
   static const uint8_t IDWhisperIdentity;
@@ -48,14 +60,60 @@ public:
   static const uint8_t BroadcastAddr[];
   static const uint16_t wpaFlags;
 
+  // Don't even dare restyle!
+  static constexpr uint8_t header[]{
+      /*  0 - 1  */ 0x80,
+      0x00, // frame control, beacon frame
+      /*  2 - 3  */ 0x00,
+      0x00, // duration
+      /*  4 - 9  */ 0xff,
+      0xff,
+      0xff,
+      0xff,
+      0xff,
+      0xff, // broadcast address
+      /* 10 - 15 */ 0xde,
+      0xad,
+      0xbe,
+      0xef,
+      0xde,
+      0xad, // source address
+      /* 16 - 21 */ 0xde,
+      0xad,
+      0xbe,
+      0xef,
+      0xde,
+      0xad, // bssid
+      /* 22 - 23 */ 0x00,
+      0x00, // fragment and sequence number
+      /* 24 - 32 */ 0x00,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      0x00, // timestamp
+      /* 33 - 34 */ 0x64,
+      0x00, // interval
+      /* 35 - 36 */ 0x11,
+      0x04, // capability info
+  };
+
   static const int pwngridHeaderLength;
-  static size_t essidLength;
-  static uint8_t headerLength;
 
   static size_t payloadSize;
-  static const size_t chunkSize;
+  static constexpr size_t chunkSize = 0xFF;
+  static constexpr size_t maxChunks = 4;
 
 private:
+  static uint8_t beaconFrame[];
+  static BeaconBuilder builder;
+
+  static frame_advertise_state_t state;
+  static int packets;
+  static int sent;
+  static unsigned long startTime;
 };
 
 #endif // FRAME_H
@@ -0,0 +1,180 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * framing.cpp: binary framing for the parasite serial link
+ */
+
+#include "framing.h"
+
+/** developer note:
+ *
+ * a frame is a small header (payload length, message type, status), the
+ * payload, and a CRC-16/CCITT of all of that. the whole thing is then COBS
+ * encoded, which gets rid of every zero byte, so a zero can mark where a
+ * frame ends. we put one in front as well, so any log output that got in
+ * between two frames ends up in a frame of its own and fails the crc instead
+ * of corrupting the next one.
+ *
+ * nothing in here touches arduino stuff, so it builds on a regular computer
+ * just as well, which is handy for poking at the link from the other end.
+ *
+ */
+
+const size_t Framing::maxPayload;
+const size_t Framing::maxRaw;
+const size_t Framing::maxFrame;
+
+/**
+ * Builds a frame ready to be written out, returns its length or 0 if it
+ * doesn't fit
+ * @param type Message type
+ * @param status Message status
+ * @param payload Payload, can be null if length is 0
+ * @param length Length of the payload
+ * @param out Buffer to write to
+ * @param outSize The size of the buffer
+ */
+size_t Framing::encode(uint8_t type, uint8_t status, const void *payload,
+                       size_t length, uint8_t *out, size_t outSize) {
+  if (length > Framing::maxPayload || outSize < Framing::maxFrame) {
+    return 0;
+  }
+
+  uint8_t raw[Framing::maxRaw];
+  framing_header_t header = {(uint8_t)length, type, status};
+  memcpy(raw, &header, sizeof(header));
+  if (length > 0) {
+    memcpy(raw + sizeof(header), payload, length);
+  }
+
+  size_t rawLength = sizeof(header) + length;
+  uint16_t crc = Framing::crc16(raw, rawLength);
+  raw[rawLength++] = crc & 0xFF;
+  raw[rawLength++] = crc >> 8;
+
+  out[0] = 0;
+  size_t encoded = Framing::cobsEncode(raw, rawLength, out + 1);
+  out[encoded + 1] = 0;
+  return encoded + 2;
+}
+
+/**
+ * Decodes a frame in place and checks it, the delimiters must already be
+ * stripped off
+ * @param frame Encoded frame, overwritten with the decoded one
+ * @param length Length of the encoded frame
+ * @param header Where to put the header
+ * @param payload Where to put a pointer to the payload
+ */
+bool Framing::decode(uint8_t *frame, size_t length, framing_header_t *header,
+                     const uint8_t **payload) {
+  size_t rawLength = Framing::cobsDecode(frame, length);
+  if (rawLength < sizeof(framing_header_t) + 2) {
+    return false;
+  }
+
+  memcpy(header, frame, sizeof(*header));
+  if (sizeof(*header) + header->length + 2 != rawLength) {
+    return false;
+  }
+
+  uint16_t crc = frame[rawLength - 2] | (frame[rawLength - 1] << 8);
+  if (crc != Framing::crc16(frame, rawLength - 2)) {
+    return false;
+  }
+
+  *payload = frame + sizeof(*header);
+  return true;
+}
+
+/**
+ * Calculates a CRC-16/CCITT-FALSE
+ * @param data Data to check
+ * @param length Length of the data
+ */
+uint16_t Framing::crc16(const uint8_t *data, size_t length) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+/**
+ * COBS encodes some data, returns the encoded length
+ * @param in Data to encode
+ * @param length Length of the data
+ * @param out Buffer to write to, at least length + length / 254 + 1 long
+ */
+size_t Framing::cobsEncode(const uint8_t *in, size_t length, uint8_t *out) {
+  size_t code = 0;
+  size_t pos = 1;
+  uint8_t run = 1;
+
+  for (size_t i = 0; i < length; i++) {
+    if (in[i] == 0) {
+      out[code] = run;
+      code = pos++;
+      run = 1;
+      continue;
+    }
+
+    out[pos++] = in[i];
+    if (++run == 0xFF) {
+      out[code] = run;
+      code = pos++;
+      run = 1;
+    }
+  }
+
+  out[code] = run;
+  return pos;
+}
+
+/**
+ * COBS decodes some data in place, returns the decoded length or 0 if it's
+ * broken
+ * @param data Data to decode
+ * @param length Length of the data
+ */
+size_t Framing::cobsDecode(uint8_t *data, size_t length) {
+  size_t in = 0;
+  size_t out = 0;
+
+  while (in < length) {
+    uint8_t code = data[in++];
+    if (code == 0 || in + code - 1 > length) {
+      return 0;
+    }
+
+    for (uint8_t i = 1; i < code; i++) {
+      data[out++] = data[in++];
+    }
+
+    // a zero between blocks, unless this was the last or a full block
+    if (code != 0xFF && in < length) {
+      data[out++] = 0;
+    }
+  }
+
+  return out;
+}
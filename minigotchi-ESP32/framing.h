@@ -0,0 +1,59 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * framing.h: header files for framing.cpp
+ */
+
+#ifndef FRAMING_H
+#define FRAMING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// what comes before the payload of every binary frame
+typedef struct __attribute__((packed)) {
+  uint8_t length;
+  uint8_t type;
+  uint8_t status;
+} framing_header_t;
+
+class Framing {
+public:
+  static size_t encode(uint8_t type, uint8_t status, const void *payload,
+                       size_t length, uint8_t *out, size_t outSize);
+  static bool decode(uint8_t *frame, size_t length, framing_header_t *header,
+                     const uint8_t **payload);
+  static uint16_t crc16(const uint8_t *data, size_t length);
+
+  // biggest payload a frame can carry, the length is a single byte
+  static const size_t maxPayload = 255;
+
+  // header, payload and crc, before encoding
+  static const size_t maxRaw = sizeof(framing_header_t) + maxPayload + 2;
+
+  // worst case once encoded, with a delimiter on both ends
+  static const size_t maxFrame = maxRaw + maxRaw / 254 + 1 + 2;
+
+private:
+  static size_t cobsEncode(const uint8_t *in, size_t length, uint8_t *out);
+  static size_t cobsDecode(uint8_t *data, size_t length);
+};
+
+#endif // FRAMING_H
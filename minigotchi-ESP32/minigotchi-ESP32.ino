@@ -39,20 +39,7 @@ void setup() {
 */
 
 void loop() {
-    // cycle channels at start of loop
-    minigotchi.cycle();
-    delay(250);
-
-    // the longer we are on this channel, the more likely we're gonna see a pwnagotchi on this channel
-    // get local payload from local pwnagotchi, send raw frame if one is found
-    minigotchi.detect();
-    delay(250);
-
-    // advertise our presence with the help of pwngrid compatible beacon frames (probably the most confusing part lmao)
-    minigotchi.advertise();
-    delay(250);
-
-    // deauth random access point
-    minigotchi.deauth();
-    delay(250);
+    // cycle channels, detect pwnagotchi, advertise and deauth, in that order.
+    // each of them only runs for a moment at a time, see scheduler.cpp
+    minigotchi.tick();
 }
@@ -51,9 +51,9 @@ int Minigotchi::addEpoch() {
 void Minigotchi::epoch() {
   Minigotchi::addEpoch();
   Parasite::readData();
-  Serial.print("('-') Current Epoch: ");
-  Serial.println(Minigotchi::currentEpoch);
-  Serial.println(" ");
+  Console.print("('-') Current Epoch: ");
+  Console.println(Minigotchi::currentEpoch);
+  Console.println(" ");
 }
 
 /**
@@ -62,43 +62,46 @@ void Minigotchi::epoch() {
 void Minigotchi::boot() {
   // StickC Plus 1.1 and 2 power management, to keep turned On after unplug USB
   // cable
-  if (Config::screen == "M5StickCP") {
+  if (Config::screen == SCREEN_M5STICKCP) {
     AXP192 axp192;
     axp192.begin();           // Use the instance of AXP192
     axp192.ScreenBreath(100); // Use the instance of AXP192
-  } else if (Config::screen == "M5StickCP2") {
+  } else if (Config::screen == SCREEN_M5STICKCP2) {
     pinMode(4, OUTPUT);
     digitalWrite(4, HIGH);
   }
 
   Display::startScreen();
-  Serial.println(" ");
-  Serial.println("(^-^) Hi, I'm Minigotchi, your pwnagotchi's best friend!");
-  Display::updateDisplay("(^-^)", "Hi,       I'm Minigotchi");
-  Serial.println(" ");
-  Serial.println(
+  Console.println(" ");
+  Console.println("(^-^) Hi, I'm Minigotchi, your pwnagotchi's best friend!");
+  Mood::enter(mood_t::HAPPY, "Hi,       I'm Minigotchi");
+  Console.println(" ");
+  Console.println(
       "('-') You can edit my configuration parameters in config.cpp!");
-  Serial.println(" ");
+  Console.println(" ");
   delay(250);
-  Display::updateDisplay("('-')", "Edit my config.cpp!");
+  Mood::enter(mood_t::NEUTRAL, "Edit my config.cpp!");
   delay(250);
-  Serial.println("(>-<) Starting now...");
-  Serial.println(" ");
-  Display::updateDisplay("(>-<)", "Starting  now");
+  Console.println("(>-<) Starting now...");
+  Console.println(" ");
+  Mood::enter(mood_t::INTENSE, "Starting  now");
   delay(250);
-  Serial.println("################################################");
-  Serial.println("#                BOOTUP PROCESS                #");
-  Serial.println("################################################");
-  Serial.println(" ");
-  ESP_ERROR_CHECK(esp_wifi_init(&Config::config));
-  ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
-  ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-  ESP_ERROR_CHECK(esp_wifi_start());
+  Console.println("################################################");
+  Console.println("#                BOOTUP PROCESS                #");
+  Console.println("################################################");
+  Console.println(" ");
+  Radio::begin();
   Deauth::list();
   Channel::init(Config::channel);
   Minigotchi::info();
   Parasite::sendName();
   Minigotchi::finish();
+
+  // from here on the screen and serial are handled on the other core
+  Console.begin();
+  Display::begin();
+  Parasite::begin();
+  Minigotchi::schedule();
 }
 
 /**
@@ -106,13 +109,13 @@ void Minigotchi::boot() {
  */
 void Minigotchi::info() {
   delay(250);
-  Serial.println(" ");
-  Serial.println("('-') Current Minigotchi Stats: ");
-  Display::updateDisplay("('-')", "Current Minigotchi Stats:");
+  Console.println(" ");
+  Console.println("('-') Current Minigotchi Stats: ");
+  Mood::enter(mood_t::NEUTRAL, "Current Minigotchi Stats:");
   version();
   mem();
   cpu();
-  Serial.println(" ");
+  Console.println(" ");
   delay(250);
 }
 
@@ -120,11 +123,11 @@ void Minigotchi::info() {
  * This is printed after everything is done in the bootup process
  */
 void Minigotchi::finish() {
-  Serial.println("################################################");
-  Serial.println(" ");
-  Serial.println("('-') Started successfully!");
-  Serial.println(" ");
-  Display::updateDisplay("('-')", "Started sucessfully");
+  Console.println("################################################");
+  Console.println(" ");
+  Console.println("('-') Started successfully!");
+  Console.println(" ");
+  Mood::enter(mood_t::NEUTRAL, "Started sucessfully");
   delay(250);
 }
 
@@ -132,10 +135,10 @@ void Minigotchi::finish() {
  * Shows current Minigotchi version
  */
 void Minigotchi::version() {
-  Serial.print("('-') Version: ");
-  Serial.println(Config::version.c_str());
-  Display::updateDisplay("('-')",
-                         "Version: " + (String)Config::version.c_str());
+  Console.print("('-') Version: ");
+  Console.println(Config::version.c_str());
+  Mood::enter(mood_t::NEUTRAL,
+              "Version: " + (String)Config::version.c_str());
   delay(250);
 }
 
@@ -143,11 +146,11 @@ void Minigotchi::version() {
  * Shows current Minigotchi memory usage
  */
 void Minigotchi::mem() {
-  Serial.print("('-') Heap: ");
-  Serial.print(ESP.getFreeHeap());
-  Serial.println(" bytes");
-  Display::updateDisplay("('-')",
-                         "Heap: " + (String)ESP.getFreeHeap() + " bytes");
+  Console.print("('-') Heap: ");
+  Console.print(ESP.getFreeHeap());
+  Console.println(" bytes");
+  Mood::enter(mood_t::NEUTRAL,
+              "Heap: " + (String)ESP.getFreeHeap() + " bytes");
   delay(250);
 }
 
@@ -155,11 +158,11 @@ void Minigotchi::mem() {
  * Shows current Minigotchi Frequency
  */
 void Minigotchi::cpu() {
-  Serial.print("('-') CPU Frequency: ");
-  Serial.print(ESP.getCpuFreqMHz());
-  Serial.println(" MHz");
-  Display::updateDisplay(
-      "('-')", "CPU Frequency: " + (String)ESP.getCpuFreqMHz() + " MHz");
+  Console.print("('-') CPU Frequency: ");
+  Console.print(ESP.getCpuFreqMHz());
+  Console.println(" MHz");
+  Mood::enter(mood_t::NEUTRAL,
+              "CPU Frequency: " + (String)ESP.getCpuFreqMHz() + " MHz");
   delay(250);
 }
 
@@ -185,21 +188,21 @@ void Minigotchi::cpu() {
  */
 void Minigotchi::monStart() {
   // disconnect from WiFi if we were at all
-  WiFi.disconnect();
+  Radio::disconnect();
 
   // revert to station mode
-  WiFi.mode(WIFI_STA);
-  esp_wifi_set_promiscuous(true);
+  Radio::mode(WIFI_MODE_STA);
+  Radio::promiscuous(true);
 }
 
 /**
  * Takes Minigotchi out of promiscuous mode
  */
 void Minigotchi::monStop() {
-  esp_wifi_set_promiscuous(false);
+  Radio::promiscuous(false);
 
   // revert to station mode
-  WiFi.mode(WIFI_STA);
+  Radio::mode(WIFI_MODE_STA);
 }
 
 /** developer note:
@@ -222,33 +225,52 @@ void Minigotchi::monStop() {
  */
 
 /**
- * Channel cycling
+ * Sets up what we do every epoch
  */
-void Minigotchi::cycle() {
-  Parasite::readData();
-  Channel::cycle();
+void Minigotchi::schedule() {
+  // cycle channels at start of epoch
+  Scheduler::add("cycle", Minigotchi::cycle);
+
+  // the longer we are on this channel, the more likely we're gonna see a
+  // pwnagotchi on this channel get local payload from local pwnagotchi, send
+  // raw frame if one is found
+  Scheduler::add("detect", Minigotchi::detect);
+
+  // advertise our presence with the help of pwngrid compatible beacon frames
+  // (probably the most confusing part lmao)
+  Scheduler::add("advertise", Minigotchi::advertise);
+
+  // deauth random access point
+  Scheduler::add("deauth", Minigotchi::deauth);
 }
 
 /**
- * Pwnagotchi detection
+ * Runs whatever is due, called from loop()
  */
-void Minigotchi::detect() {
+void Minigotchi::tick() {
+  // anything the pwnagotchi sent gets handled right away, not between phases
   Parasite::readData();
-  Pwnagotchi::detect();
+  Parasite::flush();
+  Capture::flush();
+  Scheduler::tick();
 }
 
+/**
+ * Channel cycling
+ */
+unsigned long Minigotchi::cycle() { return Channel::cycle(); }
+
+/**
+ * Pwnagotchi detection
+ */
+unsigned long Minigotchi::detect() { return Pwnagotchi::detect(); }
+
 /**
  * Deauthing
  */
-void Minigotchi::deauth() {
-  Parasite::readData();
-  Deauth::deauth();
-}
+unsigned long Minigotchi::deauth() { return Deauth::deauth(); }
 
 /**
  * Advertising
  */
-void Minigotchi::advertise() {
-  Parasite::readData();
-  Frame::advertise();
-}
+unsigned long Minigotchi::advertise() { return Frame::advertise(); }
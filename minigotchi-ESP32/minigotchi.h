@@ -23,15 +23,18 @@
 #ifndef MINIGOTCHI_H
 #define MINIGOTCHI_H
 
+#include "capture.h"
 #include "channel.h"
 #include "config.h"
+#include "console.h"
 #include "deauth.h"
 #include "display.h"
 #include "frame.h"
 #include "parasite.h"
 #include "pwnagotchi.h"
+#include "radio.h"
+#include "scheduler.h"
 #include <Arduino.h>
-#include <WiFi.h>
 #include <esp_wifi.h>
 
 class Minigotchi {
@@ -44,10 +47,12 @@ public:
   static void cpu();
   static void monStart();
   static void monStop();
-  static void cycle();
-  static void detect();
-  static void deauth();
-  static void advertise();
+  static void schedule();
+  static void tick();
+  static unsigned long cycle();
+  static unsigned long detect();
+  static unsigned long deauth();
+  static unsigned long advertise();
   static void epoch();
   static int addEpoch();
   static int currentEpoch;
@@ -21,109 +21,165 @@
  */
 
 #include "mood.h"
+#include "config.h"
+#include "console.h"
+#include "display.h"
 
-// set moods to be config's
-String Mood::happy = Config::happy;
-String Mood::sad = Config::sad;
-String Mood::broken = Config::broken;
-String Mood::intense = Config::intense;
-String Mood::looking1 = Config::looking1;
-String Mood::looking2 = Config::looking2;
-String Mood::neutral = Config::neutral;
-String Mood::sleeping = Config::sleeping;
+/** developer note:
+ *
+ * every mood is just a number now, and its face is a lookup in a table that
+ * stays in flash. so switching moods or getting a face never compares or
+ * copies strings, and callers say what they feel with enter() instead of
+ * passing faces around.
+ *
+ */
 
 /** developer note:
  *
- * these checking procedures will only really be used for faces,
- * since they change often and the minigotchi is intended to be fast...
+ * on top of that there's a resting mood, like the pwnagotchi has. modules
+ * don't pick it, they just post() what happened, which only bumps a counter
+ * so it's fine from the hot paths. at the end of every epoch the counters
+ * are turned into streaks of active and inactive epochs, and those are held
+ * against Config::bored_num_epochs, sad_num_epochs and excited_num_epochs.
  *
- * obviously, this is all a WIP!
+ * so we don't flip between two faces every epoch a new resting mood has to
+ * win Mood::hysteresis epochs in a row before we switch to it, only feeling
+ * broken skips the wait.
  *
  */
 
+const uint8_t Mood::count;
+const uint8_t Mood::hysteresis;
+const uint32_t Mood::brokenFailures;
+constexpr const char *Mood::faces[];
+constexpr const char *Mood::names[];
+
+mood_t Mood::currentMood = mood_t::NEUTRAL;
+
+std::atomic<uint32_t> Mood::events[MOOD_EVENTS];
+
+int Mood::activeFor = 0;
+int Mood::inactiveFor = 0;
+mood_t Mood::restingMood = mood_t::NEUTRAL;
+mood_t Mood::pendingMood = mood_t::NEUTRAL;
+uint8_t Mood::pendingFor = 0;
+
+/**
+ * Switches to a mood and shows its face
+ * @param mood Mood to switch to
+ */
+void Mood::enter(mood_t mood) { Mood::enter(mood, ""); }
+
+/**
+ * Switches to a mood and shows its face with some text under it
+ * @param mood Mood to switch to
+ * @param text Additional text under the face
+ */
+void Mood::enter(mood_t mood, const String &text) {
+  Mood::currentMood = mood;
+  Display::updateDisplay(mood, text);
+}
+
+/**
+ * Returns the current mood
+ */
+mood_t Mood::current() { return Mood::currentMood; }
+
 /**
- * Returns the current mood and writes it to a variable
- * @param face Face to get mood off of
+ * Gets the face of a mood
+ * @param mood Mood to use
  */
-String Mood::getFull(String face) { Mood::getFace(Mood::getMood(face)); }
+const char *Mood::face(mood_t mood) {
+  return Mood::faces[static_cast<uint8_t>(mood)];
+}
 
 /**
- * Returns current mood
+ * Gets the name of a mood
+ * @param mood Mood to use
  */
-String Mood::getCurrentMood() { return currentMood; }
+const char *Mood::name(mood_t mood) {
+  return Mood::names[static_cast<uint8_t>(mood)];
+}
 
 /**
- * Gets current mood off of face
- * @param face Current face
+ * Tells the mood engine something happened, safe to call from anywhere
+ * @param event What happened
  */
-String Mood::getMood(String face) {
-  if (face == Mood::happy) {
-    currentMood = "happy";
-  } else if (face == Mood::sad) {
-    currentMood = "sad";
-  } else if (face == Mood::broken) {
-    currentMood = "broken";
-  } else if (face == Mood::intense) {
-    currentMood = "intense";
-  } else if (face == Mood::looking1) {
-    currentMood = "looking1";
-  } else if (face == Mood::looking2) {
-    currentMood = "looking2";
-  } else if (face == Mood::neutral) {
-    currentMood = "neutral";
-  } else if (face == Mood::sleeping) {
-    currentMood = "sleeping";
-  } else {
-    currentMood = " ";
+void Mood::post(mood_event_t event) {
+  if (event == MOOD_EVENT_EPOCH) {
+    Mood::settle();
+    return;
   }
 
-  return currentMood;
+  Mood::events[event].fetch_add(1, std::memory_order_relaxed);
 }
 
 /**
- * Returns the current face
+ * Returns the mood we settled on over the last few epochs
  */
-String Mood::getCurrentFace() { return currentFace; }
+mood_t Mood::resting() { return Mood::restingMood; }
 
 /**
- * Gets face off of the mood
- * @param mood Mood to use
+ * Works out how we'd feel right now from the epoch streaks
+ * @param failures Failed transmissions this epoch
  */
-String Mood::getFace(String mood) {
-  if (mood == "happy") {
-    currentFace = Mood::happy;
-  } else if (mood == "sad") {
-    currentFace = Mood::sad;
-  } else if (mood == "broken") {
-    currentFace = Mood::broken;
-  } else if (mood == "looking1") {
-    currentFace = Mood::looking1;
-  } else if (mood == "looking2") {
-    currentFace = Mood::looking2;
-  } else if (mood == "neutral") {
-    currentFace = Mood::neutral;
-  } else if (mood == "sleeping") {
-    currentFace = Mood::sleeping;
-  } else {
-    currentFace = " ";
+mood_t Mood::decide(uint32_t failures) {
+  if (failures >= Mood::brokenFailures) {
+    return mood_t::BROKEN;
+  } else if (Mood::inactiveFor >= Config::sad_num_epochs) {
+    return mood_t::SAD;
+  } else if (Mood::inactiveFor >= Config::bored_num_epochs) {
+    return mood_t::BORED;
+  } else if (Mood::activeFor >= Config::excited_num_epochs) {
+    return mood_t::HAPPY;
   }
 
-  return currentFace;
+  return mood_t::NEUTRAL;
 }
 
 /**
- * Checks if moods match one another.
- * If they're similar, return true.
- * If they aren't similar, return false.
- * @param previous Previous face
- * @param current Current face
+ * Folds this epoch's events into the streaks and switches resting mood once
+ * a new one has held for long enough
  */
-bool Mood::checkMood(String previous, String current) {
-  if (previous == current) {
-    return true;
-  } else if (previous != current) {
-    return false;
-  } else {
-    return false;
+void Mood::settle() {
+  uint32_t peers =
+      Mood::events[MOOD_EVENT_PEER_SEEN].exchange(0, std::memory_order_relaxed);
+  uint32_t empty = Mood::events[MOOD_EVENT_CHANNEL_EMPTY].exchange(
+      0, std::memory_order_relaxed);
+  uint32_t failures = Mood::events[MOOD_EVENT_TX_FAILURE].exchange(
+      0, std::memory_order_relaxed);
+
+  // an epoch where we didn't get to look counts as neither
+  if (peers > 0) {
+    Mood::activeFor++;
+    Mood::inactiveFor = 0;
+  } else if (empty > 0) {
+    Mood::inactiveFor++;
+    Mood::activeFor = 0;
   }
+
+  mood_t target = Mood::decide(failures);
+  if (target != Mood::pendingMood) {
+    Mood::pendingMood = target;
+    Mood::pendingFor = 0;
+  }
+  if (Mood::pendingFor < Mood::hysteresis) {
+    Mood::pendingFor++;
+  }
+
+  if (target == Mood::restingMood ||
+      (Mood::pendingFor < Mood::hysteresis && target != mood_t::BROKEN)) {
+    return;
+  }
+
+  Mood::restingMood = target;
+
+  // pwnagotchi around us see it in our beacon too
+  Config::face = Mood::face(target);
+
+  Console.print(Mood::face(target));
+  Console.print(" Feeling ");
+  Console.println(Mood::name(target));
+  Console.println(" ");
+  Mood::enter(target, "Feeling " + (String)Mood::name(target));
 }
@@ -17,38 +17,79 @@
  */
 
 /**
- * mood.cpp: header files for mood.cpp
+ * mood.h: header files for mood.cpp
  */
 
-#ifndef MOOD_CPP
-#define MOOD_CPP
+#ifndef MOOD_H
+#define MOOD_H
 
-#include "config.h"
-#include "display.h"
 #include <Arduino.h>
-#include <string>
+#include <atomic>
+#include <stdint.h>
+
+// how the minigotchi feels, see FACES.md
+enum class mood_t : uint8_t {
+  HAPPY = 0,
+  SAD,
+  BROKEN,
+  INTENSE,
+  LOOKING1,
+  LOOKING2,
+  NEUTRAL,
+  SLEEPING,
+  BORED
+};
+
+// things that happened which slowly change how the minigotchi feels
+typedef enum {
+  MOOD_EVENT_PEER_SEEN = 0,
+  MOOD_EVENT_CHANNEL_EMPTY,
+  MOOD_EVENT_TX_FAILURE,
+  MOOD_EVENT_EPOCH,
+  MOOD_EVENTS
+} mood_event_t;
 
 class Mood {
 public:
-  static String happy;
-  static String sad;
-  static String broken;
-  static String intense;
-  static String looking1;
-  static String looking2;
-  static String neutral;
-  static String sleeping;
-
-  static String getFull(String face);
-  static String getCurrentFace();
-  static String getCurrentMood();
-  static String getMood(String face);
-  static String getFace(String mood);
-  static bool checkMood(String previous, String current);
+  static void enter(mood_t mood);
+  static void enter(mood_t mood, const String &text);
+  static mood_t current();
+  static const char *face(mood_t mood);
+  static const char *name(mood_t mood);
+  static void post(mood_event_t event);
+  static mood_t resting();
+
+  // how many moods there are
+  static const uint8_t count = 9;
+
+  // epochs in a row a new resting mood has to win before we switch to it
+  static const uint8_t hysteresis = 2;
+
+  // failed transmissions in one epoch before we feel broken
+  static const uint32_t brokenFailures = 3;
 
 private:
-  static String currentMood;
-  static String currentFace;
+  static mood_t decide(uint32_t failures);
+  static void settle();
+
+  // indexed by mood_t
+  static constexpr const char *faces[Mood::count] = {
+      "(^-^)", "(;-;)", "(X-X)", "(>-<)", "(0-o)",
+      "(o-0)", "('-')", "(-.-)", "(-_-)"};
+  static constexpr const char *names[Mood::count] = {
+      "happy",    "sad",     "broken",   "intense", "looking1",
+      "looking2", "neutral", "sleeping", "bored"};
+
+  static mood_t currentMood;
+
+  // events posted since the last epoch, indexed by mood_event_t
+  static std::atomic<uint32_t> events[MOOD_EVENTS];
+
+  static int activeFor;
+  static int inactiveFor;
+  static mood_t restingMood;
+  static mood_t pendingMood;
+  static uint8_t pendingFor;
 };
 
-#endif // MOOD_CPP
+#endif // MOOD_H
@@ -23,6 +23,89 @@
 #include "parasite.h"
 
 int Parasite::channel = 0;
+bool Parasite::binary = false;
+
+const uint32_t Parasite::rxSize;
+uint8_t Parasite::rxRing[Parasite::rxSize];
+std::atomic<uint32_t> Parasite::rxHead(0);
+std::atomic<uint32_t> Parasite::rxTail(0);
+volatile uint32_t Parasite::rxDropped = 0;
+uint32_t Parasite::rxReported = 0;
+
+uint8_t Parasite::rxBuffer[Framing::maxFrame];
+size_t Parasite::rxLength = 0;
+bool Parasite::rxOverflow = false;
+
+const unsigned long Parasite::window;
+const uint8_t Parasite::eventSize;
+parasite_event_t Parasite::events[Parasite::eventSize];
+uint8_t Parasite::eventCount = 0;
+unsigned long Parasite::lastFlush = 0;
+uint32_t Parasite::coalesced = 0;
+uint32_t Parasite::dropped = 0;
+
+/** developer note:
+ *
+ * the pwnagotchi plugin talks to us in lines like 'chn:::6', and we answer
+ * with 'cmd:::{json}' lines. if the plugin sends 'nme:::bin' instead of
+ * 'nme:::' we switch to binary frames (see framing.cpp) for everything we send
+ * after that, with a fixed struct per message instead of json. a plugin that
+ * doesn't know about frames never asks, and if we're too old to know about
+ * them it just gets a text answer back and stays on text. a plain 'nme:::'
+ * puts us back on text.
+ *
+ * the plugin can send frames to us too, so we read byte by byte: a zero ends
+ * a frame and a newline ends a text command.
+ *
+ * bytes are pulled off the uart as soon as they arrive by onReceive(), which
+ * runs on the uart event task. it drops them in a ring and wakes the
+ * scheduler, which calls readData() on every tick, so a 'chn:::' gets acted
+ * on within a few milliseconds instead of whenever the next phase starts. a
+ * half received command just sits in rxBuffer until the rest shows up, we
+ * never wait for it.
+ *
+ * what we send goes through a small queue. the same message again (same
+ * friend, same ap, ...) just bumps a count on the one that's waiting, and the
+ * queue is sent off at most once every window, all at once: one batch frame
+ * on binary, or the lines one after the other on text. so a busy channel
+ * can't flood the plugin with the same friend over and over. the name is an
+ * answer to the plugin, so that one goes out straight away.
+ *
+ */
+
+/**
+ * Starts listening to the pwnagotchi, call after Serial.begin()
+ */
+void Parasite::begin() {
+  if (Config::parasite) {
+    Serial.onReceive(Parasite::onReceive);
+  }
+}
+
+/**
+ * Moves whatever the uart got into our ring, runs on the uart event task
+ */
+void Parasite::onReceive() {
+  uint32_t head = Parasite::rxHead.load(std::memory_order_relaxed);
+  while (Serial.available() > 0) {
+    int c = Serial.read();
+    if (c < 0) {
+      break;
+    }
+
+    uint32_t tail = Parasite::rxTail.load(std::memory_order_acquire);
+    if (head - tail >= Parasite::rxSize) {
+      Parasite::rxDropped++;
+      continue;
+    }
+
+    Parasite::rxRing[head & (Parasite::rxSize - 1)] = c;
+    head++;
+  }
+
+  Parasite::rxHead.store(head, std::memory_order_release);
+  Scheduler::wake();
+}
 
 /**
  * Reads data from Parasite mode on the Minigotchi
@@ -30,20 +113,48 @@ int Parasite::channel = 0;
 void Parasite::readData() {
   if (Config::parasite) {
     int curChan = Parasite::channel;
-    while (Serial.available() > 0) {
-      String line = Serial.readStringUntil('\n');
-      if (line.startsWith("chn:::")) {
-        int chn = atoi(line.substring(6).c_str());
-        if (Channel::isValidChannel(chn)) {
-          Parasite::channel = chn;
-        } else {
-          Parasite::channel = 0;
+    uint32_t tail = Parasite::rxTail.load(std::memory_order_relaxed);
+    uint32_t head = Parasite::rxHead.load(std::memory_order_acquire);
+    while (tail != head) {
+      uint8_t c = Parasite::rxRing[tail & (Parasite::rxSize - 1)];
+      Parasite::rxTail.store(++tail, std::memory_order_release);
+
+      // on text everything is a line. on binary a newline can be part of a
+      // frame, but frames never look like 'cmd:::' so those are still lines
+      bool command = Parasite::rxLength >= 6 &&
+                     memcmp(Parasite::rxBuffer + 3, ":::", 3) == 0;
+      bool line = c == '\n' && (!Parasite::binary || command);
+
+      if (c == 0 || line) {
+        if (!Parasite::rxOverflow && Parasite::rxLength > 0) {
+          if (line) {
+            if (Parasite::rxBuffer[Parasite::rxLength - 1] == '\r') {
+              Parasite::rxLength--;
+            }
+            Parasite::rxBuffer[Parasite::rxLength] = '\0';
+            Parasite::handleLine((const char *)Parasite::rxBuffer);
+          } else {
+            Parasite::handleFrame(Parasite::rxBuffer, Parasite::rxLength);
+          }
         }
-      } else if (line.startsWith("nme:::")) {
-        Parasite::sendName();
+        Parasite::rxLength = 0;
+        Parasite::rxOverflow = false;
+      } else if (Parasite::rxLength < sizeof(Parasite::rxBuffer) - 1) {
+        Parasite::rxBuffer[Parasite::rxLength++] = c;
+      } else {
+        // too long to be anything we know, drop it up to the next delimiter
+        Parasite::rxOverflow = true;
       }
     }
 
+    uint32_t dropped = Parasite::rxDropped;
+    if (dropped != Parasite::rxReported) {
+      Console.print("(X-X) Serial buffer full, dropped ");
+      Console.print(dropped - Parasite::rxReported);
+      Console.println(" bytes from the pwnagotchi");
+      Parasite::rxReported = dropped;
+    }
+
     // If parasite channel is set and is different than what was there before,
     // notify that we're synced Otherwise if parasite channel is not set but was
     // before, notify we've unsynced
@@ -55,33 +166,84 @@ void Parasite::readData() {
   }
 }
 
+/**
+ * Handles a text command from the plugin
+ * @param line Command without the newline
+ */
+void Parasite::handleLine(const char *line) {
+  if (strncmp(line, "chn:::", 6) == 0) {
+    Parasite::setChannel(atoi(line + 6));
+  } else if (strncmp(line, "nme:::", 6) == 0) {
+    Parasite::binary = strcmp(line + 6, "bin") == 0;
+    Parasite::sendName();
+  }
+}
+
+/**
+ * Handles a binary frame from the plugin, anything that doesn't check out is
+ * ignored
+ * @param frame Encoded frame without delimiters
+ * @param length Length of the frame
+ */
+void Parasite::handleFrame(uint8_t *frame, size_t length) {
+  framing_header_t header;
+  const uint8_t *payload;
+  if (!Framing::decode(frame, length, &header, &payload)) {
+    return;
+  }
+
+  if (header.type == PARASITE_CHANNEL &&
+      header.length == sizeof(parasite_channel_t)) {
+    parasite_channel_t msg;
+    memcpy(&msg, payload, sizeof(msg));
+    Parasite::setChannel(msg.channel);
+  } else if (header.type == PARASITE_NAME) {
+    Parasite::sendName();
+  }
+}
+
+/**
+ * Syncs to the channel the plugin told us about
+ * @param chn Channel, anything invalid means we pick our own
+ */
+void Parasite::setChannel(int chn) {
+  if (Channel::isValidChannel(chn)) {
+    Parasite::channel = chn;
+  } else {
+    Parasite::channel = 0;
+  }
+}
+
 /**
  * Shows current channel
  * @param status Channel, either synced or unsynced
  */
 void Parasite::sendChannelStatus(parasite_channel_status_type_t status) {
   if (Config::parasite) {
-    char chnBuf[4];
-    snprintf(chnBuf, sizeof(chnBuf), "%d", Parasite::channel);
-    Parasite::sendData("chn", static_cast<uint8_t>(status), chnBuf);
+    parasite_channel_t msg = {(uint8_t)Parasite::channel};
+    Parasite::queue(PARASITE_CHANNEL, status, &msg, sizeof(msg));
   }
 }
 
 /**
- * Send the Minigotchi's name to serial
+ * Send the Minigotchi's name to serial, this answers the plugin so it isn't
+ * queued
  */
 void Parasite::sendName() {
   if (Config::parasite) {
-    if (Config::name.length() > 25) {
-      // Pwnagotchi names can be 25 characters max, so want to limit our
-      // Minigotchi's name to that as well Will truncate it to 22 characters +
-      // "..." if it exceeds 25
-      char buf[26];
-      Parasite::formatData(buf, Config::name.c_str(), sizeof(buf));
-      Parasite::sendData("nme", 200, buf);
-    } else {
-      Parasite::sendData("nme", 200, Config::name.c_str());
+    if (Parasite::binary) {
+      parasite_name_t msg;
+      Parasite::copyName(msg.name, Config::name.c_str(), sizeof(msg.name));
+      Parasite::sendFrame(PARASITE_NAME, 200, &msg, sizeof(msg));
+      return;
     }
+
+    // Pwnagotchi names can be 25 characters max, so want to limit our
+    // Minigotchi's name to that as well Will truncate it to 22 characters +
+    // "..." if it exceeds 25
+    char buf[26];
+    Parasite::copyName(buf, Config::name.c_str(), sizeof(buf));
+    Parasite::sendData("nme", 200, buf, 1);
   }
 }
 
@@ -90,7 +252,7 @@ void Parasite::sendName() {
  */
 void Parasite::sendAdvertising() {
   if (Config::parasite) {
-    Parasite::sendData("adv", 200, nullptr);
+    Parasite::queue(PARASITE_ADVERTISE, 200, nullptr, 0);
   }
 }
 
@@ -110,15 +272,11 @@ void Parasite::sendPwnagotchiStatus(parasite_pwnagotchi_scan_type_t status) {
 void Parasite::sendPwnagotchiStatus(parasite_pwnagotchi_scan_type_t status,
                                     const char *frd) {
   if (Config::parasite) {
-    if (frd != nullptr && strlen(frd) > 25) {
-      // frd is another Pwnagotchi's name, which should be 25 characters max
-      // Will truncate it to 22 characters + "..." if it exceeds 25 somehow
-      char buf[26];
-      Parasite::formatData(buf, frd, sizeof(buf));
-      Parasite::sendData("pwn", static_cast<uint8_t>(status), buf);
-    } else {
-      Parasite::sendData("pwn", static_cast<uint8_t>(status), frd);
-    }
+    // frd is another Pwnagotchi's name, which should be 25 characters max
+    // Will truncate it to 22 characters + "..." if it exceeds 25 somehow
+    parasite_name_t msg;
+    Parasite::copyName(msg.name, frd, sizeof(msg.name));
+    Parasite::queue(PARASITE_PWNAGOTCHI, status, &msg, sizeof(msg));
   }
 }
 
@@ -139,28 +297,165 @@ void Parasite::sendDeauthStatus(parasite_deauth_status_type_t status) {
 void Parasite::sendDeauthStatus(parasite_deauth_status_type_t status,
                                 const char *target, int channel) {
   if (Config::parasite) {
-    if (target != nullptr && channel > 0) {
-      JsonDocument doc;
-      char chnBuf[4];
-      char buf[65];
-
-      snprintf(chnBuf, sizeof(chnBuf), "%d", channel);
-      // target is an SSID, which should only be 32 characters at most
-      // Unlikely scenario but will truncate to 29 characters + "..." in case
-      // that gets disrespected by someone
-      if (strlen(target) > 32) {
-        char targetBuf[33];
-        Parasite::formatData(targetBuf, target, sizeof(targetBuf));
-        doc["ssid"] = targetBuf;
-      } else {
-        doc["ssid"] = target;
+    // target is an SSID, which should only be 32 characters at most
+    // Unlikely scenario but will truncate to 29 characters + "..." in case
+    // that gets disrespected by someone
+    parasite_deauth_t msg;
+    msg.channel = target != nullptr && channel > 0 ? channel : 0;
+    Parasite::copyName(msg.ssid, msg.channel > 0 ? target : nullptr,
+                       sizeof(msg.ssid));
+    Parasite::queue(PARASITE_DEAUTH, status, &msg, sizeof(msg));
+  }
+}
+
+/**
+ * Queues a message for the next flush(), merging it into one that's already
+ * waiting if it's the same thing again
+ * @param type Message type
+ * @param status Current status
+ * @param payload Message struct, can be null if length is 0
+ * @param length Size of the message struct
+ */
+void Parasite::queue(parasite_message_type_t type, uint8_t status,
+                     const void *payload, size_t length) {
+  for (uint8_t i = 0; i < Parasite::eventCount; i++) {
+    parasite_event_t *event = &Parasite::events[i];
+    if (event->type != type) {
+      continue;
+    }
+
+    // only the latest channel matters, everything else has to match exactly
+    if (type == PARASITE_CHANNEL ||
+        (event->status == status && event->length == length &&
+         memcmp(event->payload, payload, length) == 0)) {
+      event->status = status;
+      memcpy(event->payload, payload, length);
+      if (event->count < UINT8_MAX) {
+        event->count++;
       }
-      doc["channel"] = chnBuf;
-      serializeJson(doc, buf);
-      Parasite::sendData("atk", static_cast<uint8_t>(status), buf);
-    } else {
-      Parasite::sendData("atk", static_cast<uint8_t>(status), nullptr);
+      Parasite::coalesced++;
+      return;
+    }
+  }
+
+  if (Parasite::eventCount == Parasite::eventSize) {
+    Parasite::dropped++;
+    return;
+  }
+
+  parasite_event_t *event = &Parasite::events[Parasite::eventCount++];
+  event->type = type;
+  event->status = status;
+  event->count = 1;
+  event->length = length;
+  if (length > 0) {
+    memcpy(event->payload, payload, length);
+  }
+
+  // make sure the scheduler doesn't sleep through the next flush
+  Scheduler::remind(Parasite::lastFlush + Parasite::window);
+}
+
+/**
+ * Sends everything that's queued, at most once every window
+ */
+void Parasite::flush() {
+  if (Parasite::eventCount == 0 ||
+      millis() - Parasite::lastFlush < Parasite::window) {
+    return;
+  }
+
+  Parasite::lastFlush = millis();
+
+  if (!Parasite::binary) {
+    for (uint8_t i = 0; i < Parasite::eventCount; i++) {
+      Parasite::sendText(&Parasite::events[i]);
+    }
+    Parasite::eventCount = 0;
+    return;
+  }
+
+  // each record is type, status, count, length and the message struct
+  uint8_t batch[Framing::maxPayload];
+  size_t used = 0;
+  for (uint8_t i = 0; i < Parasite::eventCount; i++) {
+    const parasite_event_t *event = &Parasite::events[i];
+    if (used + 4 + event->length > sizeof(batch)) {
+      Parasite::sendFrame(PARASITE_BATCH, 200, batch, used);
+      used = 0;
     }
+
+    batch[used++] = event->type;
+    batch[used++] = event->status;
+    batch[used++] = event->count;
+    batch[used++] = event->length;
+    memcpy(batch + used, event->payload, event->length);
+    used += event->length;
+  }
+
+  Parasite::sendFrame(PARASITE_BATCH, 200, batch, used);
+  Parasite::eventCount = 0;
+}
+
+/**
+ * Prints how much telemetry got merged or thrown away
+ */
+void Parasite::printTelemetry() {
+  if (Parasite::coalesced == 0 && Parasite::dropped == 0) {
+    return;
+  }
+
+  Console.print("('-') Parasite messages merged: ");
+  Console.print(Parasite::coalesced);
+  Console.print(", dropped: ");
+  Console.println(Parasite::dropped);
+}
+
+/**
+ * Sends a queued message as a line of text
+ * @param event Message to send
+ */
+void Parasite::sendText(const parasite_event_t *event) {
+  switch (event->type) {
+  case PARASITE_CHANNEL: {
+    parasite_channel_t msg;
+    memcpy(&msg, event->payload, sizeof(msg));
+    char chnBuf[4];
+    snprintf(chnBuf, sizeof(chnBuf), "%d", msg.channel);
+    Parasite::sendData("chn", event->status, chnBuf, event->count);
+    break;
+  }
+  case PARASITE_ADVERTISE:
+    Parasite::sendData("adv", event->status, nullptr, event->count);
+    break;
+  case PARASITE_PWNAGOTCHI: {
+    parasite_name_t msg;
+    memcpy(&msg, event->payload, sizeof(msg));
+    Parasite::sendData("pwn", event->status,
+                       msg.name[0] != '\0' ? msg.name : nullptr,
+                       event->count);
+    break;
+  }
+  case PARASITE_DEAUTH: {
+    parasite_deauth_t msg;
+    memcpy(&msg, event->payload, sizeof(msg));
+    if (msg.channel == 0) {
+      Parasite::sendData("atk", event->status, nullptr, event->count);
+      break;
+    }
+
+    JsonDocument doc;
+    char chnBuf[4];
+    char buf[65];
+    snprintf(chnBuf, sizeof(chnBuf), "%d", msg.channel);
+    doc["ssid"] = msg.ssid;
+    doc["channel"] = chnBuf;
+    serializeJson(doc, buf);
+    Parasite::sendData("atk", event->status, buf, event->count);
+    break;
+  }
+  default:
+    break;
   }
 }
 
@@ -169,10 +464,13 @@ void Parasite::sendDeauthStatus(parasite_deauth_status_type_t status,
  * @param command Current command
  * @param status Current status
  * @param data Data to use
+ * @param count How many times this happened since the last one was sent
  */
-void Parasite::sendData(const char *command, uint8_t status, const char *data) {
+void Parasite::sendData(const char *command, uint8_t status, const char *data,
+                        uint8_t count) {
   JsonDocument doc;
   char nBuf[4];  // Up to 3 digits + null terminator
+  char cBuf[4];  // Same for the count
   char buf[129]; // Up to 128 characters + null terminator
   char fullCmd[135] = {
       0}; // Data buffer (128) + command (3) + delimiter (3) + null terminator
@@ -181,11 +479,32 @@ void Parasite::sendData(const char *command, uint8_t status, const char *data) {
   if (data != nullptr) {
     doc["data"] = data;
   }
+  if (count > 1) {
+    snprintf(cBuf, sizeof(cBuf), "%d", count);
+    doc["count"] = cBuf;
+  }
   serializeJson(doc, buf);
   strncat(fullCmd, command, sizeof(fullCmd) - 1);
   strncat(fullCmd, ":::", sizeof(fullCmd) - strlen(fullCmd) - 1);
   strncat(fullCmd, buf, sizeof(fullCmd) - strlen(fullCmd) - 1);
-  Serial.println(fullCmd);
+  Console.println(fullCmd);
+}
+
+/**
+ * Sends a binary frame to serial
+ * @param type Message type
+ * @param status Current status
+ * @param payload Message struct, can be null if length is 0
+ * @param length Size of the message struct
+ */
+void Parasite::sendFrame(parasite_message_type_t type, uint8_t status,
+                         const void *payload, size_t length) {
+  uint8_t buf[Framing::maxFrame];
+  size_t frameLength =
+      Framing::encode(type, status, payload, length, buf, sizeof(buf));
+  if (frameLength > 0) {
+    Console.write(buf, frameLength);
+  }
 }
 
 /**
@@ -199,3 +518,23 @@ void Parasite::formatData(char *buf, const char *data, size_t bufSize) {
   strncat(buf, data, bufSize - 4);
   strncat(buf, "...", bufSize - strlen(buf) - 1);
 }
+
+/**
+ * Copies a name into a fixed size field, truncating it the same way
+ * formatData() does
+ * @param buf Field to fill, zeroed past the name
+ * @param data Name to copy, can be null
+ * @param bufSize The size of the field
+ */
+void Parasite::copyName(char *buf, const char *data, size_t bufSize) {
+  memset(buf, 0, bufSize);
+  if (data == nullptr) {
+    return;
+  }
+
+  if (strlen(data) > bufSize - 1) {
+    Parasite::formatData(buf, data, bufSize);
+  } else {
+    strncpy(buf, data, bufSize - 1);
+  }
+}
@@ -25,11 +25,15 @@
 
 #include "channel.h"
 #include "config.h"
+#include "console.h"
 #include "deauth.h"
 #include "frame.h"
+#include "framing.h"
 #include "pwnagotchi.h"
+#include "scheduler.h"
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include <atomic>
 
 typedef enum {
   SCANNING = 200,
@@ -53,9 +57,47 @@ typedef enum {
   DEAUTH_SCAN_ERROR = 250
 } parasite_deauth_status_type_t;
 
+// message types once we've switched to binary frames, one per text command
+typedef enum {
+  PARASITE_NAME = 1,       // nme
+  PARASITE_CHANNEL = 2,    // chn
+  PARASITE_ADVERTISE = 3,  // adv
+  PARASITE_PWNAGOTCHI = 4, // pwn
+  PARASITE_DEAUTH = 5,     // atk
+  PARASITE_BATCH = 6       // several of the above, see Parasite::flush()
+} parasite_message_type_t;
+
+// payload of nme and pwn frames, names are 25 characters max
+typedef struct __attribute__((packed)) {
+  char name[26];
+} parasite_name_t;
+
+// payload of chn frames both ways, 0 means we're picking channels ourselves
+typedef struct __attribute__((packed)) {
+  uint8_t channel;
+} parasite_channel_t;
+
+// payload of atk frames
+typedef struct __attribute__((packed)) {
+  uint8_t channel;
+  char ssid[33];
+} parasite_deauth_t;
+
+// a message waiting to be sent, and how many times it came up meanwhile
+typedef struct {
+  uint8_t type;
+  uint8_t status;
+  uint8_t count;
+  uint8_t length;
+  uint8_t payload[sizeof(parasite_deauth_t)];
+} parasite_event_t;
+
 class Parasite {
 public:
+  static void begin();
   static void readData();
+  static void flush();
+  static void printTelemetry();
   static void sendChannelStatus(parasite_channel_status_type_t status);
   static void sendName();
   static void sendAdvertising();
@@ -66,10 +108,48 @@ public:
   static void sendDeauthStatus(parasite_deauth_status_type_t status,
                                const char *target, int channel);
   static int channel;
+  static bool binary;
+
+  // must be a power of two
+  static const uint32_t rxSize = 256;
+
+  // how often we send what's queued, and how much can wait
+  static const unsigned long window = 250;
+  static const uint8_t eventSize = 16;
 
 private:
-  static void sendData(const char *command, uint8_t status, const char *data);
+  static void onReceive();
+  static void handleLine(const char *line);
+  static void handleFrame(uint8_t *frame, size_t length);
+  static void setChannel(int chn);
+  static void queue(parasite_message_type_t type, uint8_t status,
+                    const void *payload, size_t length);
+  static void sendText(const parasite_event_t *event);
+  static void sendData(const char *command, uint8_t status, const char *data,
+                       uint8_t count);
+  static void sendFrame(parasite_message_type_t type, uint8_t status,
+                        const void *payload, size_t length);
   static void formatData(char *buf, const char *data, size_t bufSize);
+  static void copyName(char *buf, const char *data, size_t bufSize);
+
+  // single producer (uart event task), single consumer (us) ring of bytes
+  static uint8_t rxRing[];
+  static std::atomic<uint32_t> rxHead;
+  static std::atomic<uint32_t> rxTail;
+  static volatile uint32_t rxDropped;
+  static uint32_t rxReported;
+
+  // telemetry waiting for the next flush()
+  static parasite_event_t events[];
+  static uint8_t eventCount;
+  static unsigned long lastFlush;
+  static uint32_t coalesced;
+  static uint32_t dropped;
+
+  // bytes read so far of the line or frame we're in the middle of
+  static uint8_t rxBuffer[];
+  static size_t rxLength;
+  static bool rxOverflow;
 };
 
 #endif // PARASITE_H
@@ -38,6 +38,56 @@
 // start off false
 bool Pwnagotchi::pwnagotchiDetected = false;
 
+/** developer note:
+ *
+ * the promiscuous callback runs inside the wifi driver's task, so it can't
+ * be printing, drawing or parsing json. all it does is check if the frame is
+ * a pwnagotchi beacon and copy it into a free slot of this ring. every step
+ * of detect() drains the ring and does the slow stuff from there.
+ *
+ * only the callback moves ringHead and only process() moves ringTail, so no
+ * locking is needed. if the ring is full the beacon is dropped and counted.
+ *
+ */
+
+pwnagotchi_packet_t Pwnagotchi::ring[Pwnagotchi::slotCount];
+std::atomic<uint32_t> Pwnagotchi::ringHead(0);
+std::atomic<uint32_t> Pwnagotchi::ringTail(0);
+volatile uint32_t Pwnagotchi::dropped = 0;
+
+uint16_t Pwnagotchi::signatureLow = 0;
+uint32_t Pwnagotchi::signatureHigh = 0;
+
+uint8_t Pwnagotchi::chunks[PWNAGOTCHI_SLOT_SIZE];
+uint8_t Pwnagotchi::payload[PWNAGOTCHI_PAYLOAD_SIZE];
+
+/** developer note:
+ *
+ * a pwnagotchi keeps advertising the whole time we're listening, and at a
+ * meetup there can be a lot of them. so we remember who we've heard from in
+ * a small table keyed by their identity (or their name if they don't send
+ * one) and only print and report a pwnagotchi the first time we see it, or
+ * when its name, face or pwnd count changes.
+ *
+ * an identical beacon is caught by its hash before it even gets inflated or
+ * parsed, everything else just bumps the counters of the peer it came from.
+ * peers we haven't heard from in peerTimeout are forgotten and their slot
+ * reused, if the table is full the one heard from longest ago goes.
+ *
+ * a beacon we can't parse has no identity to go in the table, so its hash
+ * goes in a small list of bad beacons instead. it's only reported once and
+ * not put back together and inflated every time it comes in again.
+ *
+ */
+
+pwnagotchi_peer_t Pwnagotchi::peers[Pwnagotchi::peerCount];
+uint32_t Pwnagotchi::badBeacons[Pwnagotchi::badCount];
+uint8_t Pwnagotchi::badUsed = 0;
+uint8_t Pwnagotchi::badNext = 0;
+unsigned long Pwnagotchi::scanStart = 0;
+unsigned long Pwnagotchi::scanLength = 0;
+pwnagotchi_detect_state_t Pwnagotchi::state = DETECT_START;
+
 /**
  * Get's the mac based on source address
  * @param addr Address to use
@@ -60,169 +110,794 @@ std::string Pwnagotchi::extractMAC(const unsigned char *buff) {
   return std::string(addr);
 }
 
+// scanning animation, played while we listen
+static const scheduler_frame_t scanFrames[] = {
+    {mood_t::LOOKING1, "Scanning  for Pwnagotchi.",
+     "(0-o) Scanning for Pwnagotchi."},
+    {mood_t::LOOKING2, "Scanning  for Pwnagotchi..",
+     "(o-0) Scanning for Pwnagotchi.."},
+    {mood_t::LOOKING1, "Scanning  for Pwnagotchi...",
+     "(0-o) Scanning for Pwnagotchi..."},
+    {mood_t::NEUTRAL, nullptr, " "}};
+
+// what the screen says about the last pwnagotchi we found, one line after
+// the other, filled in by handle()
+static char friendName[64];
+static char friendPwnd[48];
+static const scheduler_frame_t friendFrames[] = {
+    {mood_t::HAPPY, friendName, nullptr},
+    {mood_t::HAPPY, friendPwnd, nullptr}};
+
 /**
- * Detect a Pwnagotchi
+ * Detect a Pwnagotchi, one step at a time
  */
-void Pwnagotchi::detect() {
-  if (Config::scan) {
+unsigned long Pwnagotchi::detect() {
+  switch (Pwnagotchi::state) {
+  case DETECT_START:
+    if (!Config::scan) {
+      return Scheduler::done;
+    }
+
+    Pwnagotchi::reset();
+
     // set mode and callback
     Minigotchi::monStart();
-    esp_wifi_set_promiscuous_rx_cb(pwnagotchiCallback);
-
-    // cool animation
-    for (int i = 0; i < 5; ++i) {
-      Serial.println("(0-o) Scanning for Pwnagotchi.");
-      Display::updateDisplay("(0-o)", "Scanning  for Pwnagotchi.");
-      delay(Config::shortDelay);
-      Serial.println("(o-0) Scanning for Pwnagotchi..");
-      Display::updateDisplay("(o-0)", "Scanning  for Pwnagotchi..");
-      delay(Config::shortDelay);
-      Serial.println("(0-o) Scanning for Pwnagotchi...");
-      Display::updateDisplay("(0-o)", "Scanning  for Pwnagotchi...");
-      delay(Config::shortDelay);
-      Serial.println(" ");
-      delay(Config::shortDelay);
-    }
-
-    // delay for scanning
-    delay(Config::longDelay);
-
-    // check if the pwnagotchiCallback wasn't triggered during scanning
-    if (!pwnagotchiDetected) {
-      // only searches on your current channel and such afaik,
-      // so this only applies for the current searching area
-      Minigotchi::monStop();
-      Pwnagotchi::stopCallback();
-      Serial.println("(;-;) No Pwnagotchi found");
-      Display::updateDisplay("(;-;)", "No Pwnagotchi found.");
-      Serial.println(" ");
-      Parasite::sendPwnagotchiStatus(NO_FRIEND_FOUND);
-    } else if (pwnagotchiDetected) {
-      Minigotchi::monStop();
-      Pwnagotchi::stopCallback();
-    } else {
-      Minigotchi::monStop();
-      Pwnagotchi::stopCallback();
-      Serial.println("(X-X) How did this happen?");
-      Display::updateDisplay("(X-X)", "How did this happen?");
-      Parasite::sendPwnagotchiStatus(FRIEND_SCAN_ERROR);
+    Radio::listen(pwnagotchiCallback);
+
+    // cool animation, then a while longer for scanning
+    Scheduler::animate(scanFrames, 4, 5, Config::shortDelay);
+    Pwnagotchi::scanLength = 20 * Config::shortDelay + Channel::dwell();
+    Pwnagotchi::state = DETECT_LISTEN;
+
+    // or go through every channel instead
+    if (Config::sweep) {
+      Channel::startSweep();
+    }
+    return 0;
+
+  case DETECT_LISTEN:
+    Pwnagotchi::process();
+    if (Config::sweep ? Channel::sweep()
+                      : millis() - Pwnagotchi::scanStart <
+                            Pwnagotchi::scanLength) {
+      return 10;
     }
+    break;
+  }
+
+  // handle whatever came in before the callback was removed
+  Pwnagotchi::state = DETECT_START;
+  if (Scheduler::playing(scanFrames)) {
+    Scheduler::stopAnimation();
+  }
+  Minigotchi::monStop();
+  Pwnagotchi::stopCallback();
+  Pwnagotchi::process();
+
+  if (Config::sweep) {
+    Channel::printSweep();
+  }
+
+  if (Pwnagotchi::dropped > 0) {
+    Console.print("(X-X) Dropped ");
+    Console.print(Pwnagotchi::dropped);
+    Console.println(" Pwnagotchi beacons, we couldn't keep up!");
+    Console.println(" ");
+  }
+
+  // check if the pwnagotchiCallback wasn't triggered during scanning
+  if (!pwnagotchiDetected) {
+    // only searches on your current channel and such afaik,
+    // so this only applies for the current searching area
+    Console.println("(;-;) No Pwnagotchi found");
+    Mood::enter(mood_t::SAD, "No Pwnagotchi found.");
+    Mood::post(MOOD_EVENT_CHANNEL_EMPTY);
+    Console.println(" ");
+    Parasite::sendPwnagotchiStatus(NO_FRIEND_FOUND);
+  } else if (pwnagotchiDetected) {
+    // already reported as they came in, just sum it up
+    Console.print("(^-^) Heard from ");
+    Console.print(Pwnagotchi::heard());
+    Console.println(" Pwnagotchi this scan");
+    Console.println(" ");
   } else {
+    Console.println("(X-X) How did this happen?");
+    Mood::enter(mood_t::BROKEN, "How did this happen?");
+    Parasite::sendPwnagotchiStatus(FRIEND_SCAN_ERROR);
+  }
+
+  return Scheduler::done;
+}
+
+/**
+ * Forgets anything left over from the last scan, call before the callback
+ * gets any frames
+ */
+void Pwnagotchi::reset() {
+  Pwnagotchi::ringTail.store(Pwnagotchi::ringHead.load());
+  Pwnagotchi::dropped = 0;
+  Pwnagotchi::pwnagotchiDetected = false;
+  Pwnagotchi::scanStart = millis();
+
+  // what the callback matches source addresses against
+  memcpy(&Pwnagotchi::signatureLow, Frame::SignatureAddr, 2);
+  memcpy(&Pwnagotchi::signatureHigh, Frame::SignatureAddr + 2, 4);
+}
+
+/**
+ * Returns how many Pwnagotchi we heard from since the scan started
+ */
+int Pwnagotchi::heard() {
+  int heard = 0;
+  for (int i = 0; i < Pwnagotchi::peerCount; i++) {
+    if (Pwnagotchi::alive(&Pwnagotchi::peers[i]) &&
+        Pwnagotchi::peers[i].lastSeen >= Pwnagotchi::scanStart) {
+      heard++;
+    }
   }
+  return heard;
 }
 
 /**
  * Stops Pwnagotchi scan
  */
-void Pwnagotchi::stopCallback() { esp_wifi_set_promiscuous_rx_cb(nullptr); }
+void Pwnagotchi::stopCallback() { Radio::listen(nullptr); }
 
 /**
- * Pwnagotchi Scanning callback
+ * Pwnagotchi Scanning callback, this only queues up beacons for process()
  * Source:
  * https://github.com/justcallmekoko/ESP32Marauder/blob/master/esp32_marauder/WiFiScan.cpp#L2439
  * @param buf Packet recieved to use as a buffer
- * @param len Length of the buffer
+ * @param type Type of packet
  */
 void Pwnagotchi::pwnagotchiCallback(void *buf,
                                     wifi_promiscuous_pkt_type_t type) {
+  if (type != WIFI_PKT_MGMT) {
+    return;
+  }
+
   wifi_promiscuous_pkt_t *snifferPacket = (wifi_promiscuous_pkt_t *)buf;
-  WifiMgmtHdr *frameControl = (WifiMgmtHdr *)snifferPacket->payload;
-  wifi_pkt_rx_ctrl_t ctrl = (wifi_pkt_rx_ctrl_t)snifferPacket->rx_ctrl;
-  int len = snifferPacket->rx_ctrl.sig_len;
-
-  if (type == WIFI_PKT_MGMT) {
-    len -= 4;
-    int fctl = ntohs(frameControl->fctl);
-    const wifi_ieee80211_packet_t *ipkt =
-        (wifi_ieee80211_packet_t *)snifferPacket->payload;
-    const WifiMgmtHdr *hdr = &ipkt->hdr;
-
-    // check if it is a beacon frame
-    if (snifferPacket->payload[0] == 0x80) {
-      // extract mac
-      char addr[] = "00:00:00:00:00:00";
-      getMAC(addr, snifferPacket->payload, 10);
-      String src = addr;
-      // Serial.println("'" + src + "'");
-
-      // check if the source MAC matches the target
-      if (src == "de:ad:be:ef:de:ad") {
-        pwnagotchiDetected = true;
-        Serial.println("(^-^) Pwnagotchi detected!");
-        Serial.println(" ");
-        Display::updateDisplay("(^-^)", "Pwnagotchi detected!");
-        // delay(Config::shortDelay);
-
-        // extract the ESSID from the beacon frame
-        String essid = "";
-
-        // "borrowed" from ESP32 Marauder
-        for (int i = 38; i < len; i++) {
-          if (isAscii(snifferPacket->payload[i])) {
-            essid.concat((char)snifferPacket->payload[i]);
+  int len = snifferPacket->rx_ctrl.sig_len - 4; // no FCS
+  Channel::count(snifferPacket->rx_ctrl.channel);
+
+  if (!Pwnagotchi::isPwnagotchi(snifferPacket->payload, len)) {
+    return;
+  }
+  Capture::received(snifferPacket->payload, len, snifferPacket->rx_ctrl.rssi,
+                    snifferPacket->rx_ctrl.channel);
+
+  uint32_t head = Pwnagotchi::ringHead.load(std::memory_order_relaxed);
+  uint32_t tail = Pwnagotchi::ringTail.load(std::memory_order_acquire);
+  if (head - tail >= Pwnagotchi::slotCount) {
+    Pwnagotchi::dropped++;
+    return;
+  }
+
+  pwnagotchi_packet_t *packet =
+      &Pwnagotchi::ring[head & (Pwnagotchi::slotCount - 1)];
+  packet->len = (len > PWNAGOTCHI_SLOT_SIZE) ? PWNAGOTCHI_SLOT_SIZE : len;
+  packet->rssi = snifferPacket->rx_ctrl.rssi;
+  packet->channel = snifferPacket->rx_ctrl.channel;
+  memcpy(packet->payload, snifferPacket->payload, packet->len);
+
+  Pwnagotchi::ringHead.store(head + 1, std::memory_order_release);
+}
+
+/** developer note:
+ *
+ * this runs for every management frame on the channel, so instead of
+ * formatting the source address and comparing strings we compare the raw
+ * bytes. the driver hands us the frame 4 byte aligned, which puts bytes
+ * 10-11 of the source address on a 2 byte boundary and 12-15 on a 4 byte
+ * boundary. that's one 16 bit and one 32 bit load, no unaligned access.
+ *
+ */
+
+/**
+ * Checks if a frame is a beacon sent from the pwngrid signature address
+ * @param frame Frame to check, must be 4 byte aligned
+ * @param len Length of the frame
+ */
+bool Pwnagotchi::isPwnagotchi(const uint8_t *frame, int len) {
+  if (len < 16 || frame[0] != 0x80) {
+    return false;
+  }
+
+  const uint8_t *aligned = (const uint8_t *)__builtin_assume_aligned(frame, 4);
+  uint16_t low;
+  uint32_t high;
+  memcpy(&low, aligned + 10, sizeof(low));
+  memcpy(&high, aligned + 12, sizeof(high));
+
+  return low == Pwnagotchi::signatureLow && high == Pwnagotchi::signatureHigh;
+}
+
+/**
+ * Handles every beacon the callback has queued up so far
+ */
+void Pwnagotchi::process() {
+  uint32_t tail = Pwnagotchi::ringTail.load(std::memory_order_relaxed);
+  while (tail != Pwnagotchi::ringHead.load(std::memory_order_acquire)) {
+    Pwnagotchi::handle(&Pwnagotchi::ring[tail & (Pwnagotchi::slotCount - 1)]);
+    Pwnagotchi::ringTail.store(++tail, std::memory_order_release);
+  }
+}
+
+/**
+ * Parses and reports a beacon from a Pwnagotchi we haven't heard from yet
+ * @param packet Beacon to use
+ */
+void Pwnagotchi::handle(const pwnagotchi_packet_t *packet) {
+  pwnagotchiDetected = true;
+  Channel::heard(packet->channel);
+
+  // put the json back together from the beacon's elements
+  bool compressed = false;
+  size_t length = Pwnagotchi::reassemble(packet, &compressed);
+
+  // same beacon as last time, nothing to parse
+  uint32_t beaconHash = Pwnagotchi::hash(Pwnagotchi::chunks, length, 0);
+  pwnagotchi_peer_t *peer = Pwnagotchi::findBeacon(beaconHash);
+  if (peer != nullptr) {
+    Pwnagotchi::seen(peer, packet);
+    return;
+  }
+  if (Pwnagotchi::knownBad(beaconHash)) {
+    return;
+  }
+
+  const char *json = (const char *)Pwnagotchi::chunks;
+  if (compressed) {
+    json = (const char *)Pwnagotchi::payload;
+    length = Compression::decompress(Pwnagotchi::chunks, length,
+                                     Pwnagotchi::payload,
+                                     sizeof(Pwnagotchi::payload));
+  }
+
+  pwnagotchi_advert_t advert;
+  bool parsed = length > 0 && Pwnagotchi::parse(json, length, &advert);
+
+  // only report what's new
+  if (parsed) {
+    const char *key = (advert.identity[0] != '\0') ? advert.identity
+                                                     : advert.name;
+    uint32_t fieldHash =
+        Pwnagotchi::hash(advert.name, strlen(advert.name), 0);
+    fieldHash = Pwnagotchi::hash(advert.face, strlen(advert.face), fieldHash);
+    fieldHash = Pwnagotchi::hash(&advert.pwndTot, sizeof(advert.pwndTot),
+                                 fieldHash);
+
+    peer = Pwnagotchi::findPeer(key);
+    bool known = peer != nullptr && peer->fieldHash == fieldHash;
+    if (peer == nullptr) {
+      peer = Pwnagotchi::addPeer(key);
+    }
+
+    peer->beaconHash = beaconHash;
+    peer->fieldHash = fieldHash;
+    Pwnagotchi::seen(peer, packet);
+    if (known) {
+      return;
+    }
+  }
+
+  char addr[] = "00:00:00:00:00:00";
+  getMAC(addr, packet->payload, 10);
+
+  Console.println("(^-^) Pwnagotchi detected!");
+  Console.println(" ");
+  Mood::enter(mood_t::HAPPY, "Pwnagotchi detected!");
+
+  // network related info
+  Console.print("(^-^) RSSI: ");
+  Console.println(packet->rssi);
+  Console.print("(^-^) Channel: ");
+  Console.println(packet->channel);
+  Console.print("(^-^) BSSID: ");
+  Console.println(addr);
+  Console.print("(^-^) ESSID: ");
+  Console.write((const uint8_t *)json, length);
+  Console.println();
+  Console.println(" ");
+
+  if (!parsed) {
+    Pwnagotchi::rememberBad(beaconHash);
+    Console.println(F("(X-X) Could not parse Pwnagotchi json!"));
+    Mood::enter(mood_t::HAPPY, "Could not parse Pwnagotchi json!");
+    Console.println(" ");
+  } else {
+    Console.println("(^-^) Successfully parsed json!");
+    Console.println(" ");
+    Mood::enter(mood_t::HAPPY, "Successfully parsed json!");
+
+    // find out some stats
+    String name = (advert.name[0] != '\0') ? String(advert.name) : "N/A";
+    String pwndTot = advert.hasPwndTot ? String(advert.pwndTot) : "N/A";
+
+    // print the info
+    Console.print("(^-^) Pwnagotchi name: ");
+    Console.println(name);
+    Console.print("(^-^) Pwnagotchi face: ");
+    Console.println((advert.face[0] != '\0') ? advert.face : "N/A");
+    Console.print("(^-^) Pwnagotchi identity: ");
+    Console.println((advert.identity[0] != '\0') ? advert.identity : "N/A");
+    Console.print("(^-^) Pwned Networks: ");
+    Console.println(pwndTot);
+    Console.print(" ");
+
+    // shown on the animation lane so the scan doesn't have to wait for it
+    snprintf(friendName, sizeof(friendName), "Pwnagotchi name: %s",
+             name.c_str());
+    snprintf(friendPwnd, sizeof(friendPwnd), "Pwned Networks: %s",
+             pwndTot.c_str());
+    Scheduler::animate(friendFrames, 2, 1, Config::shortDelay);
+    Parasite::sendPwnagotchiStatus(FRIEND_FOUND, name.c_str());
+  }
+}
+
+/**
+ * Finds a peer we still remember by its identity
+ * @param identity Identity to look for
+ */
+pwnagotchi_peer_t *Pwnagotchi::findPeer(const char *identity) {
+  for (int i = 0; i < Pwnagotchi::peerCount; i++) {
+    pwnagotchi_peer_t *peer = &Pwnagotchi::peers[i];
+    if (Pwnagotchi::alive(peer) && strcmp(peer->identity, identity) == 0) {
+      return peer;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Finds a peer we still remember whose last beacon had this hash
+ * @param hash Hash of the beacon's payload
+ */
+pwnagotchi_peer_t *Pwnagotchi::findBeacon(uint32_t hash) {
+  for (int i = 0; i < Pwnagotchi::peerCount; i++) {
+    pwnagotchi_peer_t *peer = &Pwnagotchi::peers[i];
+    if (Pwnagotchi::alive(peer) && peer->beaconHash == hash) {
+      return peer;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Checks if a beacon is one we already couldn't parse
+ * @param hash Hash of the beacon
+ */
+bool Pwnagotchi::knownBad(uint32_t hash) {
+  for (uint8_t i = 0; i < Pwnagotchi::badUsed; i++) {
+    if (Pwnagotchi::badBeacons[i] == hash) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Remembers a beacon we couldn't parse, pushing out the oldest one if full
+ * @param hash Hash of the beacon
+ */
+void Pwnagotchi::rememberBad(uint32_t hash) {
+  Pwnagotchi::badBeacons[Pwnagotchi::badNext] = hash;
+  Pwnagotchi::badNext = (Pwnagotchi::badNext + 1) % Pwnagotchi::badCount;
+  if (Pwnagotchi::badUsed < Pwnagotchi::badCount) {
+    Pwnagotchi::badUsed++;
+  }
+}
+
+/**
+ * Takes a slot for a new peer, reusing the stalest one if we're full
+ * @param identity Identity of the new peer
+ */
+pwnagotchi_peer_t *Pwnagotchi::addPeer(const char *identity) {
+  pwnagotchi_peer_t *oldest = &Pwnagotchi::peers[0];
+  for (int i = 0; i < Pwnagotchi::peerCount; i++) {
+    pwnagotchi_peer_t *peer = &Pwnagotchi::peers[i];
+    if (!Pwnagotchi::alive(peer)) {
+      oldest = peer;
+      break;
+    }
+    if (millis() - peer->lastSeen > millis() - oldest->lastSeen) {
+      oldest = peer;
+    }
+  }
+
+  memset(oldest, 0, sizeof(*oldest));
+  strncpy(oldest->identity, identity, sizeof(oldest->identity) - 1);
+  return oldest;
+}
+
+/**
+ * Checks if a peer slot is in use and hasn't timed out
+ * @param peer Peer to check
+ */
+bool Pwnagotchi::alive(const pwnagotchi_peer_t *peer) {
+  return peer->beacons > 0 &&
+         millis() - peer->lastSeen < Pwnagotchi::peerTimeout;
+}
+
+/**
+ * Updates a peer's counters with a beacon it sent
+ * @param peer Peer to update
+ * @param packet Beacon it sent
+ */
+void Pwnagotchi::seen(pwnagotchi_peer_t *peer,
+                     const pwnagotchi_packet_t *packet) {
+  // smooth the rssi out a bit, it jumps around a lot
+  if (peer->beacons == 0) {
+    peer->rssi = packet->rssi;
+  } else {
+    peer->rssi += (packet->rssi - peer->rssi) * 0.25f;
+  }
+
+  peer->lastSeen = millis();
+  peer->channel = packet->channel;
+  peer->beacons++;
+  Mood::post(MOOD_EVENT_PEER_SEEN);
+}
+
+/**
+ * Hashes some bytes with FNV-1a
+ * @param data Data to hash
+ * @param length Length of the data
+ * @param seed Hash to continue from, 0 to start a new one
+ */
+uint32_t Pwnagotchi::hash(const void *data, size_t length, uint32_t seed) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  uint32_t hash = (seed == 0) ? 2166136261u : seed;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+/** developer note:
+ *
+ * pwngrid splits its json across vendor elements of up to 255 bytes tagged
+ * 0xDE, and puts a 0xDF element in front when the json is gzipped. that's
+ * why copying everything after the fixed fields as one string doesn't work,
+ * the tag and length bytes end up in the middle of the json.
+ *
+ * so we walk the elements in place, glue the 0xDE ones together in chunks[]
+ * and inflate them into payload[] if needed. the json is then read straight
+ * out of that buffer, only keeping the few fields we actually show.
+ *
+ */
+
+/**
+ * Glues the 0xDE elements of a beacon back together in chunks[], returns
+ * their length or 0 if they're broken
+ * @param packet Beacon to use
+ * @param compressed Set if the chunks still need inflating
+ */
+size_t Pwnagotchi::reassemble(const pwnagotchi_packet_t *packet,
+                              bool *compressed) {
+  // 24 byte header, then timestamp, interval and capabilities
+  size_t pos = 36;
+  size_t length = 0;
+
+  *compressed = false;
+
+  while (pos + 2 <= packet->len) {
+    uint8_t id = packet->payload[pos];
+    uint8_t size = packet->payload[pos + 1];
+    const uint8_t *data = packet->payload + pos + 2;
+
+    if (pos + 2 + size > packet->len) {
+      break;
+    }
+
+    if (id == 0xDE) {
+      if (length + size > sizeof(Pwnagotchi::chunks)) {
+        return 0;
+      }
+      memcpy(Pwnagotchi::chunks + length, data, size);
+      length += size;
+    } else if (id == 0xDF && size > 0) {
+      *compressed = data[0] != 0;
+    }
+
+    pos += 2 + size;
+  }
+
+  return length;
+}
+
+/**
+ * Reads name, pwnd_tot, identity and face out of a pwnagotchi's json
+ * @param json Json to read
+ * @param length Length of the json
+ * @param advert Where to put the fields
+ */
+bool Pwnagotchi::parse(const char *json, size_t length,
+                       pwnagotchi_advert_t *advert) {
+  const char *pos = json;
+  const char *end = json + length;
+
+  memset(advert, 0, sizeof(*advert));
+
+  Pwnagotchi::skipSpace(pos, end);
+  if (pos >= end || *pos != '{') {
+    return false;
+  }
+  pos++;
+
+  Pwnagotchi::skipSpace(pos, end);
+  if (pos < end && *pos == '}') {
+    return true;
+  }
+
+  while (pos < end) {
+    // longer keys than this aren't ones we want anyway
+    char key[16];
+    Pwnagotchi::skipSpace(pos, end);
+    if (!Pwnagotchi::readString(pos, end, key, sizeof(key))) {
+      return false;
+    }
+
+    Pwnagotchi::skipSpace(pos, end);
+    if (pos >= end || *pos != ':') {
+      return false;
+    }
+    pos++;
+    Pwnagotchi::skipSpace(pos, end);
+    if (pos >= end) {
+      return false;
+    }
+
+    bool read = false;
+    if (*pos == '"') {
+      if (strcmp(key, "name") == 0) {
+        read = Pwnagotchi::readString(pos, end, advert->name,
+                                      sizeof(advert->name));
+      } else if (strcmp(key, "identity") == 0) {
+        read = Pwnagotchi::readString(pos, end, advert->identity,
+                                      sizeof(advert->identity));
+      } else if (strcmp(key, "face") == 0) {
+        read = Pwnagotchi::readString(pos, end, advert->face,
+                                      sizeof(advert->face));
+      }
+    } else if (strcmp(key, "pwnd_tot") == 0) {
+      read = Pwnagotchi::readNumber(pos, end, &advert->pwndTot);
+      advert->hasPwndTot = read;
+    }
+
+    // anything else is skipped over without looking at it
+    if (!read && !Pwnagotchi::skipValue(pos, end)) {
+      return false;
+    }
+
+    Pwnagotchi::skipSpace(pos, end);
+    if (pos >= end) {
+      return false;
+    }
+    if (*pos == '}') {
+      return true;
+    }
+    if (*pos != ',') {
+      return false;
+    }
+    pos++;
+  }
+
+  return false;
+}
+
+/**
+ * Skips json whitespace
+ * @param pos Where to start, moved past the whitespace
+ * @param end End of the json
+ */
+void Pwnagotchi::skipSpace(const char *&pos, const char *end) {
+  while (pos < end &&
+         (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r')) {
+    pos++;
+  }
+}
+
+/**
+ * Skips a json value, nested objects and arrays included
+ * @param pos Start of the value, moved past it
+ * @param end End of the json
+ */
+bool Pwnagotchi::skipValue(const char *&pos, const char *end) {
+  int depth = 0;
+
+  do {
+    Pwnagotchi::skipSpace(pos, end);
+    if (pos >= end) {
+      return false;
+    }
+
+    char c = *pos;
+    if (c == '"') {
+      if (!Pwnagotchi::readString(pos, end, nullptr, 0)) {
+        return false;
+      }
+    } else if (c == '{' || c == '[') {
+      depth++;
+      pos++;
+    } else if (c == '}' || c == ']') {
+      if (depth == 0) {
+        return false;
+      }
+      depth--;
+      pos++;
+    } else if (c == ',' || c == ':') {
+      if (depth == 0) {
+        return false;
+      }
+      pos++;
+    } else {
+      // numbers, true, false and null
+      while (pos < end && *pos != ',' && *pos != ':' && *pos != '}' &&
+             *pos != ']' && *pos != ' ' && *pos != '\t' && *pos != '\n' &&
+             *pos != '\r') {
+        pos++;
+      }
+    }
+  } while (depth > 0);
+
+  return true;
+}
+
+/**
+ * Reads a json string, cutting it short if it doesn't fit
+ * @param pos Opening quote of the string, moved past the closing one
+ * @param end End of the json
+ * @param out Where to put the string, can be null to just skip it
+ * @param outSize The size of out
+ */
+bool Pwnagotchi::readString(const char *&pos, const char *end, char *out,
+                            size_t outSize) {
+  if (pos >= end || *pos != '"') {
+    return false;
+  }
+  pos++;
+
+  size_t length = 0;
+  bool truncated = false;
+
+  while (pos < end && *pos != '"') {
+    char encoded[3];
+    size_t count = 1;
+    encoded[0] = *pos++;
+
+    if (encoded[0] == '\\') {
+      if (pos >= end) {
+        return false;
+      }
+
+      char escaped = *pos++;
+      switch (escaped) {
+      case 'b':
+        encoded[0] = '\b';
+        break;
+      case 'f':
+        encoded[0] = '\f';
+        break;
+      case 'n':
+        encoded[0] = '\n';
+        break;
+      case 'r':
+        encoded[0] = '\r';
+        break;
+      case 't':
+        encoded[0] = '\t';
+        break;
+      case 'u': {
+        if (end - pos < 4) {
+          return false;
+        }
+        uint16_t code = 0;
+        for (int i = 0; i < 4; i++) {
+          char hex = *pos++;
+          code <<= 4;
+          if (hex >= '0' && hex <= '9') {
+            code |= hex - '0';
+          } else if (hex >= 'a' && hex <= 'f') {
+            code |= hex - 'a' + 10;
+          } else if (hex >= 'A' && hex <= 'F') {
+            code |= hex - 'A' + 10;
           } else {
-            essid.concat("?");
+            return false;
           }
         }
 
-        // give it a sec
-        // delay(Config::shortDelay);
-
-        // network related info
-        Serial.print("(^-^) RSSI: ");
-        Serial.println(snifferPacket->rx_ctrl.rssi);
-        Serial.print("(^-^) Channel: ");
-        Serial.println(snifferPacket->rx_ctrl.channel);
-        Serial.print("(^-^) BSSID: ");
-        Serial.println(addr);
-        Serial.print("(^-^) ESSID: ");
-        Serial.println(essid);
-        Serial.println(" ");
-
-        // parse the ESSID as JSON
-        DynamicJsonDocument jsonBuffer(2048);
-        DeserializationError error = deserializeJson(jsonBuffer, essid);
-        // delay(Config::shortDelay);
-
-        // check if json parsing is successful
-        if (error) {
-          Serial.println(F("(X-X) Could not parse Pwnagotchi json: "));
-          Serial.print("(X-X) ");
-          Serial.println(error.c_str());
-          Display::updateDisplay("(^-^)", "Could not parse Pwnagotchi json: " +
-                                              (String)error.c_str());
-          Serial.println(" ");
+        // back to utf-8
+        if (code < 0x80) {
+          encoded[0] = code;
+        } else if (code < 0x800) {
+          encoded[0] = 0xC0 | (code >> 6);
+          encoded[1] = 0x80 | (code & 0x3F);
+          count = 2;
         } else {
-          Serial.println("(^-^) Successfully parsed json!");
-          Serial.println(" ");
-          Display::updateDisplay("(^-^)", "Successfully parsed json!");
-          // find out some stats
-          String name = jsonBuffer["name"].as<String>();
-          delay(Config::shortDelay);
-          String pwndTot = jsonBuffer["pwnd_tot"].as<String>();
-          delay(Config::shortDelay);
-
-          if (name == "null") {
-            name = "N/A";
-          }
+          encoded[0] = 0xE0 | (code >> 12);
+          encoded[1] = 0x80 | ((code >> 6) & 0x3F);
+          encoded[2] = 0x80 | (code & 0x3F);
+          count = 3;
+        }
+        break;
+      }
+      default:
+        // \" \\ and \/
+        encoded[0] = escaped;
+        break;
+      }
+    }
 
-          if (pwndTot == "null") {
-            pwndTot = "N/A";
-          }
+    if (out == nullptr || truncated) {
+      continue;
+    }
+    if (length + count >= outSize) {
+      truncated = true;
+      continue;
+    }
+    memcpy(out + length, encoded, count);
+    length += count;
+  }
+
+  if (pos >= end) {
+    return false;
+  }
+  pos++;
 
-          // print the info
-          Serial.print("(^-^) Pwnagotchi name: ");
-          Serial.println(name);
-          Serial.print("(^-^) Pwned Networks: ");
-          Serial.println(pwndTot);
-          Serial.print(" ");
-          Display::updateDisplay("(^-^)", "Pwnagotchi name: " + (String)name);
-          delay(Config::shortDelay);
-          Display::updateDisplay("(^-^)", "Pwned Networks: " + (String)pwndTot);
-          delay(Config::shortDelay);
-          Parasite::sendPwnagotchiStatus(FRIEND_FOUND, name.c_str());
+  if (out != nullptr) {
+    // don't leave half a utf-8 character at the end
+    if (truncated) {
+      size_t lead = length;
+      while (lead > 0 && ((uint8_t)out[lead - 1] & 0xC0) == 0x80) {
+        lead--;
+      }
+      if (lead > 0 && (uint8_t)out[lead - 1] >= 0xC0) {
+        uint8_t first = out[lead - 1];
+        size_t size = (first >= 0xF0) ? 4 : (first >= 0xE0) ? 3 : 2;
+        if (lead - 1 + size > length) {
+          length = lead - 1;
         }
       }
     }
+    out[length] = '\0';
+  }
+
+  return true;
+}
+
+/**
+ * Reads a json number, dropping any fraction or exponent
+ * @param pos Start of the number, moved past it
+ * @param end End of the json
+ * @param value Where to put the number
+ */
+bool Pwnagotchi::readNumber(const char *&pos, const char *end, long *value) {
+  bool negative = false;
+  if (pos < end && *pos == '-') {
+    negative = true;
+    pos++;
   }
+
+  if (pos >= end || *pos < '0' || *pos > '9') {
+    return false;
+  }
+
+  long number = 0;
+  while (pos < end && *pos >= '0' && *pos <= '9') {
+    if (number < LONG_MAX / 10) {
+      number = number * 10 + (*pos - '0');
+    }
+    pos++;
+  }
+
+  // a pwnd count should never have these, but skip them if it does
+  while (pos < end && ((*pos >= '0' && *pos <= '9') || *pos == '.' ||
+                       *pos == 'e' || *pos == 'E' || *pos == '+' ||
+                       *pos == '-')) {
+    pos++;
+  }
+
+  *value = negative ? -number : number;
+  return true;
 }
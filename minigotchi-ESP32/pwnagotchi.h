@@ -23,30 +23,129 @@
 #ifndef PWNAGOTCHI_H
 #define PWNAGOTCHI_H
 
+#include "capture.h"
+#include "compression.h"
 #include "config.h"
+#include "console.h"
 #include "frame.h"
 #include "minigotchi.h"
 #include "parasite.h"
+#include "radio.h"
+#include "scheduler.h"
 #include <Arduino.h>
-#include <ArduinoJson.h>
-#include <WiFi.h>
+#include <atomic>
 #include <esp_wifi.h>
 #include <esp_wifi_types.h>
+#include <limits.h>
 #include <stdint.h>
 #include <string>
 
+// largest 802.11 frame we'll copy out of the callback
+#define PWNAGOTCHI_SLOT_SIZE 1500
+
+// a beacon copied out of the promiscuous callback
+typedef struct {
+  uint16_t len;
+  int8_t rssi;
+  uint8_t channel;
+  uint8_t payload[PWNAGOTCHI_SLOT_SIZE];
+} pwnagotchi_packet_t;
+
+// largest json we'll inflate out of a compressed beacon
+#define PWNAGOTCHI_PAYLOAD_SIZE 2048
+
+// the only fields we read out of a pwnagotchi's json
+typedef struct {
+  char name[33];
+  char identity[65];
+  char face[33];
+  long pwndTot;
+  bool hasPwndTot;
+} pwnagotchi_advert_t;
+
+// a pwnagotchi we've heard from, keyed by its identity
+typedef struct {
+  char identity[65];
+  unsigned long lastSeen;
+  uint8_t channel;
+  float rssi;
+  uint32_t beacons;
+  uint32_t beaconHash;
+  uint32_t fieldHash;
+} pwnagotchi_peer_t;
+
+// where detect() is at
+typedef enum { DETECT_START = 0, DETECT_LISTEN } pwnagotchi_detect_state_t;
+
 class Pwnagotchi {
 public:
-  static void detect();
+  static unsigned long detect();
   static void pwnagotchiCallback(void *buf, wifi_promiscuous_pkt_type_t type);
   static void stopCallback();
+  static void process();
+  static void reset();
+  static int heard();
+
+  // must be a power of two
+  static const uint32_t slotCount = 8;
+
+  // how many pwnagotchi we remember, and for how long
+  static const uint8_t peerCount = 16;
+  static const unsigned long peerTimeout = 300000;
+
+  // how many beacons we couldn't parse we remember, so they're not redone
+  static const uint8_t badCount = 8;
 
 private:
   static std::string extractMAC(const unsigned char *buff);
   static void getMAC(char *addr, const unsigned char *buff, int offset);
-  static std::string essid;
+  static void handle(const pwnagotchi_packet_t *packet);
+  static bool isPwnagotchi(const uint8_t *frame, int len);
+  static size_t reassemble(const pwnagotchi_packet_t *packet,
+                           bool *compressed);
+  static bool parse(const char *json, size_t length,
+                    pwnagotchi_advert_t *advert);
+  static void skipSpace(const char *&pos, const char *end);
+  static bool skipValue(const char *&pos, const char *end);
+  static bool readString(const char *&pos, const char *end, char *out,
+                         size_t outSize);
+  static bool readNumber(const char *&pos, const char *end, long *value);
+  static pwnagotchi_peer_t *findPeer(const char *identity);
+  static pwnagotchi_peer_t *findBeacon(uint32_t hash);
+  static pwnagotchi_peer_t *addPeer(const char *identity);
+  static bool knownBad(uint32_t hash);
+  static void rememberBad(uint32_t hash);
+  static bool alive(const pwnagotchi_peer_t *peer);
+  static void seen(pwnagotchi_peer_t *peer,
+                   const pwnagotchi_packet_t *packet);
+  static uint32_t hash(const void *data, size_t length, uint32_t seed);
   static bool pwnagotchiDetected;
 
+  // everyone we've heard from lately
+  static pwnagotchi_peer_t peers[];
+
+  // hashes of the last few beacons that didn't parse
+  static uint32_t badBeacons[];
+  static uint8_t badUsed;
+  static uint8_t badNext;
+  static unsigned long scanStart;
+  static unsigned long scanLength;
+  static pwnagotchi_detect_state_t state;
+
+  // 0xDE chunks glued back together, and the json if they were compressed
+  static uint8_t chunks[];
+  static uint8_t payload[];
+
+  // single producer (wifi task), single consumer (us) ring of beacons
+  static pwnagotchi_packet_t ring[];
+  static std::atomic<uint32_t> ringHead;
+  static std::atomic<uint32_t> ringTail;
+  static volatile uint32_t dropped;
+
+  // Frame::SignatureAddr split into words, see isPwnagotchi()
+  static uint16_t signatureLow;
+  static uint32_t signatureHigh;
+
   // source:
   // https://github.com/justcallmekoko/ESP32Marauder/blob/c0554b95ceb379d29b9a8925d27cc2c0377764a9/esp32_marauder/WiFiScan.h#L213
   typedef struct {
@@ -0,0 +1,181 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * radio.cpp: the only place that talks to the wifi driver
+ */
+
+#include "radio.h"
+#include "capture.h"
+#include "config.h"
+#include "mood.h"
+#include <WiFi.h>
+
+/** developer note:
+ *
+ * everything else goes through here instead of calling esp_wifi or the
+ * arduino WiFi class directly, so bringing the driver up, switching modes,
+ * sending frames, hopping channels, sniffing and scanning for access points
+ * all have one seam. the host build in ../host swaps this file out for a
+ * simulated radio, and since the host headers don't declare any driver
+ * calls, anything that sneaks one in somewhere else won't build there.
+ *
+ */
+
+static_assert(Radio::scanRunning == WIFI_SCAN_RUNNING,
+              "Radio::scanRunning has to match the WiFi library");
+static_assert(Radio::scanFailed == WIFI_SCAN_FAILED,
+              "Radio::scanFailed has to match the WiFi library");
+
+const int Radio::scanRunning;
+const int Radio::scanFailed;
+
+/**
+ * Brings the wifi driver up in station mode, keeping its settings in RAM
+ */
+void Radio::begin() {
+  ESP_ERROR_CHECK(esp_wifi_init(&Config::config));
+  ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
+  ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+  ESP_ERROR_CHECK(esp_wifi_start());
+}
+
+/**
+ * Switches between station and access point mode
+ * @param mode Mode to switch to
+ */
+void Radio::mode(wifi_mode_t mode) { WiFi.mode(mode); }
+
+/**
+ * Drops whatever network we might be connected to
+ */
+void Radio::disconnect() { WiFi.disconnect(); }
+
+/**
+ * Sends a raw 802.11 frame, returns whether the driver took it
+ * @param interface Interface to send on
+ * @param frame Frame to send
+ * @param length Length of frame
+ * @param sysSeq Let the driver fill in the sequence number
+ */
+bool Radio::send(wifi_interface_t interface, const uint8_t *frame,
+                 uint16_t length, bool sysSeq) {
+  esp_err_t err = esp_wifi_80211_tx(interface, frame, length, sysSeq);
+  if (err != ESP_OK) {
+    Mood::post(MOOD_EVENT_TX_FAILURE);
+    return false;
+  }
+
+  // asking the driver for the channel isn't free, only do it to record
+  if (Config::capture) {
+    Capture::sent(frame, length, Radio::getChannel());
+  }
+  return true;
+}
+
+/**
+ * Tunes to a channel, returns whether it worked
+ * @param channel Channel to tune to
+ */
+bool Radio::setChannel(uint8_t channel) {
+  return esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE) == ESP_OK;
+}
+
+/**
+ * Returns the channel we're tuned to
+ */
+uint8_t Radio::getChannel() {
+  uint8_t primary;
+  wifi_second_chan_t second;
+  esp_wifi_get_channel(&primary, &second);
+  return primary;
+}
+
+/**
+ * Checks if we're in promiscuous mode
+ */
+bool Radio::promiscuous() {
+  bool enabled = false;
+  esp_wifi_get_promiscuous(&enabled);
+  return enabled;
+}
+
+/**
+ * Turns promiscuous mode on or off
+ * @param enable Whether to sniff
+ */
+void Radio::promiscuous(bool enable) { esp_wifi_set_promiscuous(enable); }
+
+/**
+ * Sets what gets every sniffed frame, nullptr stops it
+ * @param callback Callback to hand frames to
+ */
+void Radio::listen(wifi_promiscuous_cb_t callback) {
+  esp_wifi_set_promiscuous_rx_cb(callback);
+}
+
+/**
+ * Starts looking for access points in the background
+ * @param channel Channel to look on, 0 for all of them
+ */
+void Radio::scan(uint8_t channel) {
+  WiFi.scanNetworks(true, false, false, 300, channel);
+}
+
+/**
+ * Returns how many access points the last scan found, or scanRunning and
+ * scanFailed
+ */
+int Radio::scanComplete() { return WiFi.scanComplete(); }
+
+/**
+ * Returns the SSID of an access point from the last scan
+ * @param index Index of the access point
+ */
+String Radio::scanSSID(int index) { return WiFi.SSID(index); }
+
+/**
+ * Returns the BSSID of an access point from the last scan
+ * @param index Index of the access point
+ */
+const uint8_t *Radio::scanBSSID(int index) { return WiFi.BSSID(index); }
+
+/**
+ * Returns the encryption of an access point from the last scan
+ * @param index Index of the access point
+ */
+wifi_auth_mode_t Radio::scanEncryption(int index) {
+  return WiFi.encryptionType(index);
+}
+
+/**
+ * Returns the RSSI of an access point from the last scan
+ * @param index Index of the access point
+ */
+int Radio::scanRSSI(int index) { return WiFi.RSSI(index); }
+
+/**
+ * Returns the channel of an access point from the last scan
+ * @param index Index of the access point
+ */
+int Radio::scanChannel(int index) { return WiFi.channel(index); }
+
+/**
+ * Returns how many stations are connected to our access point
+ */
+int Radio::stations() { return WiFi.softAPgetStationNum(); }
@@ -0,0 +1,56 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * radio.h: header files for radio.cpp
+ */
+
+#ifndef RADIO_H
+#define RADIO_H
+
+#include <Arduino.h>
+#include <esp_wifi.h>
+#include <esp_wifi_types.h>
+#include <stdint.h>
+
+class Radio {
+public:
+  static const int scanRunning = -1;
+  static const int scanFailed = -2;
+
+  static void begin();
+  static void mode(wifi_mode_t mode);
+  static void disconnect();
+  static bool send(wifi_interface_t interface, const uint8_t *frame,
+                   uint16_t length, bool sysSeq);
+  static bool setChannel(uint8_t channel);
+  static uint8_t getChannel();
+  static bool promiscuous();
+  static void promiscuous(bool enable);
+  static void listen(wifi_promiscuous_cb_t callback);
+  static void scan(uint8_t channel);
+  static int scanComplete();
+  static String scanSSID(int index);
+  static const uint8_t *scanBSSID(int index);
+  static wifi_auth_mode_t scanEncryption(int index);
+  static int scanRSSI(int index);
+  static int scanChannel(int index);
+  static int stations();
+};
+
+#endif // RADIO_H
@@ -0,0 +1,273 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * scheduler.cpp: runs the minigotchi's phases without blocking
+ */
+
+#include "scheduler.h"
+#include "capture.h"
+#include "parasite.h"
+
+/** developer note:
+ *
+ * the minigotchi used to go through cycle, detect, advertise and deauth one
+ * after the other, and each of them spent most of its time in delay() for
+ * animations or waiting between frames. an epoch took ages and the cpu did
+ * nothing for most of it.
+ *
+ * now every phase is a little state machine. each call to its step does a
+ * bit of work and returns how long until it wants to be called again, or
+ * Scheduler::done when it's finished and the next phase can go. animations
+ * run on their own timer next to the phase, so e.g. the scanning faces keep
+ * going while the radio is listening for a pwnagotchi.
+ *
+ * that only works as long as no step calls delay(). anything on screen that
+ * needs pacing goes through animate() instead, delay() is for boot only.
+ *
+ * when nothing is due tick() sleeps until something is, and that time is
+ * counted as idle. other tasks can cut that sleep short with wake(), e.g.
+ * when the pwnagotchi sends us something over serial. at the end of every
+ * epoch we print how long it took and how much of it was idle.
+ *
+ */
+
+const unsigned long Scheduler::done;
+const unsigned long Scheduler::gap;
+const uint8_t Scheduler::maxPhases;
+
+scheduler_phase_t Scheduler::phases[Scheduler::maxPhases];
+uint8_t Scheduler::phaseCount = 0;
+uint8_t Scheduler::current = 0;
+unsigned long Scheduler::phaseDue = 0;
+
+const scheduler_frame_t *Scheduler::frames = nullptr;
+uint8_t Scheduler::frameCount = 0;
+uint8_t Scheduler::frameIndex = 0;
+uint8_t Scheduler::repeats = 0;
+unsigned long Scheduler::frameInterval = 0;
+unsigned long Scheduler::frameDue = 0;
+
+bool Scheduler::started = false;
+unsigned long Scheduler::epochStart = 0;
+unsigned long Scheduler::idle = 0;
+TaskHandle_t Scheduler::task = nullptr;
+bool Scheduler::reminding = false;
+unsigned long Scheduler::reminder = 0;
+
+/**
+ * Adds a phase to run every epoch, phases run in the order they're added
+ * @param name Name of the phase
+ * @param step Step function of the phase
+ */
+void Scheduler::add(const char *name, scheduler_step_t step) {
+  if (Scheduler::phaseCount >= Scheduler::maxPhases) {
+    Console.print("(X-X) Too many phases, not adding ");
+    Console.println(name);
+    return;
+  }
+
+  scheduler_phase_t *phase = &Scheduler::phases[Scheduler::phaseCount++];
+  phase->name = name;
+  phase->step = step;
+  phase->busy = 0;
+}
+
+/**
+ * Starts an animation, replacing whatever was playing
+ * @param frames Frames to show, must stay around until it's done
+ * @param count Number of frames
+ * @param repeat How many times to play the frames
+ * @param interval How long to show each frame in milliseconds
+ */
+void Scheduler::animate(const scheduler_frame_t *frames, uint8_t count,
+                        uint8_t repeat, unsigned long interval) {
+  if (count == 0 || repeat == 0) {
+    Scheduler::stopAnimation();
+    return;
+  }
+
+  Scheduler::frames = frames;
+  Scheduler::frameCount = count;
+  Scheduler::frameIndex = 0;
+  Scheduler::repeats = repeat;
+  Scheduler::frameInterval = interval;
+  Scheduler::frameDue = millis();
+}
+
+/**
+ * Stops the current animation
+ */
+void Scheduler::stopAnimation() { Scheduler::frames = nullptr; }
+
+/**
+ * Checks if an animation is still playing
+ */
+bool Scheduler::animating() { return Scheduler::frames != nullptr; }
+
+/**
+ * Checks if an animation is still playing these frames
+ * @param frames Frames to check for
+ */
+bool Scheduler::playing(const scheduler_frame_t *frames) {
+  return Scheduler::frames == frames;
+}
+
+/**
+ * Runs whatever is due, then sleeps until the next thing is
+ */
+void Scheduler::tick() {
+  if (Scheduler::phaseCount == 0) {
+    return;
+  }
+
+  if (!Scheduler::started) {
+    Scheduler::started = true;
+    Scheduler::task = xTaskGetCurrentTaskHandle();
+    Scheduler::epochStart = millis();
+    Scheduler::phaseDue = millis();
+  }
+
+  if (Scheduler::animating() && Scheduler::due(Scheduler::frameDue)) {
+    Scheduler::showFrame();
+  }
+
+  if (Scheduler::due(Scheduler::phaseDue)) {
+    scheduler_phase_t *phase = &Scheduler::phases[Scheduler::current];
+    unsigned long start = millis();
+    unsigned long wait = phase->step();
+    phase->busy += millis() - start;
+
+    if (wait == Scheduler::done) {
+      Scheduler::phaseDue = millis() + Scheduler::gap;
+      if (++Scheduler::current == Scheduler::phaseCount) {
+        Mood::post(MOOD_EVENT_EPOCH);
+        Scheduler::report();
+        Scheduler::current = 0;
+      }
+    } else {
+      Scheduler::phaseDue = millis() + wait;
+    }
+  }
+
+  // sleep until whichever comes first
+  unsigned long next = Scheduler::phaseDue;
+  if (Scheduler::animating() &&
+      (long)(Scheduler::frameDue - Scheduler::phaseDue) < 0) {
+    next = Scheduler::frameDue;
+  }
+
+  // come straight back if a reminder is due, so whoever asked can run
+  if (Scheduler::reminding) {
+    if (Scheduler::due(Scheduler::reminder)) {
+      Scheduler::reminding = false;
+      return;
+    }
+    if ((long)(Scheduler::reminder - next) < 0) {
+      next = Scheduler::reminder;
+    }
+  }
+
+  long sleep = (long)(next - millis());
+  if (sleep > 0) {
+    unsigned long start = millis();
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleep));
+    Scheduler::idle += millis() - start;
+  }
+}
+
+/**
+ * Makes sure tick() doesn't sleep past a time, for things that run between
+ * ticks instead of in a phase
+ * @param when Time in milliseconds
+ */
+void Scheduler::remind(unsigned long when) {
+  if (!Scheduler::reminding || (long)(when - Scheduler::reminder) < 0) {
+    Scheduler::reminder = when;
+    Scheduler::reminding = true;
+  }
+}
+
+/**
+ * Wakes tick() up early if it's sleeping, safe to call from other tasks
+ */
+void Scheduler::wake() {
+  if (Scheduler::task != nullptr) {
+    xTaskNotifyGive(Scheduler::task);
+  }
+}
+
+/**
+ * Checks if a time has come yet
+ * @param when Time to check in milliseconds
+ */
+bool Scheduler::due(unsigned long when) { return (long)(millis() - when) >= 0; }
+
+/**
+ * Shows the next frame of the animation
+ */
+void Scheduler::showFrame() {
+  const scheduler_frame_t *frame = &Scheduler::frames[Scheduler::frameIndex];
+  if (frame->serial != nullptr) {
+    Console.println(frame->serial);
+  }
+  if (frame->text != nullptr) {
+    Mood::enter(frame->mood, frame->text);
+  }
+
+  if (++Scheduler::frameIndex == Scheduler::frameCount) {
+    Scheduler::frameIndex = 0;
+    if (--Scheduler::repeats == 0) {
+      Scheduler::stopAnimation();
+    }
+  }
+
+  Scheduler::frameDue += Scheduler::frameInterval;
+}
+
+/**
+ * Prints how long the last epoch took and how much of it was idle
+ */
+void Scheduler::report() {
+  unsigned long length = millis() - Scheduler::epochStart;
+
+  Console.print("('-') Epoch took ");
+  Console.print(length);
+  Console.print(" ms, ");
+  Console.print(Scheduler::idle);
+  Console.print(" ms (");
+  Console.print(length > 0 ? Scheduler::idle * 100 / length : 0);
+  Console.println("%) idle");
+
+  for (uint8_t i = 0; i < Scheduler::phaseCount; i++) {
+    Console.print("('-') ");
+    Console.print(Scheduler::phases[i].name);
+    Console.print(": ");
+    Console.print(Scheduler::phases[i].busy);
+    Console.println(" ms busy");
+    Scheduler::phases[i].busy = 0;
+  }
+
+  Parasite::printTelemetry();
+  Display::printTiming();
+  Capture::report();
+  Console.println(" ");
+
+  Scheduler::epochStart = millis();
+  Scheduler::idle = 0;
+}
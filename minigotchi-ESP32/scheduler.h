@@ -0,0 +1,101 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * scheduler.h: header files for scheduler.cpp
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "console.h"
+#include "display.h"
+#include "mood.h"
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <limits.h>
+#include <stdint.h>
+
+// runs a bit of a phase, returns how long until it wants to run again
+typedef unsigned long (*scheduler_step_t)();
+
+// one of the things we do every epoch
+typedef struct {
+  const char *name;
+  scheduler_step_t step;
+  unsigned long busy;
+} scheduler_phase_t;
+
+// one frame of an animation, a null text only prints the serial line and a
+// null serial only shows the text
+typedef struct {
+  mood_t mood;
+  const char *text;
+  const char *serial;
+} scheduler_frame_t;
+
+class Scheduler {
+public:
+  static void add(const char *name, scheduler_step_t step);
+  static void animate(const scheduler_frame_t *frames, uint8_t count,
+                      uint8_t repeat, unsigned long interval);
+  static void stopAnimation();
+  static bool animating();
+  static bool playing(const scheduler_frame_t *frames);
+  static void tick();
+  static void wake();
+  static void remind(unsigned long when);
+
+  // returned by a step when its phase is finished
+  static const unsigned long done = ULONG_MAX;
+
+  // how long to wait between phases
+  static const unsigned long gap = 250;
+
+private:
+  static bool due(unsigned long when);
+  static void showFrame();
+  static void report();
+
+  static const uint8_t maxPhases = 8;
+  static scheduler_phase_t phases[];
+  static uint8_t phaseCount;
+  static uint8_t current;
+  static unsigned long phaseDue;
+
+  static const scheduler_frame_t *frames;
+  static uint8_t frameCount;
+  static uint8_t frameIndex;
+  static uint8_t repeats;
+  static unsigned long frameInterval;
+  static unsigned long frameDue;
+
+  static bool started;
+  static unsigned long epochStart;
+  static unsigned long idle;
+
+  // something outside the phases that wants tick() to come back by then
+  static bool reminding;
+  static unsigned long reminder;
+
+  // the task tick() runs on, so wake() knows who to poke
+  static TaskHandle_t task;
+};
+
+#endif // SCHEDULER_H
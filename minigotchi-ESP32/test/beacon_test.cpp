@@ -0,0 +1,440 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * beacon_test.cpp: patched beacons against ones packed from scratch, and
+ * against the ArduinoJson beacon they replaced
+ */
+
+#include "../beacon.h"
+#include "../compression.h"
+#include "test.h"
+#include <ArduinoJson.h>
+#include <chrono>
+#include <new>
+#include <random>
+#include <stdlib.h>
+
+static std::mt19937 generator(2);
+
+// every allocation the test makes, to check building a beacon doesn't
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+  allocations++;
+  void *memory = malloc(size > 0 ? size : 1);
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void operator delete(void *memory) noexcept { free(memory); }
+
+/**
+ * Makes up a face, with the odd character that needs escaping
+ * @param length How long
+ */
+static std::string face(size_t length) {
+  static const char odd[] = {'"', '\\', '\n', '\r', '\t', 0x01, 0x1f};
+  std::string value;
+  for (size_t i = 0; i < length; i++) {
+    if (generator() % 8 == 0) {
+      value += odd[generator() % sizeof(odd)];
+    } else {
+      value += (char)(0x20 + generator() % 0x5f);
+    }
+  }
+  return value;
+}
+
+/**
+ * Picks a number, mostly one that keeps its width
+ * @param value Current value
+ */
+static int nudge(int value) {
+  switch (generator() % 4) {
+  case 0:
+    return value + 1;
+  case 1:
+    return value * 10 + 7;
+  case 2:
+    return -value;
+  default:
+    return generator() % 100000;
+  }
+}
+
+/**
+ * Escapes a string the way json wants it
+ * @param value String to escape
+ */
+static std::string quote(const std::string &value) {
+  std::string quoted = "\"";
+  for (char c : value) {
+    char hex[7];
+    switch (c) {
+    case '"':
+      quoted += "\\\"";
+      break;
+    case '\\':
+      quoted += "\\\\";
+      break;
+    case '\n':
+      quoted += "\\n";
+      break;
+    case '\r':
+      quoted += "\\r";
+      break;
+    case '\t':
+      quoted += "\\t";
+      break;
+    default:
+      if ((uint8_t)c < 0x20) {
+        snprintf(hex, sizeof(hex), "\\u%04x", (uint8_t)c);
+        quoted += hex;
+      } else {
+        quoted += c;
+      }
+    }
+  }
+  return quoted + "\"";
+}
+
+/**
+ * Pulls the json back out of a beacon, inflating it if needed
+ * @param span Packed beacon
+ */
+static std::string unpack(beacon_span_t span) {
+  std::vector<uint8_t> body;
+  bool compressed = false;
+  size_t i = sizeof(Frame::header);
+  while (i + 2 <= span.length) {
+    uint8_t id = span.data[i];
+    uint8_t length = span.data[i + 1];
+    if (id == Frame::IDWhisperCompression) {
+      compressed = true;
+    } else {
+      CHECK(id == Frame::IDWhisperPayload);
+      body.insert(body.end(), span.data + i + 2, span.data + i + 2 + length);
+    }
+    i += 2 + length;
+  }
+  CHECK(i == span.length);
+
+  if (!compressed) {
+    return std::string(body.begin(), body.end());
+  }
+
+  char json[BeaconBuilder::maxPayloadSize];
+  size_t length = Compression::decompress(body.data(), body.size(),
+                                          (uint8_t *)json, sizeof(json));
+  CHECK(length > 0);
+  return std::string(json, length);
+}
+
+/**
+ * Checks the dynamic fields made it into the json as they are now
+ * @param json Unpacked payload
+ */
+static void checkFields(const std::string &json) {
+  CHECK(json.compare(0, 9, "{\"epoch\":") == 0);
+  CHECK(json.find("\"epoch\":" + std::to_string(Config::epoch) + ",") !=
+        std::string::npos);
+  CHECK(json.find("\"face\":" + quote(Config::face) + ",") !=
+        std::string::npos);
+  CHECK(json.find("\"pwnd_run\":" + std::to_string(Config::pwnd_run) + ",") !=
+        std::string::npos);
+  CHECK(json.find("\"pwnd_tot\":" + std::to_string(Config::pwnd_tot) + ",") !=
+        std::string::npos);
+  CHECK(json.find("\"uptime\":" + std::to_string(Config::uptime) + ",") !=
+        std::string::npos);
+  CHECK(json.back() == '}');
+}
+
+/**
+ * Changes a few fields at a time for 5000 rounds, and checks the beacon we
+ * keep patching comes out byte for byte the same as a fresh one
+ * @param compression Whether to gzip the payload
+ */
+static void testPatching(bool compression) {
+  Config::compression = compression;
+  Config::epoch = 1;
+  Config::face = "(^-^)";
+  Config::pwnd_run = 0;
+  Config::pwnd_tot = 9;
+  Config::uptime = 0;
+
+  static uint8_t patchedFrame[BeaconBuilder::maxFrameSize];
+  BeaconBuilder patched(patchedFrame);
+  int failures = 0;
+
+  for (int i = 0; i < 5000; i++) {
+    uint32_t changes = generator();
+    if (changes & 1) {
+      Config::epoch = nudge(Config::epoch);
+    }
+    if (changes & 2) {
+      // same width most of the time, too wide to patch now and then
+      size_t length = Config::face.length();
+      if (generator() % 4 == 0 || length > 80) {
+        length = generator() % 80;
+      }
+      Config::face = face(length);
+    }
+    if (changes & 4) {
+      Config::pwnd_run = nudge(Config::pwnd_run);
+    }
+    if (changes & 8) {
+      Config::pwnd_tot = nudge(Config::pwnd_tot);
+    }
+    if (changes & 16) {
+      Config::uptime += generator() % 120;
+    }
+    if (i % 500 == 499) {
+      // way too big for four chunks, it should give up and then recover
+      Config::face = face(BeaconBuilder::maxPayloadSize);
+    }
+
+    beacon_span_t span = patched.build();
+    CHECK(!patched.stale() || span.length == 0);
+
+    static uint8_t freshFrame[BeaconBuilder::maxFrameSize];
+    BeaconBuilder fresh(freshFrame);
+    beacon_span_t expected = fresh.build();
+
+    CHECK(span.length == expected.length);
+    if (span.length != expected.length) {
+      continue;
+    }
+    if (span.length == 0) {
+      failures++;
+      continue;
+    }
+
+    CHECK(memcmp(span.data, expected.data, span.length) == 0);
+    CHECK(span.length <= BeaconBuilder::maxFrameSize);
+    CHECK(memcmp(span.data, Frame::header, sizeof(Frame::header)) == 0);
+    checkFields(unpack(span));
+
+    // nothing changed, nothing gets repacked
+    beacon_span_t again = patched.build();
+    CHECK(again.data == span.data && again.length == span.length);
+  }
+
+  // the oversized faces are the only ones that shouldn't fit, and they
+  // stick around until the face gets changed again
+  CHECK(failures >= 10 && failures < 100);
+}
+
+/**
+ * Packing, patching and checking the beacon never touch the heap, even with
+ * a face too long for std::string to keep inline
+ * @param compression Whether to gzip the payload
+ */
+static void testNoHeap(bool compression) {
+  Config::compression = compression;
+  Config::face = face(40);
+  static uint8_t frame[BeaconBuilder::maxFrameSize];
+  BeaconBuilder builder(frame);
+
+  std::string faces[2] = {face(40), face(60)};
+  size_t before = allocations;
+  CHECK(builder.build().length > 0);
+  for (int i = 0; i < 100; i++) {
+    Config::epoch++;
+    Config::uptime += 60;
+    Config::face.swap(faces[i % 2]);
+    CHECK(builder.stale());
+    CHECK(builder.build().length > 0);
+    CHECK(!builder.stale());
+  }
+  CHECK(allocations == before);
+}
+
+/**
+ * Frame::pack() as it was before BeaconBuilder, kept word for word except
+ * for the size globals, which are handed back instead, and an unsigned i
+ * @param frameSize Set to how long the beacon is
+ */
+static uint8_t *legacyPack(size_t *frameSize) {
+  // make a json doc
+  String jsonString = "";
+  DynamicJsonDocument doc(2048);
+
+  doc["epoch"] = Config::epoch;
+  doc["face"] = Config::face;
+  doc["identity"] = Config::identity;
+  doc["name"] = Config::name;
+
+  doc["policy"]["advertise"] = Config::advertise;
+  doc["policy"]["ap_ttl"] = Config::ap_ttl;
+  doc["policy"]["associate"] = Config::associate;
+  doc["policy"]["bored_num_epochs"] = Config::bored_num_epochs;
+
+  doc["policy"]["deauth"] = Config::deauth;
+  doc["policy"]["excited_num_epochs"] = Config::excited_num_epochs;
+  doc["policy"]["hop_recon_time"] = Config::hop_recon_time;
+  doc["policy"]["max_inactive_scale"] = Config::max_inactive_scale;
+  doc["policy"]["max_interactions"] = Config::max_interactions;
+  doc["policy"]["max_misses_for_recon"] = Config::max_misses_for_recon;
+  doc["policy"]["min_recon_time"] = Config::min_rssi;
+  doc["policy"]["min_rssi"] = Config::min_rssi;
+  doc["policy"]["recon_inactive_multiplier"] =
+      Config::recon_inactive_multiplier;
+  doc["policy"]["recon_time"] = Config::recon_time;
+  doc["policy"]["sad_num_epochs"] = Config::sad_num_epochs;
+  doc["policy"]["sta_ttl"] = Config::sta_ttl;
+
+  doc["pwnd_run"] = Config::pwnd_run;
+  doc["pwnd_tot"] = Config::pwnd_tot;
+  doc["session_id"] = Config::session_id;
+  doc["uptime"] = Config::uptime;
+  doc["version"] = Config::version;
+
+  // serialize then put into beacon frame
+  serializeJson(doc, jsonString);
+  size_t essidLength = measureJson(doc);
+  uint8_t headerLength = 2 + ((uint8_t)(essidLength / 255) * 2);
+  *frameSize = sizeof(Frame::header) + essidLength + headerLength;
+  uint8_t *beaconFrame = new uint8_t[*frameSize];
+  memcpy(beaconFrame, Frame::header, sizeof(Frame::header));
+
+  int frameByte = sizeof(Frame::header);
+  for (size_t i = 0; i < essidLength; i++) {
+    if (i == 0 || i % 255 == 0) {
+      beaconFrame[frameByte++] = Frame::IDWhisperPayload;
+      uint8_t newPayloadLength = 255;
+      if (essidLength - i < Frame::chunkSize) {
+        newPayloadLength = essidLength - i;
+      }
+      beaconFrame[frameByte++] = newPayloadLength;
+    }
+    beaconFrame[frameByte++] = (uint8_t)jsonString[i];
+  }
+
+  return beaconFrame;
+}
+
+// what changes between two beacons in the benchmark
+typedef enum {
+  BENCH_LEGACY = 0,
+  BENCH_SAME_WIDTH,
+  BENCH_NEW_WIDTH,
+  BENCH_REPACK,
+  BENCH_CASES
+} bench_case_t;
+
+/**
+ * Times packing a beacon a number of times, in microseconds each
+ * @param which What changes in between, and how it gets packed
+ */
+static double timeBeacons(bench_case_t which) {
+  const int rounds = 20000;
+  Config::epoch = 10000;
+  Config::uptime = 100000;
+
+  static uint8_t frame[BeaconBuilder::maxFrameSize];
+  BeaconBuilder builder(frame);
+  builder.build();
+  size_t bytes = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++) {
+    if (which == BENCH_NEW_WIDTH) {
+      // 99 and 100 take turns, so every patch moves everything after it
+      Config::epoch = i % 2 == 0 ? 100 : 99;
+    } else {
+      Config::epoch = 10000 + i % 90000;
+    }
+    Config::uptime = 100000 + i % 900000;
+
+    if (which == BENCH_LEGACY) {
+      size_t frameSize;
+      uint8_t *legacy = legacyPack(&frameSize);
+      bytes += frameSize;
+      delete[] legacy;
+    } else if (which == BENCH_REPACK) {
+      BeaconBuilder fresh(frame);
+      bytes += fresh.build().length;
+    } else {
+      bytes += builder.build().length;
+    }
+  }
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  CHECK(bytes > 0);
+  return elapsed.count() / rounds;
+}
+
+/**
+ * How long a beacon takes to pack the ArduinoJson way, patched when only
+ * epoch and uptime tick over, patched when that changes their width, and
+ * packed from scratch.
+ *
+ * the host's ArduinoJson is our own little one built on std::string, so the
+ * "before" number is the same kind of work (a document, then serializing and
+ * chunking all of it every time) and not what the real library costs.
+ */
+static void benchmark() {
+  Config::compression = false;
+  Config::face = "(^-^)";
+  Config::pwnd_run = 3;
+  Config::pwnd_tot = 42;
+
+  // make sure both pack the same beacon, the old one sent min_rssi as the
+  // min_recon_time
+  int minReconTime = Config::min_recon_time;
+  Config::min_recon_time = Config::min_rssi;
+  size_t legacyLength;
+  uint8_t *legacy = legacyPack(&legacyLength);
+  static uint8_t frame[BeaconBuilder::maxFrameSize];
+  BeaconBuilder builder(frame);
+  beacon_span_t span = builder.build();
+  CHECK(span.length == legacyLength);
+  CHECK(unpack(span) == unpack({legacy, legacyLength}));
+  delete[] legacy;
+  Config::min_recon_time = minReconTime;
+
+  double times[BENCH_CASES];
+  for (int i = 0; i < BENCH_CASES; i++) {
+    times[i] = timeBeacons((bench_case_t)i);
+  }
+  const char *names[BENCH_CASES] = {"before, ArduinoJson",
+                                    "now, epoch and uptime",
+                                    "now, width changed", "now, from scratch"};
+
+  printf("%zu byte beacon, per beacon:\n", span.length);
+  printf("  %-24s %10s\n", "", "us");
+  for (int i = 0; i < BENCH_CASES; i++) {
+    printf("  %-24s %10.2f\n", names[i], times[i]);
+  }
+
+  CHECK(times[BENCH_SAME_WIDTH] < times[BENCH_LEGACY]);
+  CHECK(times[BENCH_NEW_WIDTH] < times[BENCH_LEGACY]);
+}
+
+int main() {
+  testPatching(false);
+  testPatching(true);
+  testNoHeap(false);
+  testNoHeap(true);
+  benchmark();
+  return TEST_RESULT();
+}
@@ -0,0 +1,109 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * channel_test.cpp: where a sweep leaves us
+ */
+
+#include "../beacon.h"
+#include "../channel.h"
+#include "../pwnagotchi.h"
+#include "sim.h"
+#include "test.h"
+
+static uint8_t beacon[BeaconBuilder::maxFrameSize];
+
+// some access point's beacon, anything but the pwngrid address
+static const uint8_t busy[] = {0x80, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff,
+                               0xff, 0xff, 0x02, 0x11, 0x22, 0x33, 0x44, 0x55,
+                               0x02, 0x11, 0x22, 0x33, 0x44, 0x55, 0x00, 0x00};
+
+/**
+ * Runs one scan in sweep mode, with the air busy on some channels and a
+ * pwnagotchi on another
+ * @param peerChannel Where the pwnagotchi is, 0 for nowhere
+ * @param busyChannel Where there's lots of access points, 0 for nowhere
+ */
+static int sweep(int peerChannel, int busyChannel) {
+  Config::identity = "sweeper";
+  BeaconBuilder builder(beacon);
+  beacon_span_t span = builder.build();
+
+  uint32_t hops = Sim::hops();
+  for (int step = 0; Pwnagotchi::detect() != Scheduler::done; step++) {
+    int channel = Radio::getChannel();
+    if (channel == peerChannel) {
+      Sim::receive(span.data, span.length, -50, 0);
+    }
+
+    // 500 frames a second on the busy channel, 20 everywhere else
+    int frames = (channel == busyChannel) ? 5 : (step % 5 == 0);
+    for (int i = 0; i < frames; i++) {
+      Sim::receive(busy, sizeof(busy), -80, 0);
+    }
+    Sim::advance(10);
+  }
+
+  // one hop per channel, and one more to get off the last one
+  CHECK(Sim::hops() - hops >= 13);
+  CHECK(Channel::getChannel() == Radio::getChannel());
+  return Channel::getChannel();
+}
+
+/**
+ * The sweep ends on the channel that did best, not on 13 where it stopped
+ */
+static void testBest() {
+  CHECK(sweep(6, 0) == 6);
+  CHECK(sweep(6, 0) == 6);
+
+  // a quiet sweep keeps going with what did well before
+  CHECK(sweep(0, 0) == 6);
+
+  // pwnagotchi count for more than busy air
+  Sim::advance(600000);
+  CHECK(sweep(3, 9) == 3);
+
+  // and once the pwnagotchi is gone, busy air wins out eventually
+  Sim::advance(600000);
+  int channel = 0;
+  for (int i = 0; i < 10 && channel != 9; i++) {
+    channel = sweep(0, 9);
+  }
+  CHECK(channel == 9);
+
+  // 13 is fine too, if it earned it
+  Sim::advance(600000);
+  CHECK(sweep(13, 0) == 13);
+}
+
+int main() {
+  Config::scan = true;
+  Config::sweep = true;
+  Config::sweepDwell = 100;
+  Radio::begin();
+  Channel::init(1);
+  Sim::serialOutput();
+
+  testBest();
+
+  // and it says so
+  CHECK(Sim::serialOutput().find("staying on channel 13") !=
+        std::string::npos);
+  return TEST_RESULT();
+}
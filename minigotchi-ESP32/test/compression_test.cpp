@@ -0,0 +1,298 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * compression_test.cpp: our gzip against itself and against zlib
+ */
+
+#include "../compression.h"
+#include "test.h"
+#include <random>
+#include <vector>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+/** developer note:
+ *
+ * the fixtures are the pwngrid advertisement below gzipped by zlib at level
+ * 9, which picks a dynamic huffman block, and the same thing as raw deflate
+ * flushed halfway, so it has a dynamic block, an empty stored block and one
+ * more after that. made with python's zlib:
+ *
+ *   zlib.compressobj(9, zlib.DEFLATED, 31)
+ *   zlib.compressobj(9, zlib.DEFLATED, -15), flush(zlib.Z_FULL_FLUSH)
+ *
+ * when cmake finds zlib the random payloads also go through it both ways.
+ *
+ */
+
+static const char advertisement[] =
+    "{\"epoch\":42,\"face\":\"(^-^)\",\"identity\":\"b9210077f7c14c0651aa338c55"
+    "e820e93f90110ef679648001b1cecdbffc0090\",\"name\":\"pwnagotchi\",\"pwnd_ru"
+    "n\":3,\"pwnd_tot\":117,\"session_id\":\"84:f3:eb:58:95:bd\",\"timestamp\":"
+    "1700000000,\"uptime\":3600,\"version\":\"1.8.4\",\"policy\":{\"advertise\""
+    ":true,\"ap_ttl\":120,\"associate\":true,\"bored_num_epochs\":15,\"channels"
+    "\":[1,2,3,4,5,6,7,8,9,10,11,12,13],\"deauth\":true,\"excited_num_epochs\":"
+    "10,\"hop_recon_time\":10,\"max_inactive_scale\":2,\"max_interactions\":3,"
+    "\"max_misses_for_recon\":5,\"min_recon_time\":5,\"min_rssi\":-200,\"recon_"
+    "inactive_multiplier\":2,\"recon_time\":30,\"sad_num_epochs\":25,\"sta_ttl"
+    "\":300}}";
+
+static const uint8_t zlibGzip[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x5d, 0x91,
+    0xd9, 0x4e, 0xc4, 0x30, 0x0c, 0x45, 0xff, 0x25, 0x4f, 0x20, 0x79, 0x50,
+    0x96, 0xae, 0xf9, 0x15, 0x04, 0x51, 0x9a, 0xba, 0x34, 0x52, 0x9b, 0x54,
+    0x4d, 0xca, 0x22, 0x34, 0xff, 0x8e, 0x33, 0xc3, 0x20, 0xa0, 0x6f, 0xbe,
+    0xd7, 0x3e, 0x8e, 0x6f, 0x3f, 0x19, 0x6e, 0xd1, 0xcd, 0x4c, 0x57, 0x12,
+    0xd8, 0x64, 0x1d, 0x32, 0xcd, 0xee, 0x9e, 0x4f, 0xcf, 0xf7, 0x0c, 0x98,
+    0x1f, 0x31, 0x64, 0x9f, 0x3f, 0x48, 0x1a, 0x7a, 0x29, 0x38, 0x6f, 0xdb,
+    0xa9, 0x75, 0xa2, 0x72, 0xbc, 0xa9, 0x85, 0xb5, 0x4a, 0x75, 0xae, 0xae,
+    0xb1, 0x93, 0x1c, 0x7b, 0x35, 0xf5, 0x5c, 0x08, 0x8e, 0x53, 0xd3, 0xf6,
+    0x4d, 0xd5, 0x71, 0x2e, 0x06, 0xe1, 0xd0, 0x8d, 0xc3, 0x34, 0x39, 0xce,
+    0x7b, 0x4e, 0xb4, 0x60, 0xd7, 0x02, 0xdf, 0xde, 0x82, 0x7d, 0x89, 0xd9,
+    0xcd, 0x9e, 0x34, 0x2a, 0x46, 0xb3, 0x1f, 0x81, 0x69, 0xf5, 0x5d, 0xe4,
+    0x98, 0x99, 0x16, 0xa2, 0x05, 0x96, 0x30, 0x25, 0x1f, 0x83, 0xf1, 0x23,
+    0x4d, 0x75, 0x95, 0x9e, 0x94, 0xc6, 0x41, 0xd7, 0x9d, 0xee, 0x6b, 0x3d,
+    0x8c, 0x34, 0x9c, 0xfd, 0x8a, 0x29, 0xdb, 0x75, 0xa3, 0x81, 0x96, 0x7f,
+    0x7f, 0xc0, 0x8e, 0xad, 0x18, 0x44, 0x6c, 0x4a, 0xf5, 0x8a, 0x7b, 0xa1,
+    0x10, 0x42, 0x3c, 0x74, 0x0f, 0x55, 0xd9, 0x19, 0x17, 0xef, 0xe8, 0xa6,
+    0x4f, 0x66, 0x47, 0x72, 0xb3, 0x4f, 0xd4, 0x9c, 0xf7, 0x03, 0x81, 0xd9,
+    0xcd, 0xe4, 0xbc, 0x10, 0x4e, 0xd2, 0xa4, 0x4d, 0x29, 0x3a, 0x6f, 0xf3,
+    0x8f, 0x3b, 0xc4, 0x1d, 0x47, 0x13, 0x8e, 0xd5, 0x5c, 0x22, 0x4b, 0xd4,
+    0x57, 0x03, 0x73, 0xb3, 0x0d, 0x01, 0x17, 0xaa, 0x1e, 0x05, 0x48, 0x50,
+    0x50, 0x41, 0x0d, 0x0d, 0xb4, 0xd0, 0x41, 0x0f, 0x82, 0x83, 0x10, 0x20,
+    0x24, 0x08, 0xf5, 0x04, 0x6c, 0x44, 0x7b, 0xe4, 0xf9, 0x86, 0xc3, 0x77,
+    0xe7, 0xf3, 0x7f, 0x20, 0xed, 0x9d, 0xe3, 0x66, 0x76, 0x74, 0x74, 0xf9,
+    0xf5, 0x8e, 0xa2, 0xad, 0xf6, 0xdd, 0xf8, 0x60, 0x5d, 0xf6, 0xaf, 0x68,
+    0x92, 0xb3, 0x0b, 0xe9, 0xf2, 0x26, 0x67, 0xdc, 0x8b, 0x13, 0x43, 0xba,
+    0xc4, 0x58, 0xc4, 0xd5, 0x27, 0x8a, 0xcf, 0x4c, 0x71, 0xbf, 0xa2, 0x98,
+    0xa6, 0x97, 0xae, 0x3e, 0xfc, 0x01, 0xdf, 0x24, 0x8a, 0x99, 0xe9, 0x93,
+    0x2c, 0x69, 0x5d, 0xed, 0x9f, 0x4d, 0xeb, 0xb1, 0x64, 0xbf, 0x2d, 0x1e,
+    0xf7, 0xcb, 0xba, 0xdf, 0xc3, 0x8a, 0xba, 0x93, 0xfd, 0xfb, 0x7a, 0x49,
+    0x44, 0xfa, 0x21, 0xd7, 0x0c, 0x15, 0xe7, 0xe7, 0xf3, 0x17, 0xa9, 0x8a,
+    0xd6, 0x7b, 0x5e, 0x02, 0x00, 0x00};
+
+static const uint8_t zlibRaw[] = {
+    0x3c, 0x8f, 0x59, 0x6e, 0xc3, 0x30, 0x0c, 0x44, 0xef, 0xc2, 0xaf, 0x16,
+    0x70, 0x03, 0xca, 0x9b, 0x96, 0xc3, 0xc4, 0xd0, 0x42, 0x35, 0x02, 0x12,
+    0xcb, 0xb0, 0xe8, 0x14, 0x45, 0x2e, 0x5f, 0x1a, 0x08, 0xca, 0xbf, 0x99,
+    0xe1, 0x3c, 0x82, 0x2f, 0xa0, 0xad, 0xc6, 0x1b, 0xb8, 0xb1, 0xef, 0x20,
+    0xfb, 0x48, 0xe0, 0xe0, 0xe3, 0xfa, 0x75, 0xfd, 0x84, 0x0e, 0x4a, 0xa2,
+    0x95, 0x0b, 0xff, 0x8a, 0x15, 0x6c, 0xaf, 0x10, 0xb5, 0xce, 0x3a, 0xaa,
+    0x31, 0xe2, 0x3c, 0x29, 0xef, 0x87, 0xc1, 0xc4, 0x69, 0x22, 0xd3, 0x23,
+    0xd9, 0x21, 0x5b, 0x54, 0x0a, 0x29, 0xcf, 0xda, 0xce, 0xa3, 0x41, 0x54,
+    0x41, 0x45, 0x8a, 0x29, 0xe4, 0x1c, 0x11, 0x2d, 0x0a, 0x6d, 0xf5, 0x8f,
+    0x13, 0xbe, 0xfd, 0xac, 0xfe, 0xbb, 0x72, 0xbc, 0x15, 0xf1, 0x44, 0xa4,
+    0x65, 0x3f, 0x56, 0x70, 0xc3, 0x5b, 0x70, 0x65, 0x70, 0x4a, 0xe9, 0x0e,
+    0x1a, 0xb5, 0x56, 0xea, 0xba, 0x94, 0x24, 0x2d, 0x33, 0xba, 0x3c, 0x38,
+    0x0a, 0x6e, 0x32, 0xce, 0x4e, 0x2e, 0x24, 0x29, 0x73, 0x79, 0x50, 0x63,
+    0xff, 0xd8, 0xa4, 0xa0, 0xf1, 0x3d, 0x1d, 0x1c, 0xdb, 0x19, 0x08, 0x71,
+    0x3e, 0xd5, 0x93, 0xf6, 0x93, 0x22, 0x08, 0x75, 0x31, 0x97, 0xf1, 0xbc,
+    0x59, 0xef, 0x25, 0xca, 0x4f, 0x2f, 0xf0, 0x49, 0x52, 0x2e, 0x4d, 0x96,
+    0x79, 0x3f, 0xa8, 0x03, 0xbf, 0x2d, 0xcc, 0x77, 0xc1, 0xf5, 0xd2, 0xf4,
+    0xad, 0xd5, 0x58, 0x3c, 0xff, 0xa7, 0xa1, 0xee, 0xf4, 0x07, 0x00, 0x00,
+    0xff, 0xff, 0x55, 0x8e, 0x49, 0x0a, 0xc3, 0x30, 0x0c, 0x45, 0xef, 0xe2,
+    0xb5, 0x0a, 0xb1, 0xd3, 0x31, 0x57, 0x29, 0xc5, 0x18, 0x47, 0x25, 0x02,
+    0x0f, 0xc1, 0x52, 0x4a, 0x36, 0xbd, 0x7b, 0x9d, 0x86, 0x94, 0x66, 0xa9,
+    0xa7, 0xaf, 0xf7, 0xd5, 0xdb, 0x34, 0x45, 0x8b, 0x63, 0xf6, 0x03, 0xab,
+    0x4e, 0x9f, 0x40, 0xf9, 0xc1, 0xa5, 0x84, 0xa1, 0x4e, 0x77, 0x0d, 0x06,
+    0x5a, 0x38, 0xc2, 0x09, 0xce, 0x70, 0x81, 0x2b, 0xdc, 0x40, 0x37, 0xa0,
+    0x35, 0x68, 0x03, 0xba, 0x7d, 0x80, 0xea, 0xd1, 0x4d, 0x32, 0xa8, 0x4e,
+    0xca, 0x84, 0xa0, 0x70, 0xf6, 0x24, 0xd8, 0xef, 0x85, 0x0d, 0xa8, 0x21,
+    0x8f, 0xb6, 0xa0, 0xcf, 0xc9, 0x0a, 0x45, 0x5c, 0x59, 0x74, 0xb3, 0xa5,
+    0xe4, 0xbc, 0xd0, 0x0b, 0x2d, 0x7b, 0x17, 0x2a, 0x37, 0x1b, 0x16, 0x2c,
+    0xcb, 0x26, 0xa7, 0x2a, 0x68, 0x57, 0x18, 0x89, 0x19, 0xd9, 0x3e, 0x73,
+    0x59, 0x55, 0xaa, 0xab, 0x9f, 0x46, 0x4a, 0x3b, 0xf1, 0x86, 0x98, 0x49,
+    0x75, 0x07, 0xd3, 0xd4, 0x9e, 0x75, 0xfd, 0x6b, 0x8a, 0x53, 0x10, 0x1a,
+    0x03, 0x61, 0xf9, 0xd6, 0xfd, 0x1f, 0xb7, 0x35, 0xcd, 0x6e, 0xff, 0xbd,
+    0xa9, 0x46, 0x16, 0x67, 0x45, 0xc2, 0x12, 0x68, 0xde, 0xef, 0x0f};
+
+static std::mt19937 generator(4);
+
+/**
+ * Makes up a payload, sometimes random, sometimes very repetitive
+ * @param length How long
+ */
+static std::vector<uint8_t> payload(size_t length) {
+  std::vector<uint8_t> data(length);
+  switch (generator() % 4) {
+  case 0:
+    // noise, mostly literals above 143 which take 9 bits
+    for (uint8_t &c : data) {
+      c = generator();
+    }
+    break;
+  case 1:
+    // a tiny alphabet, lots of short matches
+    for (uint8_t &c : data) {
+      c = "abcd"[generator() % 4];
+    }
+    break;
+  case 2: {
+    // runs and long repeats, some further back than the window
+    size_t period = 1 + generator() % (2 * Compression::windowSize);
+    for (size_t i = 0; i < length; i++) {
+      data[i] = i < period ? generator() % 16 : data[i - period];
+    }
+    break;
+  }
+  default:
+    // bits of the advertisement shuffled around, like real json
+    for (size_t i = 0; i < length; i++) {
+      data[i] = advertisement[(i + generator() % 3) % strlen(advertisement)];
+    }
+    break;
+  }
+  return data;
+}
+
+/**
+ * Gzips and gunzips random payloads, and the same with raw deflate
+ */
+static void testRoundTrip() {
+  for (int i = 0; i < 2000; i++) {
+    std::vector<uint8_t> in = payload(1 + generator() % 1500);
+    std::vector<uint8_t> packed(in.size() * 9 / 8 + 64);
+    std::vector<uint8_t> out(in.size());
+
+    size_t packedLength =
+        Compression::compress(in.data(), in.size(), packed.data(),
+                              packed.size());
+    CHECK(packedLength > 0);
+    CHECK(Compression::decompress(packed.data(), packedLength, out.data(),
+                                  out.size()) == in.size());
+    CHECK(out == in);
+
+    packedLength = Compression::deflate(in.data(), in.size(), packed.data(),
+                                        packed.size());
+    CHECK(packedLength > 0);
+    std::fill(out.begin(), out.end(), 0);
+    CHECK(Compression::inflate(packed.data(), packedLength, out.data(),
+                               out.size()) == in.size());
+    CHECK(out == in);
+  }
+}
+
+/**
+ * What zlib makes, dynamic huffman and all, comes back out
+ */
+static void testZlibFixtures() {
+  size_t length = strlen(advertisement);
+  std::vector<uint8_t> out(length);
+
+  CHECK(Compression::decompress(zlibGzip, sizeof(zlibGzip), out.data(),
+                                out.size()) == length);
+  CHECK(memcmp(out.data(), advertisement, length) == 0);
+
+  std::fill(out.begin(), out.end(), 0);
+  CHECK(Compression::inflate(zlibRaw, sizeof(zlibRaw), out.data(),
+                             out.size()) == length);
+  CHECK(memcmp(out.data(), advertisement, length) == 0);
+
+  // doesn't fit
+  CHECK(Compression::decompress(zlibGzip, sizeof(zlibGzip), out.data(),
+                                length - 1) == 0);
+}
+
+/**
+ * Broken or cut off data is turned down instead of half decoded
+ */
+static void testCorrupt() {
+  size_t length = strlen(advertisement);
+  std::vector<uint8_t> out(length);
+  std::vector<uint8_t> broken(zlibGzip, zlibGzip + sizeof(zlibGzip));
+
+  // crc
+  broken[broken.size() - 8] ^= 0x01;
+  CHECK(Compression::decompress(broken.data(), broken.size(), out.data(),
+                                out.size()) == 0);
+
+  // size
+  broken[broken.size() - 8] ^= 0x01;
+  broken[broken.size() - 4] ^= 0x01;
+  CHECK(Compression::decompress(broken.data(), broken.size(), out.data(),
+                                out.size()) == 0);
+
+  // cut off anywhere
+  for (size_t cut = 0; cut < sizeof(zlibGzip); cut += 7) {
+    CHECK(Compression::decompress(zlibGzip, cut, out.data(), out.size()) == 0);
+  }
+  for (size_t cut = 0; cut < sizeof(zlibRaw) - 1; cut += 5) {
+    CHECK(Compression::inflate(zlibRaw, cut, out.data(), out.size()) == 0);
+  }
+
+  // not even gzip
+  CHECK(Compression::decompress((const uint8_t *)advertisement, length,
+                                out.data(), out.size()) == 0);
+}
+
+#ifdef HAVE_ZLIB
+/**
+ * zlib reads what we write, and we read what zlib writes at every level
+ */
+static void testZlib() {
+  for (int i = 0; i < 500; i++) {
+    std::vector<uint8_t> in = payload(1 + generator() % 1500);
+    std::vector<uint8_t> packed(in.size() * 9 / 8 + 64);
+    std::vector<uint8_t> out(in.size());
+
+    size_t packedLength =
+        Compression::compress(in.data(), in.size(), packed.data(),
+                              packed.size());
+    z_stream stream = {};
+    CHECK(inflateInit2(&stream, 31) == Z_OK);
+    stream.next_in = packed.data();
+    stream.avail_in = packedLength;
+    stream.next_out = out.data();
+    stream.avail_out = out.size();
+    CHECK(inflate(&stream, Z_FINISH) == Z_STREAM_END);
+    CHECK(stream.total_out == in.size());
+    CHECK(out == in);
+    inflateEnd(&stream);
+
+    int level = 1 + i % 9;
+    int strategy = i % 2 == 0 ? Z_DEFAULT_STRATEGY : Z_FIXED;
+    stream = z_stream();
+    packed.resize(deflateBound(&stream, in.size()) + 32);
+    CHECK(deflateInit2(&stream, level, Z_DEFLATED, 31, 8, strategy) == Z_OK);
+    stream.next_in = in.data();
+    stream.avail_in = in.size();
+    stream.next_out = packed.data();
+    stream.avail_out = packed.size();
+    CHECK(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+    packedLength = stream.total_out;
+    deflateEnd(&stream);
+
+    std::fill(out.begin(), out.end(), 0);
+    CHECK(Compression::decompress(packed.data(), packedLength, out.data(),
+                                  out.size()) == in.size());
+    CHECK(out == in);
+  }
+}
+#endif
+
+int main() {
+  testRoundTrip();
+  testZlibFixtures();
+  testCorrupt();
+#ifdef HAVE_ZLIB
+  testZlib();
+#endif
+  return TEST_RESULT();
+}
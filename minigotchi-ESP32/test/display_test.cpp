@@ -0,0 +1,241 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * display_test.cpp: U8G2 line breaking against how it used to be done, and
+ * how long both take
+ */
+
+// the host build has no screen, so the U8G2 code is only built in with
+// every driver, see screen_test.cpp
+#define DISPLAY_ALL_SCREENS
+#include "../display.cpp"
+#include "sim.h"
+#include "test.h"
+#include <chrono>
+#include <random>
+#include <vector>
+
+static std::mt19937 generator(20);
+
+// status messages the firmware actually shows, the long ones especially
+static const char *messages[] = {
+    "Hi,       I'm Minigotchi",
+    "Edit my config.cpp!",
+    "Starting  now",
+    "Current Minigotchi Stats:",
+    "Version: 3.6.0-beta",
+    "Heap: 254316 bytes",
+    "CPU Frequency: 240 MHz",
+    "Initializing on channel 1",
+    "Successfully initialized on channel 1",
+    "Channel initialization failed, try again?",
+    "Switching to channel 11",
+    "Channel switch to 11 has failed",
+    "Scanning  for APs...",
+    "Selected random AP: NETGEAR-5G-Guest-Network",
+    "Selected AP is not encrypted. Skipping deauthentication...",
+    "Selected AP is in the whitelist. Skipping deauthentication...",
+    "Full AP SSID: NETGEAR-5G-Guest-Network",
+    "AP Encryption: 3",
+    "AP RSSI: -67",
+    "AP BSSID: de:ad:be:ef:de:ad",
+    "No access point selected. Use select() first.",
+    "Begin deauth-attack on AP...",
+    "Packets per second: 147 pkt/s (Channel: 11)",
+    "Both packets failed to send!",
+    "Starting advertisment...",
+    "Scanning  for Pwnagotchi...",
+    "Pwnagotchi detected!",
+    "Could not parse Pwnagotchi json!",
+    "Pwnagotchi name: pwnagotchi-in-the-hallway",
+    "Pwned Networks: 1337",
+    "No Pwnagotchi found.",
+    "Feeling intense",
+};
+static const size_t messageCount = sizeof(messages) / sizeof(messages[0]);
+
+/**
+ * printU8G2Data() as it was before the layout cache, kept word for word
+ * @param screen Screen to print on
+ * @param x X value to print data
+ * @param y Y value to print data
+ * @param data Text to print
+ */
+static void legacyPrint(U8G2 *screen, int x, int y, const char *data) {
+  int numCharPerLine = screen->getWidth() / screen->getMaxCharWidth();
+  if (strlen(data) <= numCharPerLine &&
+      screen->getStrWidth(data) <=
+          screen->getWidth() - screen->getMaxCharWidth()) {
+    screen->drawStr(x, y, data);
+  } else {
+    int lineNum = 0;
+    char buf[numCharPerLine + 1];
+    memset(buf, 0, sizeof(buf));
+    for (int i = 0; i < strlen(data); ++i) {
+      if (data[i] != '\n') {
+        buf[strlen(buf)] = data[i];
+      }
+      if (data[i] == '\n' || strlen(buf) == numCharPerLine ||
+          i == strlen(data) - 1 ||
+          screen->getStrWidth(buf) >=
+              screen->getWidth() - screen->getMaxCharWidth()) {
+        buf[strlen(buf)] = '\0';
+        screen->drawStr(x, y + (screen->getMaxCharHeight() * lineNum++) + 1,
+                        buf);
+        memset(buf, 0, sizeof(buf));
+      }
+    }
+  }
+}
+
+/**
+ * Draws a string both ways and checks every pixel came out the same
+ * @param data Text to draw
+ */
+static bool sameAsBefore(const char *data) {
+  U8G2_SSD1306_128X64_NONAME_F_SW_I2C before(U8G2_R0, 0, 0, 0);
+  U8G2_SSD1306_128X64_NONAME_F_SW_I2C after(U8G2_R0, 0, 0, 0);
+
+  before.setFont(u8g2_font_6x10_tr);
+  legacyPrint(&before, 0, 32, data);
+  Display::printU8G2Data(&after, u8g2_font_6x10_tr, 0, 32, data);
+  return memcmp(before.getBufferPtr(), after.getBufferPtr(),
+                DISPLAY_SHADOW_SIZE) == 0;
+}
+
+/**
+ * The real messages, and random ones with the odd newline, break the same
+ */
+static void testLayout() {
+  for (size_t i = 0; i < messageCount; i++) {
+    CHECK(sameAsBefore(messages[i]));
+  }
+
+  // drawn again, this time out of the cache
+  for (size_t i = 0; i < messageCount; i++) {
+    CHECK(sameAsBefore(messages[i]));
+  }
+
+  for (int i = 0; i < 2000; i++) {
+    std::string data;
+    size_t length = 1 + generator() % 80;
+    for (size_t j = 0; j < length; j++) {
+      data += generator() % 16 == 0 ? '\n' : (char)(' ' + generator() % 95);
+    }
+    CHECK(sameAsBefore(data.c_str()));
+  }
+}
+
+/**
+ * Two strings with the same length and FNV-1a hash, but their newlines in
+ * different places, each gets its own lines
+ */
+static void testCollision() {
+  static const char first[] = "pofl bluhywktiwvwmfufk\nuibzec ";
+  static const char second[] = "b s kdgcq smwql okjvujfgdp\nn p";
+
+  uint32_t hashes[2] = {2166136261u, 2166136261u};
+  const char *strings[2] = {first, second};
+  for (int i = 0; i < 2; i++) {
+    for (const char *c = strings[i]; *c != '\0'; c++) {
+      hashes[i] = (hashes[i] ^ (uint8_t)*c) * 16777619u;
+    }
+  }
+  CHECK(strlen(first) == strlen(second));
+  CHECK(hashes[0] == hashes[1]);
+
+  CHECK(sameAsBefore(first));
+  CHECK(sameAsBefore(second));
+  CHECK(sameAsBefore(first));
+}
+
+/**
+ * Times drawing every message a number of rounds, in microseconds each
+ * @param legacy Whether to go the old way
+ * @param repeat How many times in a row each message gets drawn
+ * @param lookups Set to how many glyphs were looked up per message
+ */
+static double timeMessages(bool legacy, int repeat, double *lookups) {
+  U8G2_SSD1306_128X64_NONAME_F_SW_I2C screen(U8G2_R0, 0, 0, 0);
+  screen.setFont(u8g2_font_6x10_tr);
+  const int rounds = 200;
+  const size_t count = rounds * messageCount * repeat;
+
+  uint32_t firstLookup = Sim::glyphLookups();
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    for (size_t i = 0; i < messageCount; i++) {
+      for (int j = 0; j < repeat; j++) {
+        if (legacy) {
+          legacyPrint(&screen, 0, 32, messages[i]);
+        } else {
+          Display::printU8G2Data(&screen, u8g2_font_6x10_tr, 0, 32,
+                                 messages[i]);
+        }
+      }
+    }
+  }
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  *lookups = (double)(Sim::glyphLookups() - firstLookup) / count;
+  return elapsed.count() / count;
+}
+
+/**
+ * How long a message takes to lay out and draw the old way, with nothing
+ * cached (there's more messages than DISPLAY_LAYOUT_CACHE), and with every
+ * message drawn a few times in a row like the animations do.
+ *
+ * the host's glyph lookups are cheap, so the time is mostly drawing pixels.
+ * on the board every lookup walks the font data, so the lookups (drawing
+ * takes one per character either way) are the number to go by.
+ */
+static void benchmark() {
+  double lookups[4];
+  double times[4] = {timeMessages(true, 1, &lookups[0]),
+                     timeMessages(false, 1, &lookups[1]),
+                     timeMessages(true, 8, &lookups[2]),
+                     timeMessages(false, 8, &lookups[3])};
+  const char *names[4] = {"before", "now, cold cache", "before, 8x each",
+                          "now, 8x each"};
+
+  size_t characters = 0;
+  for (size_t i = 0; i < messageCount; i++) {
+    characters += strlen(messages[i]);
+  }
+  printf("%zu messages, %.1f characters each, per message:\n", messageCount,
+         (double)characters / messageCount);
+  printf("  %-16s %10s %10s\n", "", "glyphs", "us");
+  for (int i = 0; i < 4; i++) {
+    printf("  %-16s %10.1f %10.2f\n", names[i], lookups[i], times[i]);
+  }
+
+  // the old way measured every line over and over, now the font gets
+  // measured once and after that only drawing looks up glyphs
+  CHECK(lookups[1] < lookups[0] / 2);
+  CHECK(lookups[1] < (double)characters / messageCount + 1);
+}
+
+int main() {
+  testLayout();
+  testCollision();
+  benchmark();
+  return TEST_RESULT();
+}
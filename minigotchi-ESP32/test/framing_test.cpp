@@ -0,0 +1,301 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * framing_test.cpp: binary parasite frames, on their own and over a pty
+ */
+
+#include "../parasite.h"
+#include "sim.h"
+#include "test.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <random>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+static std::mt19937 generator(14);
+
+/**
+ * COBS the slow and obvious way, to check ours against
+ * @param raw Bytes to encode
+ */
+static std::vector<uint8_t> cobs(const std::vector<uint8_t> &raw) {
+  std::vector<uint8_t> out(1, 0);
+  size_t code = 0;
+  for (uint8_t c : raw) {
+    if (c != 0) {
+      out.push_back(c);
+    }
+    if (c == 0 || out.size() - code == 0xFF) {
+      out[code] = out.size() - code;
+      code = out.size();
+      out.push_back(0);
+    }
+  }
+  out[code] = out.size() - code;
+  return out;
+}
+
+/**
+ * Builds a frame by hand, with whatever crc we like
+ * @param type Message type
+ * @param status Status
+ * @param payload Payload
+ * @param crcError Gets xored into the crc
+ */
+static std::vector<uint8_t> frame(uint8_t type, uint8_t status,
+                                  const std::vector<uint8_t> &payload,
+                                  uint16_t crcError) {
+  std::vector<uint8_t> raw = {(uint8_t)payload.size(), type, status};
+  raw.insert(raw.end(), payload.begin(), payload.end());
+  uint16_t crc = Framing::crc16(raw.data(), raw.size()) ^ crcError;
+  raw.push_back(crc & 0xFF);
+  raw.push_back(crc >> 8);
+
+  std::vector<uint8_t> encoded = cobs(raw);
+  encoded.insert(encoded.begin(), 0);
+  encoded.push_back(0);
+  return encoded;
+}
+
+/**
+ * Makes up a payload, sometimes all zeros or without any
+ * @param length How long
+ */
+static std::vector<uint8_t> payload(size_t length) {
+  std::vector<uint8_t> data(length);
+  uint32_t kind = generator() % 4;
+  for (uint8_t &c : data) {
+    c = kind == 0 ? 0 : kind == 1 ? 1 + generator() % 255 : generator();
+    if (kind == 3 && generator() % 2 == 0) {
+      c = 0;
+    }
+  }
+  return data;
+}
+
+/**
+ * The crc is CRC-16/CCITT-FALSE
+ */
+static void testCrc() {
+  CHECK(Framing::crc16((const uint8_t *)"123456789", 9) == 0x29B1);
+  CHECK(Framing::crc16(nullptr, 0) == 0xFFFF);
+}
+
+/**
+ * Random payloads come back out the same, and encode like the reference
+ */
+static void testRoundTrip() {
+  uint8_t out[Framing::maxFrame];
+  for (int i = 0; i < 2000; i++) {
+    size_t length = generator() % (Framing::maxPayload + 1);
+    std::vector<uint8_t> data = payload(length);
+    uint8_t type = generator();
+    uint8_t status = generator();
+
+    size_t encoded =
+        Framing::encode(type, status, data.data(), length, out, sizeof(out));
+    CHECK(encoded > 2 && encoded <= Framing::maxFrame);
+    CHECK(out[0] == 0 && out[encoded - 1] == 0);
+    CHECK(memchr(out + 1, 0, encoded - 2) == nullptr);
+    CHECK(std::vector<uint8_t>(out, out + encoded) ==
+          frame(type, status, data, 0));
+
+    framing_header_t header;
+    const uint8_t *decoded;
+    CHECK(Framing::decode(out + 1, encoded - 2, &header, &decoded));
+    CHECK(header.length == length);
+    CHECK(header.type == type);
+    CHECK(header.status == status);
+    CHECK(length == 0 || memcmp(decoded, data.data(), length) == 0);
+  }
+
+  // too big, or nowhere to put it
+  std::vector<uint8_t> big(Framing::maxPayload + 1);
+  CHECK(Framing::encode(1, 200, big.data(), big.size(), out, sizeof(out)) ==
+        0);
+  CHECK(Framing::encode(1, 200, big.data(), 1, out, sizeof(out) - 1) == 0);
+}
+
+/**
+ * Frames with a bad crc or cut short are turned down
+ */
+static void testBroken() {
+  for (int i = 0; i < 500; i++) {
+    std::vector<uint8_t> data = payload(generator() % 64);
+    uint16_t error = 1 + generator() % 0xFFFF;
+    std::vector<uint8_t> bad = frame(PARASITE_CHANNEL, 200, data, error);
+
+    framing_header_t header;
+    const uint8_t *decoded;
+    CHECK(!Framing::decode(bad.data() + 1, bad.size() - 2, &header, &decoded));
+
+    std::vector<uint8_t> good = frame(PARASITE_CHANNEL, 200, data, 0);
+    for (size_t cut = 1; cut < good.size() - 2; cut++) {
+      std::vector<uint8_t> truncated(good.begin() + 1, good.end() - 1 - cut);
+      CHECK(!Framing::decode(truncated.data(), truncated.size(), &header,
+                             &decoded));
+    }
+  }
+}
+
+/**
+ * Reads from the pty until a line or a frame is in, or a second goes by
+ * @param fd Our end of the pty
+ * @param binary Whether to wait for a frame instead of a line
+ */
+static std::vector<uint8_t> readReply(int fd, bool binary) {
+  std::vector<uint8_t> reply;
+  struct pollfd wait = {fd, POLLIN, 0};
+  while (poll(&wait, 1, 1000) > 0) {
+    uint8_t c;
+    if (read(fd, &c, 1) != 1) {
+      break;
+    }
+
+    // frames start with a delimiter too
+    if (binary && c == 0 && reply.empty()) {
+      continue;
+    }
+    if ((binary && c == 0) || (!binary && c == '\n')) {
+      break;
+    }
+    reply.push_back(c);
+  }
+  return reply;
+}
+
+/**
+ * Writes to the pty, then lets the parasite read it once it came through
+ * @param fd Our end of the pty
+ * @param data What to send
+ */
+static void send(int fd, const std::vector<uint8_t> &data) {
+  CHECK(write(fd, data.data(), data.size()) == (ssize_t)data.size());
+
+  // the reader thread hands it over to the ring, give it a moment
+  for (int i = 0; i < 100; i++) {
+    usleep(2000);
+    Parasite::readData();
+  }
+}
+
+/**
+ * Decodes a frame we got back, returns false if it doesn't check out
+ * @param reply Frame without delimiters
+ * @param header Where to put the header
+ * @param payload Where to put the payload
+ */
+static bool decodeReply(std::vector<uint8_t> &reply, framing_header_t *header,
+                        const uint8_t **payload) {
+  return !reply.empty() &&
+         Framing::decode(reply.data(), reply.size(), header, payload);
+}
+
+/**
+ * The plugin's side of it, over a pty like the board's usb serial port:
+ * ask for our name in text, switch to binary, set a channel, and make sure
+ * broken frames don't do anything
+ */
+static void testPty() {
+  Config::parasite = true;
+  std::string path = Sim::serialPty();
+  CHECK(!path.empty());
+  int fd = open(path.c_str(), O_RDWR | O_NOCTTY);
+  CHECK(fd >= 0);
+  if (fd < 0) {
+    return;
+  }
+
+  struct termios settings;
+  tcgetattr(fd, &settings);
+  cfmakeraw(&settings);
+  tcsetattr(fd, TCSANOW, &settings);
+  Parasite::begin();
+
+  // text first, like plugins that don't know about frames
+  const char *hello = "nme:::txt\n";
+  send(fd, std::vector<uint8_t>(hello, hello + strlen(hello)));
+  std::vector<uint8_t> line = readReply(fd, false);
+  std::string text(line.begin(), line.end());
+  CHECK(!Parasite::binary);
+  CHECK(text == "nme:::{\"status\":\"200\",\"data\":\"minigotchi\"}\r");
+
+  // then ask for frames
+  const char *bin = "nme:::bin\n";
+  send(fd, std::vector<uint8_t>(bin, bin + strlen(bin)));
+  CHECK(Parasite::binary);
+  std::vector<uint8_t> reply = readReply(fd, true);
+  framing_header_t header;
+  const uint8_t *payload;
+  CHECK(decodeReply(reply, &header, &payload));
+  CHECK(header.type == PARASITE_NAME);
+  CHECK(header.status == 200);
+  CHECK(header.length == sizeof(parasite_name_t));
+  CHECK(header.length != sizeof(parasite_name_t) ||
+        strcmp((const char *)payload, "minigotchi") == 0);
+
+  // a channel frame, with the status coming back in the next batch
+  send(fd, frame(PARASITE_CHANNEL, 0, {6}, 0));
+  CHECK(Parasite::channel == 6);
+  Sim::advance(Parasite::window);
+  Parasite::flush();
+  reply = readReply(fd, true);
+  CHECK(decodeReply(reply, &header, &payload));
+  CHECK(header.type == PARASITE_BATCH);
+  CHECK(header.length == 4 + sizeof(parasite_channel_t));
+  if (header.length == 4 + sizeof(parasite_channel_t)) {
+    CHECK(payload[0] == PARASITE_CHANNEL);
+    CHECK(payload[1] == SYNCED_CHANNEL);
+    CHECK(payload[4] == 6);
+  }
+
+  // a bad crc, and one cut off before the next frame starts
+  send(fd, frame(PARASITE_CHANNEL, 0, {11}, 0x0100));
+  CHECK(Parasite::channel == 6);
+  std::vector<uint8_t> cut = frame(PARASITE_CHANNEL, 0, {11}, 0);
+  cut.resize(cut.size() - 3);
+  send(fd, cut);
+  CHECK(Parasite::channel == 6);
+
+  // and it picks up again at the next delimiter
+  send(fd, frame(PARASITE_CHANNEL, 0, {3}, 0));
+  CHECK(Parasite::channel == 3);
+
+  // a name frame gets our name again
+  Sim::advance(Parasite::window);
+  Parasite::flush();
+  readReply(fd, true);
+  send(fd, frame(PARASITE_NAME, 0, {}, 0));
+  reply = readReply(fd, true);
+  CHECK(decodeReply(reply, &header, &payload));
+  CHECK(header.type == PARASITE_NAME);
+
+  close(fd);
+  Sim::serialClose();
+}
+
+int main() {
+  testCrc();
+  testRoundTrip();
+  testBroken();
+  testPty();
+  return TEST_RESULT();
+}
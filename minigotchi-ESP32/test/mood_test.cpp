@@ -0,0 +1,146 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * mood_test.cpp: recorded event traces through the mood engine
+ */
+
+#include "../mood.h"
+#include "../config.h"
+#include "sim.h"
+#include "test.h"
+
+// one epoch: what got posted during it, and the resting mood after it
+typedef struct {
+  const char *events;
+  mood_t expected;
+} mood_epoch_t;
+
+/** developer note:
+ *
+ * p is a peer seen, e an empty channel and f a failed transmission. the
+ * epochs follow each other, so every line starts where the last one left
+ * off, with excited at 3, bored at 3 and sad at 5 epochs.
+ *
+ */
+
+static const mood_epoch_t trace[] = {
+    // happy takes excited_num_epochs, then hysteresis more to show
+    {"p", mood_t::NEUTRAL},
+    {"p", mood_t::NEUTRAL},
+    {"p", mood_t::NEUTRAL},
+    {"p", mood_t::HAPPY},
+
+    // an epoch we didn't look doesn't count either way
+    {"", mood_t::HAPPY},
+
+    // one empty channel isn't enough to drop it, two epochs of neutral are
+    {"e", mood_t::HAPPY},
+    {"p", mood_t::NEUTRAL},
+
+    // bored, then sad, each held for two epochs first
+    {"e", mood_t::NEUTRAL},
+    {"e", mood_t::NEUTRAL},
+    {"e", mood_t::NEUTRAL},
+    {"e", mood_t::BORED},
+    {"e", mood_t::BORED},
+    {"", mood_t::SAD},
+
+    // two failures is fine, three is broken right away
+    {"eff", mood_t::SAD},
+    {"efff", mood_t::BROKEN},
+
+    // and it stays broken while failures keep coming back every other epoch
+    {"e", mood_t::BROKEN},
+    {"efff", mood_t::BROKEN},
+    {"e", mood_t::BROKEN},
+    {"e", mood_t::SAD},
+
+    // peers cheer it back up, a step at a time
+    {"p", mood_t::SAD},
+    {"p", mood_t::NEUTRAL},
+    {"pp", mood_t::NEUTRAL},
+    {"p", mood_t::HAPPY},
+};
+
+/**
+ * Counts how often a line showed up on the console since we last looked
+ * @param line What to look for
+ */
+static int printed(const char *line) {
+  std::string output = Sim::serialOutput();
+  int count = 0;
+  for (size_t i = output.find(line); i != std::string::npos;
+       i = output.find(line, i + 1)) {
+    count++;
+  }
+  return count;
+}
+
+/**
+ * Plays the trace and checks the resting mood after every epoch, and that a
+ * switch is announced exactly when it happens
+ */
+static void testTrace() {
+  Config::excited_num_epochs = 3;
+  Config::bored_num_epochs = 3;
+  Config::sad_num_epochs = 5;
+  Sim::serialOutput();
+
+  mood_t previous = Mood::resting();
+  for (size_t i = 0; i < sizeof(trace) / sizeof(trace[0]); i++) {
+    for (const char *c = trace[i].events; *c != '\0'; c++) {
+      Mood::post(*c == 'p'   ? MOOD_EVENT_PEER_SEEN
+                 : *c == 'e' ? MOOD_EVENT_CHANNEL_EMPTY
+                             : MOOD_EVENT_TX_FAILURE);
+    }
+    Mood::post(MOOD_EVENT_EPOCH);
+
+    mood_t resting = Mood::resting();
+    if (resting != trace[i].expected) {
+      fprintf(stderr, "epoch %zu: %s instead of %s\n", i, Mood::name(resting),
+              Mood::name(trace[i].expected));
+    }
+    CHECK(resting == trace[i].expected);
+    CHECK(printed(" Feeling ") == (resting != previous ? 1 : 0));
+    if (resting != previous) {
+      CHECK(Mood::current() == resting);
+      CHECK(Config::face == Mood::face(resting));
+    }
+    previous = resting;
+  }
+}
+
+/**
+ * Every mood has its own face and name
+ */
+static void testFaces() {
+  for (uint8_t i = 0; i < Mood::count; i++) {
+    for (uint8_t j = 0; j < i; j++) {
+      CHECK(strcmp(Mood::face((mood_t)i), Mood::face((mood_t)j)) != 0);
+      CHECK(strcmp(Mood::name((mood_t)i), Mood::name((mood_t)j)) != 0);
+    }
+  }
+  CHECK(strcmp(Mood::face(mood_t::BROKEN), "(X-X)") == 0);
+}
+
+int main() {
+  testTrace();
+  testFaces();
+  return TEST_RESULT();
+}
@@ -0,0 +1,174 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * peer_test.cpp: who we remember hearing from, and for how long
+ */
+
+#include "../beacon.h"
+#include "../pwnagotchi.h"
+#include "sim.h"
+#include "test.h"
+
+static uint8_t beacon[BeaconBuilder::maxFrameSize];
+
+/**
+ * Has a pwnagotchi send its beacon, and handles it like detect() would
+ * @param identity Who's sending it
+ * @param pwndTot What it has pwned, a change gets reported
+ * @param uptime How long it's been up, a change doesn't
+ */
+static void hear(int identity, int pwndTot, int uptime) {
+  Config::identity = "peer" + std::to_string(identity);
+  Config::name = "pwnagotchi" + std::to_string(identity);
+  Config::pwnd_tot = pwndTot;
+  Config::uptime = uptime;
+
+  BeaconBuilder builder(beacon);
+  beacon_span_t span = builder.build();
+  CHECK(Sim::receive(span.data, span.length, -60, 0));
+  Pwnagotchi::process();
+}
+
+/**
+ * Counts how often a line showed up on the console since we last looked
+ * @param line What to look for
+ */
+static int printed(const char *line) {
+  std::string output = Sim::serialOutput();
+  int count = 0;
+  for (size_t i = output.find(line); i != std::string::npos;
+       i = output.find(line, i + 1)) {
+    count++;
+  }
+  return count;
+}
+
+/**
+ * The same beacon over and over is only reported once, a new pwnd count is
+ * reported again, and a new uptime isn't
+ */
+static void testRepeats() {
+  Pwnagotchi::reset();
+  for (int i = 0; i < 5; i++) {
+    hear(0, 1, 10);
+  }
+  CHECK(printed("Pwnagotchi detected!") == 1);
+  CHECK(Pwnagotchi::heard() == 1);
+
+  hear(0, 2, 10);
+  CHECK(printed("Pwnagotchi detected!") == 1);
+  hear(0, 2, 20);
+  CHECK(printed("Pwnagotchi detected!") == 0);
+  CHECK(Pwnagotchi::heard() == 1);
+
+  // someone else, then the first one again
+  hear(1, 2, 20);
+  hear(0, 2, 20);
+  CHECK(printed("Pwnagotchi detected!") == 1);
+  CHECK(Pwnagotchi::heard() == 2);
+}
+
+/**
+ * Peers are forgotten after peerTimeout, and only then
+ */
+static void testTimeout() {
+  Sim::advance(Pwnagotchi::peerTimeout);
+  Pwnagotchi::reset();
+  CHECK(Pwnagotchi::heard() == 0);
+
+  hear(0, 2, 20);
+  CHECK(printed("Pwnagotchi detected!") == 1);
+
+  // just before it times out it's still known
+  Sim::advance(Pwnagotchi::peerTimeout - 1000);
+  hear(0, 2, 20);
+  CHECK(printed("Pwnagotchi detected!") == 0);
+
+  // that beacon counted, so it's another peerTimeout from here
+  Sim::advance(Pwnagotchi::peerTimeout - 1000);
+  CHECK(Pwnagotchi::heard() == 1);
+  Sim::advance(1000);
+  CHECK(Pwnagotchi::heard() == 0);
+  hear(0, 2, 20);
+  CHECK(printed("Pwnagotchi detected!") == 1);
+}
+
+/**
+ * A full table makes room by dropping whoever we heard from longest ago
+ */
+static void testEviction() {
+  Sim::advance(Pwnagotchi::peerTimeout);
+  Pwnagotchi::reset();
+
+  for (int i = 0; i < Pwnagotchi::peerCount; i++) {
+    hear(i, 5, 0);
+    Sim::advance(1000);
+  }
+  CHECK(printed("Pwnagotchi detected!") == Pwnagotchi::peerCount);
+  CHECK(Pwnagotchi::heard() == Pwnagotchi::peerCount);
+
+  // keep the first one fresh, the second one is the oldest now
+  hear(0, 5, 0);
+  Sim::advance(1000);
+  hear(Pwnagotchi::peerCount, 5, 0);
+  CHECK(printed("Pwnagotchi detected!") == 1);
+  CHECK(Pwnagotchi::heard() == Pwnagotchi::peerCount);
+
+  // so the first one is still known and the second is new again
+  hear(0, 5, 0);
+  CHECK(printed("Pwnagotchi detected!") == 0);
+  hear(1, 5, 0);
+  CHECK(printed("Pwnagotchi detected!") == 1);
+
+  // which pushed out the third
+  hear(2, 5, 0);
+  CHECK(printed("Pwnagotchi detected!") == 1);
+  CHECK(Pwnagotchi::heard() == Pwnagotchi::peerCount);
+}
+
+/**
+ * A beacon we can't parse is only complained about once
+ */
+static void testBad() {
+  static const char json[] = "{\"name\":\"broken\",";
+  std::vector<uint8_t> frame(Frame::header,
+                             Frame::header + sizeof(Frame::header));
+  frame.push_back(Frame::IDWhisperPayload);
+  frame.push_back(sizeof(json) - 1);
+  frame.insert(frame.end(), json, json + sizeof(json) - 1);
+
+  for (int i = 0; i < 3; i++) {
+    CHECK(Sim::receive(frame.data(), frame.size(), -70, 0));
+    Pwnagotchi::process();
+  }
+  CHECK(printed("Could not parse Pwnagotchi json!") == 1);
+}
+
+int main() {
+  Radio::begin();
+  Radio::promiscuous(true);
+  Radio::listen(Pwnagotchi::pwnagotchiCallback);
+  Sim::serialOutput();
+
+  testRepeats();
+  testTimeout();
+  testEviction();
+  testBad();
+  return TEST_RESULT();
+}
@@ -0,0 +1,157 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * radio_test.cpp: everything goes over the air through Radio
+ */
+
+#include "../minigotchi.h"
+#include "sim.h"
+#include "test.h"
+
+// any frame will do, the sniffer only gets to see it
+static uint32_t heard = 0;
+static uint16_t heardLength = 0;
+static uint8_t heardChannel = 0;
+static wifi_promiscuous_pkt_type_t heardType = WIFI_PKT_MISC;
+
+static void listener(void *buf, wifi_promiscuous_pkt_type_t type) {
+  wifi_promiscuous_pkt_t *packet = (wifi_promiscuous_pkt_t *)buf;
+  heard++;
+  heardLength = packet->rx_ctrl.sig_len;
+  heardChannel = packet->rx_ctrl.channel;
+  heardType = type;
+}
+
+/**
+ * Counts the frames of one type and subtype that went out
+ * @param frameControl First byte of the frame
+ */
+static size_t countSent(uint8_t frameControl) {
+  size_t count = 0;
+  for (const sim_frame_t &frame : Sim::sent()) {
+    if (!frame.data.empty() && frame.data[0] == frameControl) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/**
+ * Sending only works once the driver is up, and failures get counted
+ */
+static void testSend() {
+  static const uint8_t frame[] = {0x80, 0x00, 0x00, 0x00};
+
+  CHECK(!Radio::send(WIFI_IF_AP, frame, sizeof(frame), false));
+  Radio::begin();
+  CHECK(Sim::mode() == WIFI_MODE_STA);
+
+  CHECK(Radio::setChannel(6));
+  CHECK(Radio::getChannel() == 6);
+  CHECK(!Radio::setChannel(0));
+  CHECK(Radio::getChannel() == 6);
+
+  Sim::clearSent();
+  CHECK(Radio::send(WIFI_IF_AP, frame, sizeof(frame), false));
+  Sim::failSends(1);
+  CHECK(!Radio::send(WIFI_IF_AP, frame, sizeof(frame), false));
+
+  std::vector<sim_frame_t> sent = Sim::sent();
+  CHECK(sent.size() == 1);
+  CHECK(sent[0].channel == 6);
+  CHECK(sent[0].data.size() == sizeof(frame));
+}
+
+/**
+ * Sniffed frames only show up in promiscuous mode on our channel
+ */
+static void testListen() {
+  static const uint8_t frame[] = {0x80, 0x00, 0x00, 0x00, 0x01, 0x02};
+
+  Radio::listen(listener);
+  Radio::promiscuous(false);
+  CHECK(!Sim::receive(frame, sizeof(frame), -40, 0));
+
+  Radio::promiscuous(true);
+  CHECK(Radio::promiscuous());
+  CHECK(!Sim::receive(frame, sizeof(frame), -40, Radio::getChannel() + 1));
+  CHECK(Sim::receive(frame, sizeof(frame), -40, Radio::getChannel()));
+  CHECK(heard == 1);
+  CHECK(heardLength == sizeof(frame) + 4);
+  CHECK(heardChannel == Radio::getChannel());
+  CHECK(heardType == WIFI_PKT_MGMT);
+
+  Radio::listen(nullptr);
+  Radio::promiscuous(false);
+}
+
+/**
+ * Scans take a while and only find what's on the channel asked for
+ */
+static void testScan() {
+  CHECK(Radio::scanComplete() == Radio::scanFailed);
+
+  Sim::addNetwork({"home", {0x02, 0x11, 0x22, 0x33, 0x44, 0x55}, 3, -60,
+                   WIFI_AUTH_WPA2_PSK});
+  Sim::addNetwork({"cafe", {0x02, 0x66, 0x77, 0x88, 0x99, 0xaa}, 11, -75,
+                   WIFI_AUTH_OPEN});
+
+  Radio::scan(0);
+  CHECK(Radio::scanComplete() == Radio::scanRunning);
+  Sim::advance(13 * 300);
+  CHECK(Radio::scanComplete() == 2);
+  CHECK(Radio::scanSSID(0) == "home");
+  CHECK(Radio::scanBSSID(0)[5] == 0x55);
+  CHECK(Radio::scanEncryption(0) == WIFI_AUTH_WPA2_PSK);
+  CHECK(Radio::scanRSSI(1) == -75);
+  CHECK(Radio::scanChannel(1) == 11);
+  CHECK(Radio::scanBSSID(2) == nullptr);
+
+  Radio::scan(11);
+  Sim::advance(300);
+  CHECK(Radio::scanComplete() == 1);
+  CHECK(Radio::scanSSID(0) == "cafe");
+}
+
+/**
+ * A couple of epochs of the whole thing, all of it on the simulated radio
+ */
+static void testEpochs() {
+  Sim::clearSent();
+  uint32_t hops = Sim::hops();
+
+  Minigotchi::boot();
+  unsigned long end = millis() + 5 * 60 * 1000UL;
+  while ((long)(millis() - end) < 0) {
+    Minigotchi::tick();
+  }
+
+  // beacons while advertising, and deauths on the encrypted network
+  CHECK(countSent(0x80) > 0);
+  CHECK(countSent(0xC0) > 0);
+  CHECK(Sim::hops() > hops);
+}
+
+int main() {
+  testSend();
+  testListen();
+  testScan();
+  testEpochs();
+  return TEST_RESULT();
+}
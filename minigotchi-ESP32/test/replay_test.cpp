@@ -0,0 +1,234 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * replay_test.cpp: made up captures through the replay tool
+ */
+
+#include "../beacon.h"
+#include "replay.h"
+#include "sim.h"
+#include "test.h"
+#include <unistd.h>
+
+static uint8_t beacon[BeaconBuilder::maxFrameSize];
+
+// some access point's beacon, and a data frame
+static const uint8_t busy[] = {0x80, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff,
+                               0xff, 0xff, 0x02, 0x11, 0x22, 0x33, 0x44, 0x55,
+                               0x02, 0x11, 0x22, 0x33, 0x44, 0x55, 0x00, 0x00};
+static const uint8_t data[] = {0x08, 0x01, 0x00, 0x00, 0x02, 0x11, 0x22, 0x33,
+                               0x44, 0x55, 0x02, 0x66, 0x77, 0x88, 0x99, 0xaa};
+
+/**
+ * Appends a number in either byte order
+ * @param pcap Capture to append to
+ * @param value Number to append
+ * @param size How many bytes it takes
+ * @param bigEndian Whether to store it big endian
+ */
+static void put(std::vector<uint8_t> &pcap, uint32_t value, int size,
+                bool bigEndian) {
+  for (int i = 0; i < size; i++) {
+    int shift = bigEndian ? 8 * (size - 1 - i) : 8 * i;
+    pcap.push_back(value >> shift);
+  }
+}
+
+/**
+ * Starts a capture
+ * @param linktype Link type of the records
+ * @param bigEndian Whether it was written on a big endian machine
+ */
+static std::vector<uint8_t> capture(uint32_t linktype, bool bigEndian) {
+  std::vector<uint8_t> pcap;
+  put(pcap, 0xa1b2c3d4, 4, bigEndian);
+  put(pcap, 2, 2, bigEndian);
+  put(pcap, 4, 2, bigEndian);
+  put(pcap, 0, 4, bigEndian);
+  put(pcap, 0, 4, bigEndian);
+  put(pcap, 65535, 4, bigEndian);
+  put(pcap, linktype, 4, bigEndian);
+  return pcap;
+}
+
+/**
+ * Appends a record, with a radiotap header for flags, channel and signal
+ * if a frequency is given
+ * @param pcap Capture to append to
+ * @param frame Frame to record
+ * @param length Length of frame
+ * @param bigEndian Whether the capture is big endian
+ * @param frequency Channel frequency, 0 for no radiotap header
+ * @param rssi Signal strength
+ */
+static void record(std::vector<uint8_t> &pcap, const uint8_t *frame,
+                   size_t length, bool bigEndian, uint16_t frequency = 0,
+                   int8_t rssi = 0) {
+  std::vector<uint8_t> radiotap;
+  if (frequency != 0) {
+    // radiotap is always little endian, the channel is 2 byte aligned
+    radiotap = {0, 0, 15, 0, 0x2a, 0, 0, 0, 0x00, 0};
+    put(radiotap, frequency, 2, false);
+    put(radiotap, 0x00a0, 2, false);
+    radiotap.push_back(rssi);
+  }
+
+  put(pcap, 0, 4, bigEndian);
+  put(pcap, 0, 4, bigEndian);
+  put(pcap, radiotap.size() + length, 4, bigEndian);
+  put(pcap, radiotap.size() + length, 4, bigEndian);
+  pcap.insert(pcap.end(), radiotap.begin(), radiotap.end());
+  pcap.insert(pcap.end(), frame, frame + length);
+}
+
+/**
+ * Packs a pwngrid beacon
+ * @param identity Who sends it
+ */
+static beacon_span_t pwnagotchi(const char *identity) {
+  Config::identity = identity;
+  Config::name = identity;
+  BeaconBuilder builder(beacon);
+  return builder.build();
+}
+
+/**
+ * Replays a capture, with what got printed in output
+ * @param pcap Capture to replay
+ * @param result Where to put the results
+ * @param output Where to put what got printed
+ */
+static bool replay(const std::vector<uint8_t> &pcap, replay_result_t *result,
+                   std::string *output) {
+  // heard() goes by the millisecond, keep the last replay's peers out of it
+  Sim::advance(1000);
+
+  Replay::output = tmpfile();
+  bool ok = Replay::run(pcap.data(), pcap.size(), result);
+
+  output->clear();
+  rewind(Replay::output);
+  char buf[256];
+  size_t length;
+  while ((length = fread(buf, 1, sizeof(buf), Replay::output)) > 0) {
+    output->append(buf, length);
+  }
+  fclose(Replay::output);
+  Replay::output = nullptr;
+  return ok;
+}
+
+/**
+ * A radiotap capture of a crowded channel with two pwnagotchi in it
+ */
+static void testRadiotap() {
+  std::vector<uint8_t> pcap = capture(REPLAY_LINKTYPE_RADIOTAP, false);
+  for (int i = 0; i < 1000; i++) {
+    record(pcap, busy, sizeof(busy), false, 2437, -80);
+    record(pcap, data, sizeof(data), false, 2437, -70);
+    if (i % 100 == 0) {
+      beacon_span_t span = pwnagotchi(i < 500 ? "alpha" : "bravo");
+      record(pcap, span.data, span.length, false, i < 500 ? 2437 : 2484,
+             i < 500 ? -42 : -61);
+    }
+  }
+
+  // a radiotap header we don't know, and a record cut off at the end
+  std::vector<uint8_t> broken = {1, 0, 8, 0, 0, 0, 0, 0, 0x80, 0};
+  record(pcap, broken.data(), broken.size(), false);
+  record(pcap, busy, sizeof(busy), false, 2412, -50);
+  pcap.resize(pcap.size() - 4);
+
+  replay_result_t result;
+  std::string output;
+  CHECK(replay(pcap, &result, &output));
+  CHECK(result.frames == 2010);
+  CHECK(result.skipped == 2);
+  CHECK(result.heard == 2);
+  CHECK(result.p50 <= result.p90 && result.p90 <= result.p99 &&
+        result.p99 <= result.max && result.max > 0);
+  CHECK(result.elapsed >= result.max);
+
+  // channel and signal came out of the radiotap headers
+  CHECK(output.find("RSSI: -42\r\n(^-^) Channel: 6\r\n") != std::string::npos);
+  CHECK(output.find("RSSI: -61\r\n(^-^) Channel: 14\r\n") !=
+        std::string::npos);
+  Replay::print(&result);
+}
+
+/**
+ * Plain 802.11 from a big endian machine, heard on our own channel
+ */
+static void testPlain() {
+  Radio::setChannel(11);
+  std::vector<uint8_t> pcap = capture(REPLAY_LINKTYPE_80211, true);
+  beacon_span_t span = pwnagotchi("charlie");
+  record(pcap, span.data, span.length, true);
+  record(pcap, busy, sizeof(busy), true);
+  record(pcap, busy, 1, true);
+
+  replay_result_t result;
+  std::string output;
+  CHECK(replay(pcap, &result, &output));
+  CHECK(result.frames == 2);
+  CHECK(result.skipped == 1);
+  CHECK(result.heard == 1);
+  CHECK(output.find("RSSI: -50\r\n(^-^) Channel: 11\r\n") != std::string::npos);
+}
+
+/**
+ * Files that aren't a capture we can replay are turned down
+ */
+static void testBroken() {
+  replay_result_t result;
+  std::string output;
+  std::vector<uint8_t> pcap = capture(1, false);
+  CHECK(!replay(pcap, &result, &output));
+  CHECK(Replay::error() == "Can't replay link type 1");
+
+  pcap[0] = 0;
+  CHECK(!replay(pcap, &result, &output));
+  pcap.resize(10);
+  CHECK(!replay(pcap, &result, &output));
+
+  // and through a file, like the tool reads it
+  char path[] = "/tmp/replay_testXXXXXX";
+  int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  pcap = capture(REPLAY_LINKTYPE_80211, false);
+  record(pcap, busy, sizeof(busy), false);
+  CHECK(write(fd, pcap.data(), pcap.size()) == (ssize_t)pcap.size());
+  close(fd);
+
+  std::vector<uint8_t> loaded;
+  CHECK(Replay::load(path, &loaded));
+  CHECK(loaded == pcap);
+  unlink(path);
+  CHECK(!Replay::load(path, &loaded));
+}
+
+int main() {
+  Radio::begin();
+  Radio::setChannel(1);
+
+  testRadiotap();
+  testPlain();
+  testBroken();
+  return TEST_RESULT();
+}
@@ -0,0 +1,146 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * screen_test.cpp: every display backend through the same updates
+ */
+
+// the backends only exist in display.cpp, and only the one for CONFIG_SCREEN
+// gets built there. pulling it in here with every driver lets us have them all
+#define DISPLAY_ALL_SCREENS
+#include "../display.cpp"
+#include "sim.h"
+#include "test.h"
+#include <chrono>
+
+// one call to updateDisplay()
+typedef struct {
+  mood_t mood;
+  const char *text;
+} screen_update_t;
+
+// booting, a scan with its animation, then a deauth counting packets
+static const screen_update_t updates[] = {
+    {mood_t::HAPPY, "Hi,       I'm Minigotchi"},
+    {mood_t::NEUTRAL, "Edit my config.cpp!"},
+    {mood_t::INTENSE, "Starting  now"},
+    {mood_t::NEUTRAL, "Current Minigotchi Stats:"},
+    {mood_t::NEUTRAL, "Version: 3.6.0-beta"},
+    {mood_t::NEUTRAL, "Heap: 254316 bytes"},
+    {mood_t::NEUTRAL, "CPU Frequency: 240 MHz"},
+    {mood_t::NEUTRAL, "Started sucessfully"},
+    {mood_t::SLEEPING, "Initializing on channel 1"},
+    {mood_t::NEUTRAL, "Successfully initialized on channel 1"},
+    {mood_t::LOOKING1, "Scanning  for Pwnagotchi."},
+    {mood_t::LOOKING2, "Scanning  for Pwnagotchi.."},
+    {mood_t::LOOKING1, "Scanning  for Pwnagotchi..."},
+    {mood_t::NEUTRAL, " "},
+    {mood_t::LOOKING1, "Scanning  for Pwnagotchi."},
+    {mood_t::LOOKING2, "Scanning  for Pwnagotchi.."},
+    {mood_t::LOOKING1, "Scanning  for Pwnagotchi..."},
+    {mood_t::NEUTRAL, " "},
+    {mood_t::SAD, "No Pwnagotchi found."},
+    {mood_t::LOOKING1, "Scanning  for APs."},
+    {mood_t::LOOKING2, "Scanning  for APs.."},
+    {mood_t::LOOKING1, "Scanning  for APs..."},
+    {mood_t::NEUTRAL, "Selected random AP: NETGEAR-5G-Guest-Network"},
+    {mood_t::NEUTRAL, "AP RSSI: -67"},
+    {mood_t::NEUTRAL, "AP Channel: 6"},
+    {mood_t::INTENSE, "Begin deauth-attack on AP..."},
+    {mood_t::INTENSE, "Packets per second: 147 pkt/s (Channel: 6)"},
+    {mood_t::INTENSE, "Packets per second: 151 pkt/s (Channel: 6)"},
+    {mood_t::INTENSE, "Packets per second: 151 pkt/s (Channel: 6)"},
+    {mood_t::INTENSE, "Packets per second: 149 pkt/s (Channel: 6)"},
+    {mood_t::INTENSE, "Packets per second: 150 pkt/s (Channel: 6)"},
+    {mood_t::HAPPY, "Attack finished!"},
+    {mood_t::HAPPY, "Attack finished!"},
+    {mood_t::BORED, "Feeling bored"},
+};
+static const size_t updateCount = sizeof(updates) / sizeof(updates[0]);
+
+/**
+ * Runs the updates through one backend like Display::draw() would, prints
+ * what it sent to the panel and how long drawing took on this machine
+ * @param name Name of the screen
+ * @param buffer Size of its frame buffer, 0 if it doesn't have one
+ * @param tiles Whether the backend only sends the tiles that changed
+ */
+template <config_screen_t screen>
+static void run(const char *name, size_t buffer, bool tiles) {
+  typedef typename DisplayScreen<screen>::backend_t backend_t;
+  backend_t::start();
+  uint32_t startBytes = Sim::panelBytes();
+
+  mood_t lastMood = mood_t::NEUTRAL;
+  String lastText = "";
+  size_t drawn = 0;
+  std::chrono::duration<double, std::micro> elapsed(0);
+
+  for (size_t i = 0; i < updateCount; i++) {
+    bool faceChanged = i == 0 || updates[i].mood != lastMood;
+    bool textChanged = i == 0 || lastText != updates[i].text;
+    if (!faceChanged && !textChanged) {
+      continue;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    backend_t::draw(Mood::face(updates[i].mood), updates[i].text, faceChanged,
+                    textChanged);
+    elapsed += std::chrono::steady_clock::now() - start;
+
+    lastMood = updates[i].mood;
+    lastText = updates[i].text;
+    drawn++;
+  }
+
+  uint32_t bytes = Sim::panelBytes() - startBytes;
+
+  // every update used to clear the screen and send the whole buffer, the
+  // colour ones already only redrew what changed
+  size_t before = buffer > 0 ? buffer * updateCount : bytes;
+  CHECK(bytes <= before);
+
+  if (tiles) {
+    // drawing the same thing again doesn't send anything
+    backend_t::draw(Mood::face(lastMood), lastText, false, true);
+    CHECK(Sim::panelBytes() - startBytes == bytes);
+    CHECK(bytes < before / 2);
+  }
+
+  printf("  %-18s %7zu %10u %10zu %10.1f %10.2f\n", name, drawn, bytes,
+         before, (double)bytes / updateCount, elapsed.count() / drawn);
+}
+
+int main() {
+  Config::display = true;
+
+  printf("%zu updates, bytes sent to the panel, drawing time on this "
+         "machine\n",
+         updateCount);
+  printf("  %-18s %7s %10s %10s %10s %10s\n", "screen", "drawn", "bytes",
+         "before", "per update", "us/draw");
+  run<SCREEN_SSD1306>("SSD1306", 1024, false);
+  run<SCREEN_WEMOS_OLED_SHIELD>("WEMOS_OLED_SHIELD", 384, false);
+  run<SCREEN_SSD1305>("SSD1305", 512, false);
+  run<SCREEN_IDEASPARK_SSD1306>("IDEASPARK_SSD1306", 1024, true);
+  run<SCREEN_SH1106>("SH1106", 1024, true);
+  run<SCREEN_M5STICKCP>("M5STICKCP", 0, false);
+  run<SCREEN_CYD>("CYD", 0, false);
+  run<SCREEN_T_DISPLAY_S3>("T_DISPLAY_S3", 0, false);
+  return TEST_RESULT();
+}
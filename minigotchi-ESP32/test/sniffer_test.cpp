@@ -0,0 +1,240 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * sniffer_test.cpp: which frames the beacon sniffer lets through, and how
+ * fast it turns away the rest
+ */
+
+#include "../beacon.h"
+#include "../pwnagotchi.h"
+#include "sim.h"
+#include "test.h"
+#include <chrono>
+#include <random>
+
+static std::mt19937 generator(6);
+static uint8_t beacon[BeaconBuilder::maxFrameSize];
+static size_t beaconLength;
+
+// what the driver hands the callback, payload last
+typedef struct {
+  std::vector<uint32_t> buffer;
+  wifi_promiscuous_pkt_type_t type;
+} sniffed_t;
+
+/**
+ * Wraps a frame up like the driver would, fcs and all
+ * @param frame Frame to wrap up
+ * @param length How long the frame is
+ * @param sigLength What the driver says the length is, without the fcs
+ * @param type What the driver says it is
+ */
+static sniffed_t sniffed(const uint8_t *frame, size_t length, size_t sigLength,
+                         wifi_promiscuous_pkt_type_t type) {
+  sniffed_t packet;
+  packet.buffer.assign((sizeof(wifi_promiscuous_pkt_t) + length + 4 + 3) / 4,
+                       0);
+  packet.type = type;
+
+  wifi_promiscuous_pkt_t *pkt = (wifi_promiscuous_pkt_t *)packet.buffer.data();
+  pkt->rx_ctrl.rssi = -60;
+  pkt->rx_ctrl.channel = 1;
+  pkt->rx_ctrl.sig_len = sigLength + 4;
+  memcpy(pkt->payload, frame, length);
+  return packet;
+}
+
+/**
+ * Whether the sniffer took a frame, going by what handling it printed
+ * @param packet What the driver handed over
+ */
+static bool taken(sniffed_t &packet) {
+  // forget whoever the last frame came from
+  Sim::advance(Pwnagotchi::peerTimeout);
+  Pwnagotchi::reset();
+  Sim::serialOutput();
+
+  Pwnagotchi::pwnagotchiCallback(packet.buffer.data(), packet.type);
+  Pwnagotchi::process();
+  return !Sim::serialOutput().empty() || Pwnagotchi::heard() > 0;
+}
+
+/**
+ * A beacon from the signature address gets through, one that's off by a
+ * single byte or bit anywhere in it doesn't, and neither does anything that
+ * isn't a beacon or is too short to have a source address
+ */
+static void testPrefilter() {
+  sniffed_t packet =
+      sniffed(beacon, beaconLength, beaconLength, WIFI_PKT_MGMT);
+  CHECK(taken(packet));
+
+  std::vector<uint8_t> frame(beacon, beacon + beaconLength);
+  for (int offset = 10; offset < 16; offset++) {
+    for (int bit = 0; bit < 8; bit++) {
+      frame[offset] ^= 1 << bit;
+      packet = sniffed(frame.data(), frame.size(), frame.size(), WIFI_PKT_MGMT);
+      CHECK(!taken(packet));
+      frame[offset] ^= 1 << bit;
+    }
+
+    // the other half of the address, where the destination would be
+    uint8_t saved = frame[offset];
+    frame[offset] = frame[offset - 6];
+    packet = sniffed(frame.data(), frame.size(), frame.size(), WIFI_PKT_MGMT);
+    CHECK(!taken(packet));
+    frame[offset] = saved;
+  }
+
+  // probe requests and responses, an action frame, a data frame
+  const uint8_t controls[] = {0x00, 0x40, 0x50, 0xd0, 0x08, 0x88, 0x81};
+  for (size_t i = 0; i < sizeof(controls); i++) {
+    frame[0] = controls[i];
+    packet = sniffed(frame.data(), frame.size(), frame.size(), WIFI_PKT_MGMT);
+    CHECK(!taken(packet));
+  }
+  frame[0] = 0x80;
+
+  // the whole beacon is there, the driver just says it's shorter
+  for (size_t length = 0; length < 16; length++) {
+    packet = sniffed(frame.data(), frame.size(), length, WIFI_PKT_MGMT);
+    CHECK(!taken(packet));
+  }
+
+  // the right bytes, only not a management frame
+  packet = sniffed(frame.data(), frame.size(), frame.size(), WIFI_PKT_DATA);
+  CHECK(!taken(packet));
+
+  packet = sniffed(frame.data(), frame.size(), frame.size(), WIFI_PKT_MGMT);
+  CHECK(taken(packet));
+}
+
+/**
+ * The sniffer's address check as it was before, formatting the address and
+ * comparing strings, kept word for word
+ * @param buf Packet recieved to use as a buffer
+ * @param type Type of packet
+ */
+static bool legacyMatch(void *buf, wifi_promiscuous_pkt_type_t type) {
+  wifi_promiscuous_pkt_t *snifferPacket = (wifi_promiscuous_pkt_t *)buf;
+  if (type == WIFI_PKT_MGMT) {
+    if (snifferPacket->payload[0] == 0x80) {
+      char addr[] = "00:00:00:00:00:00";
+      const unsigned char *buff = snifferPacket->payload;
+      snprintf(addr, 18, "%02x:%02x:%02x:%02x:%02x:%02x", buff[10], buff[11],
+               buff[12], buff[13], buff[14], buff[15]);
+      String src = addr;
+      if (src == "de:ad:be:ef:de:ad") {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * A beacon from some access point nearby, about the size real ones are
+ */
+static std::vector<uint8_t> accessPoint() {
+  std::vector<uint8_t> frame(160 + generator() % 160);
+  for (size_t i = 0; i < frame.size(); i++) {
+    frame[i] = generator();
+  }
+  frame[0] = 0x80;
+  frame[1] = 0x00;
+  return frame;
+}
+
+/**
+ * Replays bursts of what a busy channel sounds like, mostly access point
+ * beacons, some other management and data frames, and the odd pwnagotchi,
+ * and times every frame through the sniffer and through the old check
+ */
+static void benchmark() {
+  const int bursts = 2000;
+  const int burstLength = 100;
+  const int pwnagotchiEvery = 25;
+
+  std::vector<sniffed_t> burst;
+  for (int i = 0; i < burstLength; i++) {
+    if (i % pwnagotchiEvery == pwnagotchiEvery - 1) {
+      burst.push_back(
+          sniffed(beacon, beaconLength, beaconLength, WIFI_PKT_MGMT));
+      continue;
+    }
+
+    std::vector<uint8_t> frame = accessPoint();
+    wifi_promiscuous_pkt_type_t type = WIFI_PKT_MGMT;
+    if (i % 5 == 1) {
+      frame[0] = 0x40;
+    } else if (i % 5 == 3) {
+      frame[0] = 0x88;
+      type = WIFI_PKT_DATA;
+    }
+    burst.push_back(sniffed(frame.data(), frame.size(), frame.size(), type));
+  }
+
+  Sim::advance(Pwnagotchi::peerTimeout);
+  Pwnagotchi::reset();
+  std::chrono::duration<double, std::nano> now(0);
+  std::chrono::duration<double, std::nano> before(0);
+  int matched = 0;
+
+  for (int i = 0; i < bursts; i++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int j = 0; j < burstLength; j++) {
+      Pwnagotchi::pwnagotchiCallback(burst[j].buffer.data(), burst[j].type);
+    }
+    now += std::chrono::steady_clock::now() - start;
+
+    // what the loop task does in between, not part of the callback
+    Pwnagotchi::process();
+
+    start = std::chrono::steady_clock::now();
+    for (int j = 0; j < burstLength; j++) {
+      matched += legacyMatch(burst[j].buffer.data(), burst[j].type);
+    }
+    before += std::chrono::steady_clock::now() - start;
+  }
+  Sim::serialOutput();
+
+  const int frames = bursts * burstLength;
+  printf("%d bursts of %d frames, 1 in %d from a pwnagotchi, per frame:\n",
+         bursts, burstLength, pwnagotchiEvery);
+  printf("  %-30s %10s\n", "", "ns");
+  printf("  %-30s %10.1f\n", "before, snprintf and String", before.count() /
+         frames);
+  printf("  %-30s %10.1f\n", "now, whole callback", now.count() / frames);
+
+  CHECK(matched == frames / pwnagotchiEvery);
+  CHECK(Pwnagotchi::heard() == 1);
+  CHECK(now < before);
+}
+
+int main() {
+  Config::identity = "sniffer";
+  Config::name = "pwnagotchi";
+  BeaconBuilder builder(beacon);
+  beaconLength = builder.build().length;
+  Sim::serialOutput();
+
+  testPrefilter();
+  benchmark();
+  return TEST_RESULT();
+}
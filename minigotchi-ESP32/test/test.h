@@ -0,0 +1,50 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * test.h: the bare minimum for the host tests
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+
+/** developer note:
+ *
+ * every *_test.cpp in here is its own program, built by the CMakeLists.txt
+ * at the top of the repo against the simulated esp32 in host/ and run by
+ * ctest. a failed CHECK() prints where it was and the test keeps going, the
+ * exit code says if anything failed.
+ *
+ */
+
+static int testFailures = 0;
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,         \
+              #condition);                                                     \
+      testFailures++;                                                          \
+    }                                                                          \
+  } while (0)
+
+#define TEST_RESULT() (testFailures == 0 ? 0 : 1)
+
+#endif // TEST_H